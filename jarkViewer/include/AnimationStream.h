@@ -0,0 +1,98 @@
+#pragma once
+#include "jarkUtils.h"
+#include <thread>
+#include <deque>
+#include <functional>
+#include <atomic>
+#include <condition_variable>
+
+/*
+* 流式解码的动画：帧数多、全部解码后占用过大的动画不预先解码全部帧
+* 后台线程从播放位置起逐帧解码到环形缓冲，内存只保留其中几帧，首帧解码完即可开始播放
+* 后退/跳帧时从头重新解码到目标帧
+* 实况照片的视频使用延迟模式：加载时不解码，首次取帧（开始播放）时才启动解码线程
+*/
+
+// 逐帧解码的动画源，依次输出合成后的完整画布
+class AnimationSource {
+public:
+    virtual ~AnimationSource() = default;
+
+    // 解码下一帧，每次输出新分配的 Mat（BGRA 或 BGR）  已到末尾或解码失败返回 false
+    virtual bool next(cv::Mat& frame, int& durationMs) = 0;
+};
+
+class AnimationStream {
+public:
+    // 每次调用创建一个从第 0 帧开始的解码源，源自身持有压缩数据
+    using SourceFactory = std::function<std::unique_ptr<AnimationSource>()>;
+
+    static constexpr int RING_FRAMES = 8; // 从播放位置起缓冲的帧数
+
+    // source 为已输出第 0 帧的解码源，frameCount 为预先解析得到的帧数
+    AnimationStream(SourceFactory makeSource, std::unique_ptr<AnimationSource> source, int frameCount, cv::Mat firstFrame, int firstDuration);
+
+    // 延迟模式，frameSize/frameType 为预先从容器解析得到的帧尺寸和类型，用于计算内存占用
+    AnimationStream(SourceFactory makeSource, int frameCount, cv::Size frameSize, int frameType);
+    ~AnimationStream();
+
+    AnimationStream(const AnimationStream&) = delete;
+    AnimationStream& operator=(const AnimationStream&) = delete;
+
+    int frameCount() const { return count; }
+    cv::Size frameSize() const { return size; }
+
+    // 缓冲占满时的内存占用，用于缓存计算容量
+    size_t bytes() const;
+
+    // 取第 idx 帧，不在缓冲中则等待解码  第 0 帧常驻（延迟模式除外），无需等待  解码失败时返回最后一次取得的帧，从未取得时为空
+    cv::Mat getFrame(int idx, int* durationMs = nullptr);
+
+    enum class FrameStatus { Ready, Pending, Failed };
+
+    // 不等待：第 idx 帧已解码时写入 frame，否则让解码线程定位到该帧后返回 Pending，该帧无法解码时返回 Failed
+    FrameStatus tryGetFrame(int idx, cv::Mat& frame, int* durationMs = nullptr);
+
+    // 按顺序遍历全部帧（导出），使用独立的解码源，不影响播放  回调返回 false 时停止
+    bool forEachFrame(const std::function<bool(int idx, const cv::Mat& frame)>& callback) const;
+
+private:
+    struct Frame {
+        int idx;
+        cv::Mat mat;
+        int duration;
+    };
+
+    const SourceFactory makeSource;
+    const int count;
+    const int ringFrames;       // 帧数少于 RING_FRAMES 时缓冲全部帧
+    const cv::Size size;
+    const size_t frameBytes;
+    const cv::Mat firstFrame;   // 延迟模式下为空
+    const int firstDuration;
+
+    std::mutex mutex;
+    std::condition_variable frameCond;
+    std::deque<Frame> ring;     // 按播放顺序连续的帧，可越过末尾接回第 0 帧
+    cv::Mat lastFrame;          // 最后一次取得的帧及时长，解码失败时代替
+    int lastDuration = 0;
+    int playIdx = 0;
+    int endIdx;                 // 解码在此帧失败（文件损坏或帧数与预先解析的不符），之后的帧不再解码
+    uint64_t generation = 0;    // 重新定位时加一，丢弃定位前开始解码的帧
+    std::atomic<bool> isStop{ false };
+    std::thread decodeThread;
+
+    // 以下只在解码线程访问
+    std::unique_ptr<AnimationSource> source;
+    int sourceIdx = 1;          // source 下一次输出的帧序号
+
+    // 从 from 向后播放到 to 经过的帧数
+    int distance(int from, int to) const { return (to - from + count) % count; }
+
+    const Frame* findLocked(int idx) const;
+    bool seekLocked(int idx);
+    void trimLocked();
+    bool isNeedDecodeLocked(int& nextIdx);
+    bool decodeAt(int idx, Frame& frame);
+    void decodeWorker();
+};
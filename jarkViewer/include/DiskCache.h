@@ -0,0 +1,61 @@
+#pragma once
+#include "jarkUtils.h"
+#include <thread>
+#include <queue>
+#include <atomic>
+#include <condition_variable>
+
+/*
+* 解码结果的磁盘二级缓存（可在设置中开启）
+* RAW/PSD/JXL/HEIC/AVIF/BPG 等解码耗时的格式（ImageDatabase::decoderTable 中标记 CapSlowDecode），解码结果以 QOI 压缩存于 %LOCALAPPDATA%\jarkViewer\cache
+* 以 路径+文件大小+修改时间 作为键，文件被修改后旧缓存自然失效，按最近访问时间淘汰，总大小不超过上限
+*/
+class DiskCache {
+public:
+    static constexpr uint64_t MAX_CACHE_BYTES = 4ULL * 1024 * 1024 * 1024;  // 磁盘缓存总大小上限
+    static constexpr uint64_t MAX_ENTRY_BYTES = 1ULL * 1024 * 1024 * 1024;  // 单张图像解码后超过此大小不缓存
+
+    DiskCache() = default;
+    ~DiskCache();
+
+    DiskCache(const DiskCache&) = delete;
+    DiskCache& operator=(const DiskCache&) = delete;
+
+    static bool isEnabled() { return GlobalVar::settingParameter.isEnableDiskCache; }
+
+    // 读取缓存，命中则填充 imageAsset 并返回 true  identity 为源文件当前的身份
+    bool read(const wstring& path, const FileIdentity& identity, ImageAsset& imageAsset);
+
+    // 将解码结果加入后台写入队列，以 imageAsset.fileIdentity 作为键
+    void write(const wstring& path, const ImageAsset& imageAsset);
+
+    // 缓存条目的编码，源文件身份或路径不符、数据不完整时 deserialize 返回 false
+    static vector<uint8_t> serialize(const wstring& path, const FileIdentity& identity, const ImageAsset& imageAsset);
+    static bool deserialize(const uint8_t* data, size_t size, const wstring& path, const FileIdentity& identity, ImageAsset& imageAsset);
+
+private:
+    struct WriteTask {
+        wstring path;
+        FileIdentity identity;
+        ImageAsset imageAsset;  // cv::Mat 为引用计数，入队不复制像素
+    };
+
+    static constexpr size_t MAX_PENDING_WRITES = 4; // 写入队列上限，避免排队中的图像长期占用内存
+
+    std::mutex mutex;
+    std::condition_variable writeCond;
+    std::queue<WriteTask> writeQueue;
+    std::thread writeThread;
+    std::atomic<bool> stopWrite{ false };
+
+    wstring cacheDir;
+    bool hasInitDir = false;
+    uint64_t totalBytes = 0;    // 缓存目录当前总大小，写入线程首次写入前统计
+    bool hasScannedDir = false; // 只由写入线程访问
+
+    static wstring entryName(const wstring& path, const FileIdentity& identity);
+
+    bool initDirLocked();
+    void writeWorker();
+    void cleanup();
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include "jarkUtils.h"
+
+/*
+* 常驻内存动画帧的紧凑存储：关键帧 + 脏矩形增量，均以 QOI 压缩
+* GIF/APNG 等动画相邻帧通常只有一小块区域变化，每帧只保存与前一帧不同的矩形
+* 取帧时在复用的缓冲上从最近的关键帧（顺序播放时从上一帧）依次应用增量重建
+*/
+class FrameStore {
+public:
+    static constexpr int KEYFRAME_INTERVAL = 32; // 关键帧最大间隔，限制跳帧时需应用的增量数
+
+    // 压缩全部帧，帧类型不是 8 位 BGR/BGRA、尺寸不一或压缩收益不足时返回 nullptr
+    static std::shared_ptr<FrameStore> create(const std::vector<cv::Mat>& frames);
+
+    FrameStore(const FrameStore&) = delete;
+    FrameStore& operator=(const FrameStore&) = delete;
+
+    int frameCount() const { return (int)entries.size(); }
+
+    // 压缩数据 + 重建缓冲的内存占用
+    size_t bytes() const;
+
+    // 重建第 idx 帧  返回的 Mat 被外部持有时，下次重建先复制缓冲，已返回的帧内容不会被改写
+    cv::Mat getFrame(int idx);
+
+private:
+    struct Entry {
+        bool isKey = false;
+        cv::Rect rect;          // 与前一帧不同的区域，关键帧为整帧，为空表示与前一帧相同
+        vector<uint8_t> qoi;    // rect 区域像素的 QOI 数据
+    };
+
+    cv::Size size;
+    int type = 0;
+    vector<Entry> entries;
+    size_t dataBytes = 0;
+
+    std::mutex mutex;
+    cv::Mat buffer;             // 重建缓冲，内容为第 bufferIdx 帧
+    int bufferIdx = -1;
+
+    FrameStore() = default;
+    bool decodePatch(const Entry& entry);
+};
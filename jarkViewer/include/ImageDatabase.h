@@ -3,6 +3,11 @@
 #include "LRU.h"
 
 #include "videoDecoder.h"
+#include "Mp4Demuxer.h"
+#include "DiskCache.h"
+#include "Metrics.h"
+#include "AnimationStream.h"
+#include "FrameStore.h"
 #include "SVGPreprocessor.h"
 
 // libbpg v0.9.8 End on 2018  https://bellard.org/bpg/
@@ -101,68 +106,176 @@
 class ImageDatabase :public LRU<wstring, ImageAsset> {
 public:
 
-    // 自 OpenCV 4.12 起支持的动态图像格式 gif png webp
-    static inline const unordered_set<wstring_view> opencvAnimationExt{
-        L"gif", L"png", L"apng", L"webp",
+    // 解码器
+    enum class Decoder : int {
+        OpenCV,             // OpenCV 静态图 bmp/tiff/jp2/exr/pnm ...
+        OpenCVAnimation,    // 自 OpenCV 4.12 起支持的动态图像格式 gif png webp
+        MotionPhoto,        // JPEG，含 Android 实况照片
+        HeifMotionPhoto,    // HEIC/HEIF，含 Android 实况照片
+        Livp,               // 苹果实况照片
+        Avif,
+        Jxl,
+        Jxr,
+        Wp2,
+        Bpg,
+        TgaHdr,
+        Svg,
+        Qoi,
+        Ico,
+        Psd,
+        Pfm,
+        Raw,
     };
 
-    static inline const unordered_set<wstring_view> supportExt{
-        L"jpg", L"jp2", L"jpeg", L"jpe", L"bmp", L"dib", L"png", L"apng",
-        L"pbm", L"pgm", L"ppm", L"pxm",L"pnm",L"sr", L"ras",
-        L"exr", L"tiff", L"tif", L"webp", L"hdr", L"pic",
-        L"heic", L"heif", L"avif", L"avifs", L"gif", L"jxl",
-        L"ico", L"icon", L"psd", L"tga", L"svg", L"jfif",
-        L"jxr", L"wp2", L"pfm", L"bpg", L"livp", L"qoi",
+    // 解码器能力
+    enum DecoderCaps : uint32_t {
+        CapExif = 1 << 0,           // 需用 Exiv2 解析 EXIF
+        CapOrientation = 1 << 1,    // 解码过程已应用 EXIF 方向/裁剪，无需再旋转
+        CapSlowDecode = 1 << 2,     // 解码耗时较高，值得写入磁盘缓存
     };
 
-    static inline const unordered_set<wstring_view> supportRaw{
-        L"crw", L"cr2", L"cr3", // Canon
-        L"arw", L"srf", L"sr2", // Sony
-        L"raw", L"dng", // Leica
-        L"nef", // Nikon
-        L"pef", // Pentax
-        L"orf", // Olympus
-        L"rw2", // Panasonic
-        L"raf", // Fujifilm
-        L"kdc", // Kodak
-        L"x3f", // Sigma
-        L"mrw", // Minolta
-        L"3fr", // Hasselblad
-        L"ari", // ARRIRAW
-        L"bay", // Casio
-        L"cap", // Phase One
-        L"dcr", // Kodak
-        L"dcs", // Kodak
-        L"drf", // DNG+
-        L"eip", // Enhanced Image Package, Phase One
-        L"erf", // Epson
-        L"fff", // Imacon/Hasselblad
-        L"gpr", // GoPro
-        L"iiq", // Phase One
-        L"k25", // Kodak
-        L"mdc", // Minolta
-        L"mef", // Mamiya
-        L"mos", // Leaf
-        L"nrw", // Nikon
-        L"ptx", // Pentax
-        L"r3d", // Red Digital Cinema
-        L"rwl", // Leica
-        L"rwz", // Leica
-        L"srw", // Samsung
+    // 文件头特征  部分格式需同时匹配两段，如 RIFF....WEBP
+    struct MagicSignature {
+        uint32_t offset;
+        string_view magic;
+        uint32_t offset2 = 0;
+        string_view magic2{};
     };
 
-    ImageDatabase() = default;
+    struct DecoderEntry {
+        Decoder decoder;
+        vector<wstring_view> exts;              // 小写扩展名
+        vector<MagicSignature> signatures;      // 任一匹配即认为是该格式，为空则只能按扩展名识别
+        uint32_t caps;
+    };
+
+    // 解码器注册表，也是支持的扩展名的唯一来源
+    static const vector<DecoderEntry> decoderTable;
+
+    static const unordered_set<wstring_view> supportExt;
+    static const unordered_set<wstring_view> supportRaw;
+
+    // 按文件头选择解码器，扩展名仅作为提示：扩展名对应的格式与文件头一致（或该格式无文件头特征）时优先，
+    // 否则取文件头匹配的格式，都不匹配则按扩展名，仍未知则交给 OpenCV
+    static const DecoderEntry& sniffDecoder(span<const uint8_t> buf, wstring_view ext);
+    static const DecoderEntry* findDecoderByExt(wstring_view ext);
+
+    // 只解析文件头获取尺寸/位深/帧数/方向，不解码像素。常见格式为微秒级，HEIF/AVIF/JXL/RAW 需经解码库解析容器，为毫秒级
+    // 未实现文件头解析的格式（jxr/wp2/svg/hdr/jp2/exr 等）返回无效结果，调用方按格式平均值估算
+    static ImageProbe probe(const wstring& path);
+    static ImageProbe probe(span<const uint8_t> buf, const DecoderEntry& entry);
+
+    // 条目数上限由预读窗口决定：沿浏览方向最多 PREFETCH_MAX 张，另留当前图、反方向一张及刚离开的两张
+    ImageDatabase() {
+        setCapacity(PREFETCH_MAX + 4);
+    }
+
+    // 按设置计算图像缓存内存上限（字节）
+    static size_t getMemoryBudget();
+
+    // 按设置计算并发预读解码的线程数
+    static size_t getPreloadThreads();
+
+    // 依次以 1、2、4…N 个线程解码文件夹内的 BPG（单张图内按 WPP 行并行），返回各线程数的耗时，由测试程序 jarkViewerTest --bench-bpg=<文件夹> 调用
+    // 测试集须为启用 WPP（PPS 中 entropy_coding_sync_enabled_flag 为 1）编码的 BPG，未启用 WPP 的文件只能单线程解码，各线程数耗时相同
+    // 建议放入 20 张左右 2000 万像素以上的照片，另加带透明通道和 10 位的样本各数张，报告连同 CPU 型号一起记录
+    static std::string benchmarkBPG(wstring_view dirPath);
+
+    // --check-bpg-simd  逐个位深比对 HEVC 解码的 SIMD 函数与 C 版本的输出，返回检查结果
+    static std::string checkBPGSimd();
+
+    // 图像解码后实际占用的内存：primaryFrame、预览及所有动画帧
+    size_t valueBytes(const ImageAsset& imageAsset) const override;
+
+    // 内存紧张时释放原图只保留预览，需要原图时（放大超过预览分辨率、复制、保存等）再重新加载
+    std::shared_ptr<ImageAsset> shrinkValue(const ImageAsset& imageAsset) override;
+
+    // 原图边长至少为适应屏幕尺寸的此倍数才生成预览
+    static constexpr int PREVIEW_MIN_RATIO = 2;
+    static cv::Size getScreenSize();
+
+    // 像素按 EXIF 方向变换后的副本，用于导出/复制/打印，显示时由 drawCanvas 直接按方向取像素
+    static cv::Mat applyOrientation(const cv::Mat& img, int orientation);
+    // EXIF 方向 5~8 时宽高互换，存储尺寸与显示尺寸互相换算
+    static cv::Size orientedSize(cv::Size size, int orientation) {
+        return orientation >= 5 ? cv::Size(size.height, size.width) : size;
+    }
+    static void createPreview(ImageAsset& imageAsset);
+
+    // 全部帧超过此大小的常驻动画改为 FrameStore 压缩存储，取帧时再重建
+    static constexpr uint64_t FRAME_STORE_MIN_BYTES = 32ULL * 1024 * 1024;
+    static void compactFrames(ImageAsset& imageAsset);
+
+    // 缩小解码提示  scale < 1 时解码器可按其支持的缩小倍数解码，结果只作为预览，需要原图时再 reload 完整解码
+    struct DecodeHint {
+        double scale = 1.0;     // 适应屏幕所需的分辨率相对原图的比例
+        cv::Size fullSize{};    // 原图显示尺寸，来自 probe
+
+        bool isScaled() const { return scale < 1.0; }
+    };
+    ImageAsset makeScaledAsset(cv::Mat img, const DecodeHint& hint, string exifInfo, int orientation = 1);
+
+    // 预计解码耗时超过此值（按格式平均耗时与像素数估算）的图，先发布内嵌缩略图作为临时显示，完整结果就绪后替换
+    static constexpr double PROVISIONAL_MIN_MS = 150.0;
+    static bool isProvisionalAllowed();
+    bool isWorthProvisional(const wstring& path, double pixels);
+    ImageAsset makeProvisionalAsset(const cv::Mat& thumb, cv::Size displaySize, string exifInfo, int orientation = 1);
+    static bool hasEmbeddedThumbnail(const DecoderEntry& entry);
+    void publishThumbnail(const wstring& path, span<const uint8_t> fileBuf, const DecoderEntry& entry, const ImageProbe& probeInfo);
+
+    // 源文件的大小/修改时间/文件ID与解码时一致才有效，否则重新解码
+    bool isValueValid(const wstring& path, const ImageAsset& imageAsset) override;
+
+    // 加载超时或解码异常时显示错误提示图，不写入缓存
+    std::shared_ptr<ImageAsset> onWaitFailed(const wstring& path, LRUWaitStatus status, const std::string& errorMsg) override;
+
+    // 预读窗口沿浏览方向最多预读的张数
+    static constexpr int PREFETCH_MAX = 8;
+
+    // 按扩展名统计的平均解码耗时及解码后内存占用
+    struct DecodeStat {
+        double avgMs = 100.0;
+        double avgBytes = 48.0 * 1024 * 1024;   // 未统计过的格式按约 12MP BGRA 估算
+        double avgShrunkBytes = avgBytes;       // 内存紧张时缩减为预览后的占用，无预览则同 avgBytes
+        double avgPixels = 12.0 * 1000 * 1000;  // 像素数（动图为各帧之和），与文件头的尺寸相比可按比例估算单张的耗时和占用
+        int count = 0;
+    };
+    std::mutex decodeStatMutex;
+    std::unordered_map<wstring, DecodeStat> decodeStatMap;
+
+    // 预读窗口每次切图都会重新估算，文件头信息缓存起来避免反复打开文件
+    // 读取文件头可能较慢（映射文件、RAW/HEIF/JXL 解析容器），只在预读线程中进行，UI线程只查缓存
+    static constexpr size_t PROBE_CACHE_MAX = 4096;
+    std::mutex probeCacheMutex;
+    std::unordered_map<wstring, ImageProbe> probeCache;
+    unordered_set<wstring> probePending;    // 已提交到预读线程、尚未完成的文件头读取
+    ImageProbe getCachedProbe(const wstring& path);
+    bool tryGetCachedProbe(const wstring& path, ImageProbe& probeInfo);
+    void requestProbes(const vector<wstring>& paths);
+
+    void onLoadFinished(const wstring& path, const ImageAsset& imageAsset, double elapsedMs) override;
+    DecodeStat getDecodeStat(const wstring& path);
+
+    // 将缓存命中/淘汰、内存占用、预读队列等状态写入运行统计，导出前调用  curPath 为当前显示的图像，可为空
+    void updateMetrics(const wstring& curPath);
+
+    // 计算沿浏览方向的预读张数：aheadPaths 为前方依次的图像，switchIntervalMs 为近期切图间隔
+    // 窗口需足够深，使前方的图在被切到之前已解码完成，同时窗口内图像总内存不超出缓存上限
+    int getPrefetchCount(const wstring& curPath, const vector<wstring>& aheadPaths, double switchIntervalMs);
 
     cv::Mat errorTipsMatDeep, errorTipsMatLight, homeMatDeep, homeMatLight;
+    std::once_flag errorTipsMatOnce, homeMatOnce;  // 多个预读线程可能同时首次调用
+
+    DiskCache diskCache;
 
     cv::Mat getErrorTipsMat() {
-        if (errorTipsMatDeep.empty()) {
+        std::call_once(errorTipsMatOnce, [this] {
             auto rc = jarkUtils::GetResource(IDB_PNG_TIPS, L"PNG");
             cv::Mat imgData(1, (int)rc.size, CV_8UC1, (uint8_t*)rc.ptr);
             auto errorTipsMat = cv::imdecode(imgData, cv::IMREAD_UNCHANGED);
             errorTipsMatLight = errorTipsMat({ 0, 0, 800, 600 }).clone();
             errorTipsMatDeep = errorTipsMat({ 0, 600, 800, 600 }).clone();
-        }
+            });
         return GlobalVar::settingParameter.UI_Mode == 0 ?
             (GlobalVar::isSystemDarkMode ? errorTipsMatDeep : errorTipsMatLight) :
             (GlobalVar::settingParameter.UI_Mode == 1 ? errorTipsMatLight : errorTipsMatDeep);
@@ -170,13 +283,13 @@ public:
 
 
     cv::Mat getHomeMat() {
-        if (homeMatDeep.empty()) {
+        std::call_once(homeMatOnce, [this] {
             auto rc = jarkUtils::GetResource(IDB_PNG_HOME, L"PNG");
             cv::Mat imgData(1, (int)rc.size, CV_8UC1, (uint8_t*)rc.ptr);
             auto homeMat = cv::imdecode(imgData, cv::IMREAD_UNCHANGED);
             homeMatLight = homeMat({ 0, 0, 800, 600 }).clone();
             homeMatDeep = homeMat({ 0, 600, 800, 600 }).clone();
-        }
+            });
         return GlobalVar::settingParameter.UI_Mode == 0 ?
             (GlobalVar::isSystemDarkMode ? homeMatDeep : homeMatLight) :
             (GlobalVar::settingParameter.UI_Mode == 1 ? homeMatLight : homeMatDeep);
@@ -218,7 +331,7 @@ public:
     cv::Mat readDibFromMemory(const uint8_t* data, size_t size);
 
     // https://github.com/corkami/pics/blob/master/binary/ico_bmp.png
-    std::tuple<cv::Mat, string> loadICO(wstring_view path, const vector<uint8_t>& buf);
+    std::tuple<cv::Mat, string> loadICO(wstring_view path, span<const uint8_t> buf);
 
 
     template <typename T, typename DataHolder>
@@ -324,24 +437,37 @@ public:
 
 
     // https://github.com/MolecularMatters/psd_sdk
-    cv::Mat loadPSD(wstring_view path, const vector<uint8_t>& buf);
-    cv::Mat loadTGA_HDR(wstring_view path, const vector<uint8_t>& buf);
-    cv::Mat loadSVG(wstring_view path, const vector<uint8_t>& buf);
-    cv::Mat loadJXR(wstring_view path, const vector<uint8_t>& buf);
-    cv::Mat loadMat(wstring_view path, const vector<uint8_t>& buf);
-    cv::Mat loadPFM(wstring_view path, const vector<uint8_t>& buf);
-    cv::Mat loadQOI(wstring_view path, const vector<uint8_t>& buf);
-    cv::Mat loadHeic(wstring_view path, const vector<uint8_t>& buf);
-    cv::Mat loadAvif(wstring_view path, const vector<uint8_t>& buf);
-    cv::Mat loadRaw(wstring_view path, const vector<uint8_t>& buf);
-
-    ImageAsset loadJXL(wstring_view path, const vector<uint8_t>& buf);
-    ImageAsset loadWP2(wstring_view path, const std::vector<uint8_t>& buf);
-    ImageAsset loadBPG(wstring_view path, const std::vector<uchar>& buf);
-    ImageAsset loadLivp(wstring_view path, const std::vector<uchar>& buf);
-    ImageAsset loadMotionPhoto(wstring_view path, const std::vector<uchar>& buf, bool isJPG);
-    ImageAsset loadAnimation(wstring_view path, const vector<uint8_t>& buf);
-
-    void handleExifOrientation(int orientation, cv::Mat& img);
+    cv::Mat loadPSD(wstring_view path, span<const uint8_t> buf);
+    cv::Mat loadTGA_HDR(wstring_view path, span<const uint8_t> buf);
+    cv::Mat loadSVG(wstring_view path, span<const uint8_t> buf);
+    cv::Mat loadJXR(wstring_view path, span<const uint8_t> buf);
+    cv::Mat loadMat(wstring_view path, span<const uint8_t> buf, double scale = 1.0);
+    cv::Mat loadPFM(wstring_view path, span<const uint8_t> buf);
+    cv::Mat loadQOI(wstring_view path, span<const uint8_t> buf);
+    cv::Mat loadHeic(wstring_view path, span<const uint8_t> buf);
+    cv::Mat loadAvif(wstring_view path, span<const uint8_t> buf);
+    cv::Mat loadRaw(wstring_view path, span<const uint8_t> buf, double scale = 1.0);
+
+    // 内嵌预览的长边至少为适应屏幕尺寸的此比例才直接显示，如 6000px 的 RAW 在 1920 屏幕上可接受 1616px 的预览
+    static constexpr double RAW_PREVIEW_MIN_COVERAGE = 0.8;
+    ImageAsset loadRawPreview(wstring_view path, span<const uint8_t> buf);
+
+    ImageAsset loadJXL(wstring_view path, span<const uint8_t> buf);
+    ImageAsset loadWP2(wstring_view path, span<const uint8_t> buf);
+    int getBPGSliceThreads();
+    ImageAsset loadBPG(wstring_view path, span<const uint8_t> buf);
+    ImageAsset loadLivp(wstring_view path, span<const uint8_t> buf);
+    ImageAsset loadMotionPhoto(wstring_view path, span<const uint8_t> buf, bool isJPG, DecodeHint hint);
+    ImageAsset loadAnimation(wstring_view path, span<const uint8_t> buf);
+
+    // 全部帧解码后预计超过此大小的 GIF/JXL/WP2 动画改为流式解码，只在内存中缓冲播放位置附近的几帧
+    static constexpr uint64_t ANIMATION_STREAM_MIN_BYTES = 256ULL * 1024 * 1024;
+    ImageAsset loadAnimationStream(span<const uint8_t> buf, const DecoderEntry& entry);
+
+    bool isErrorTipsMat(const cv::Mat& img) const {
+        return !img.empty() && (img.data == errorTipsMatDeep.data || img.data == errorTipsMatLight.data);
+    }
+
+    ImageAsset decodeFile(const wstring& path, const MappedFile& file, const DecoderEntry* sniffedEntry, bool isFullResolution);
     ImageAsset loader(const wstring& path);
 };
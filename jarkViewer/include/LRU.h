@@ -1,101 +1,421 @@
 #pragma once
 #include <unordered_map>
+#include <algorithm>
 #include <list>
 #include <thread>
 #include <chrono>
 #include <mutex>
 #include <condition_variable>
-#include <queue>
 #include <atomic>
 #include <memory>
-#include <unordered_set>
 #include <shared_mutex>
+#include <string>
+#include <exception>
+#include <vector>
+#include <tuple>
+#include <functional>
+
+#include "thread_pool.h"
+
+// 等待缓存数据的结果
+enum class LRUWaitStatus {
+    Ready,      // 已取得数据
+    Timeout,    // 等待超时，加载仍未完成
+    Failed,     // loader 抛出异常，加载失败
+};
+
+// 预读取优先级，数值越小越先解码
+enum class LRUPriority : int {
+    Visible = 0,    // 当前显示
+    Next,           // 下一张
+    Previous,       // 上一张
+    Speculative,    // 其他推测预读
+};
+
+// 缓存运行统计
+struct LRUStats {
+    uint64_t hits = 0;          // 请求时已在缓存中
+    uint64_t misses = 0;        // 请求时需等待加载
+    uint64_t evictions = 0;     // 因条目数或内存上限被淘汰
+    uint64_t shrinks = 0;       // 内存紧张时被缩减
+    size_t queueDepth = 0;      // 排队中的预读请求数
+    size_t running = 0;         // 正在解码的任务数
+};
 
 template<typename keyType, typename valueType>
 class LRU {
 private:
     // 使用shared_ptr包装数据，确保数据不会被意外释放
     using ValuePtr = std::shared_ptr<valueType>;
-    using ListIterator = typename std::list<std::pair<keyType, ValuePtr>>::iterator;
+
+    struct CacheEntry {
+        keyType key;
+        ValuePtr value;
+        size_t bytes;   // 该条目实际占用内存字节数
+        bool provisional = false; // loader 完成前先行发布的临时值（如低分辨率缩略图），加载完成后被替换
+    };
+    using ListIterator = typename std::list<CacheEntry>::iterator;
 
     // 原有的缓存结构，但使用shared_ptr
     std::unordered_map<keyType, ListIterator> cache_map;
-    std::list<std::pair<keyType, ValuePtr>> cache_list;
+    std::list<CacheEntry> cache_list;
     size_t CAPACITY = 5;
 
-    // 预读取相关的成员
-    std::thread preload_thread;
-    std::queue<keyType> preload_queue;
-    std::unordered_set<keyType> preload_pending;
+    // 按内存占用淘汰  当前显示的key（active_key）始终保留且不缩减，不依赖其在LRU中的位置：
+    // 预读窗口中的图陆续完成并移到最前，当前图在链表中的位置会被推后
+    // 最近写入的一个条目同样保留，保证等待它的调用者能取得数据
+    size_t MEMORY_BUDGET = SIZE_MAX;
+    size_t cache_bytes = 0;
+    keyType active_key{};
+    bool has_active_key = false;
+
+    // 预读取相关的成员  多个解码任务在线程池中并发执行，同一key只解码一次
+    using PreloadPool = dp::thread_pool<>;
+    static constexpr size_t DEFAULT_PRELOAD_THREADS = 2;
+    std::unique_ptr<PreloadPool> preload_pool;
+    std::shared_ptr<std::atomic<size_t>> preload_pending = std::make_shared<std::atomic<size_t>>(0); // 已提交到 preload_pool 且尚未结束的任务数
+    // 调整线程数后替换下来的线程池，可能仍有解码在进行，任务全部结束后在下一轮预读时回收
+    struct RetiredPool {
+        std::unique_ptr<PreloadPool> pool;
+        std::shared_ptr<std::atomic<size_t>> pending;
+    };
+    std::vector<RetiredPool> retired_pools;
+
+    // 排队中的请求  每轮切图开启新一代(generation)，上一代未被再次请求的排队项直接丢弃
+    struct PreloadRequest {
+        LRUPriority priority;
+        uint64_t generation;
+        uint64_t seq;       // 同优先级按请求先后
+        bool reload = false; // 即使已缓存也重新加载
+    };
+    // 正在解码的任务  不再需要时置位 cancelled，解码器通过进度/取消回调尽早中止，结果丢弃
+    struct PreloadJob {
+        std::atomic<bool> cancelled{ false };
+        uint64_t generation = 0;
+        bool reload = false;
+    };
+    std::unordered_map<keyType, PreloadRequest> preload_queue;
+    std::unordered_map<keyType, std::shared_ptr<PreloadJob>> preload_running;
+    uint64_t preload_generation = 0;
+    uint64_t preload_seq = 0;
+    static inline thread_local const std::atomic<bool>* tls_cancel_flag = nullptr; // 当前线程正在执行的解码任务的取消标志
+    static inline thread_local bool tls_is_reload = false; // 当前线程正在执行的解码任务由 reload 发起
+    static inline thread_local ValuePtr tls_provisional; // 当前线程正在执行的解码任务已发布的临时值
+
     mutable std::shared_mutex cache_mutex;  // 使用读写锁提高性能
     std::mutex preload_mutex;
-    std::condition_variable preload_cv;
     std::atomic<bool> stop_preload{ false };
 
-    // 预读取工作线程函数
-    void preloadWorker() {
-        while (!stop_preload) {
-            std::unique_lock<std::mutex> lock(preload_mutex);
-            preload_cv.wait(lock, [this] { return !preload_queue.empty() || stop_preload; });
+    // 加载完成/失败通知  每完成一次加载 load_epoch 自增并唤醒所有等待者
+    std::mutex wait_mutex;
+    std::condition_variable wait_cv;
+    uint64_t load_epoch = 0;
+    std::unordered_map<keyType, std::string> failed_map; // 加载失败的key及原因
 
-            if (stop_preload) break;
+    std::atomic<uint64_t> stat_hits{ 0 }, stat_misses{ 0 }, stat_evictions{ 0 }, stat_shrinks{ 0 };
 
-            auto loadingKey = preload_queue.front();
+    void notifyWaiters() {
+        {
+            std::lock_guard<std::mutex> lock(wait_mutex);
+            ++load_epoch;
+        }
+        wait_cv.notify_all();
+    }
 
-            {
-                std::shared_lock<std::shared_mutex> cache_lock(cache_mutex);
-                if (cache_map.contains(loadingKey)) {
-                    preload_queue.pop();
-                    preload_pending.erase(loadingKey);
-                    continue;
-                }
+    void clearFailed(const keyType& key) {
+        std::lock_guard<std::mutex> lock(wait_mutex);
+        failed_map.erase(key);
+    }
+
+    std::shared_ptr<valueType> waitOrFallback(const keyType& key) {
+        LRUWaitStatus status;
+        std::string errorMsg;
+        auto ptr = getDataPtr(key, &status, &errorMsg);
+        if (status == LRUWaitStatus::Ready)
+            return ptr;
+        return onWaitFailed(key, status, errorMsg);
+    }
+
+    // 预读取任务  每个入队的key对应一个任务，取出优先级最高的key解码，完成后唤醒等待者
+    void preloadOne() {
+        if (stop_preload)
+            return;
+
+        keyType loadingKey;
+        bool isReload = false;
+        auto job = std::make_shared<PreloadJob>();
+        {
+            std::lock_guard<std::mutex> lock(preload_mutex);
+            if (preload_queue.empty()) // 已被丢弃或clear
+                return;
+
+            auto best = preload_queue.begin();
+            for (auto it = std::next(best); it != preload_queue.end(); ++it) {
+                if (std::tie(it->second.priority, it->second.seq) < std::tie(best->second.priority, best->second.seq))
+                    best = it;
             }
-            lock.unlock();
+            loadingKey = best->first;
+            job->generation = best->second.generation;
+            isReload = best->second.reload;
+            job->reload = isReload;
+            preload_queue.erase(best);
 
+            std::shared_lock<std::shared_mutex> cache_lock(cache_mutex);
+            if (!isReload && isCachedFinalLocked(loadingKey))
+                return;
+
+            // reload 取代仍在进行的普通加载，后者的结果已不需要，避免其较晚完成时覆盖完整数据
+            auto& runningJob = preload_running[loadingKey];
+            if (runningJob)
+                runningJob->cancelled = true;
+            runningJob = job;
+        }
 
+        std::string errorMsg;
+        bool isPut = false;
+        try {
+            const auto startTime = std::chrono::steady_clock::now();
+            tls_cancel_flag = &job->cancelled;
+            tls_is_reload = isReload;
             valueType value = loader(loadingKey);
-            auto value_ptr = std::make_shared<valueType>(std::move(value));
+            tls_cancel_flag = nullptr;
+            tls_is_reload = false;
 
-            {
+            if (!job->cancelled) {
+                const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+                onLoadFinished(loadingKey, value, elapsedMs);
+
+                auto value_ptr = std::make_shared<valueType>(std::move(value));
                 std::unique_lock<std::shared_mutex> cache_lock(cache_mutex);
                 putInternal(loadingKey, value_ptr);
+                isPut = true;
+            }
+        }
+        catch (const std::exception& e) {
+            errorMsg = e.what();
+            if (errorMsg.empty())
+                errorMsg = "unknown exception";
+        }
+        catch (...) {
+            errorMsg = "unknown exception";
+        }
+        tls_cancel_flag = nullptr;
+        tls_is_reload = false;
+
+        // 加载被取消或失败，移除本任务发布的临时值，下次访问重新加载
+        if (tls_provisional) {
+            if (!isPut) {
+                std::unique_lock<std::shared_mutex> cache_lock(cache_mutex);
+                auto it = cache_map.find(loadingKey);
+                if (it != cache_map.end() && it->second->value == tls_provisional)
+                    eraseInternal(it);
+            }
+            tls_provisional.reset();
+        }
+
+        if (!errorMsg.empty() && !job->cancelled) {
+            std::lock_guard<std::mutex> wait_lock(wait_mutex);
+            failed_map[loadingKey] = std::move(errorMsg);
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(preload_mutex);
+            auto it = preload_running.find(loadingKey);
+            if (it != preload_running.end() && it->second == job)
+                preload_running.erase(it);
+        }
+
+        notifyWaiters();
+    }
+
+    // 已缓存且不是临时值，需持有 cache_mutex
+    bool isCachedFinalLocked(const keyType& key) const {
+        auto it = cache_map.find(key);
+        return it != cache_map.end() && !it->second->provisional;
+    }
+
+    // 排队中或正在解码（且未被取消），需持有 preload_mutex
+    bool isPendingLocked(const keyType& key) const {
+        if (preload_queue.contains(key))
+            return true;
+        auto it = preload_running.find(key);
+        return it != preload_running.end() && !it->second->cancelled;
+    }
+
+    // 以当前代请求一个key，需持有 preload_mutex  reload 为 true 时即使已缓存也重新加载
+    void requestLocked(const keyType& key, LRUPriority priority, bool reload = false) {
+        // 正在进行的普通加载可能给不出 reload 需要的完整数据（如缩小解码），此时另排一次 reload
+        auto runningIt = preload_running.find(key);
+        if (runningIt != preload_running.end() && !runningIt->second->cancelled && (!reload || runningIt->second->reload)) {
+            runningIt->second->generation = preload_generation;
+            return;
+        }
+
+        auto queueIt = preload_queue.find(key);
+        if (queueIt != preload_queue.end()) {
+            auto& request = queueIt->second;
+            if (request.generation != preload_generation || priority < request.priority)
+                request.priority = priority;
+            request.generation = preload_generation;
+            request.reload = request.reload || reload;
+            return;
+        }
+
+        // 已缓存的值在加锁前已由 dropStaleValues 校验，过期的已移出缓存  临时值没有对应的加载任务时重新加载
+        if (!reload) {
+            std::shared_lock<std::shared_mutex> cache_lock(cache_mutex);
+            if (isCachedFinalLocked(key))
+                return;
+        }
+
+        clearFailed(key);
+        preload_queue[key] = { priority, preload_generation, preload_seq++, reload };
+        enqueuePreloadLocked();
+    }
+
+    // 校验这些key已缓存的值，过期的移出缓存，之后的请求会重新加载
+    // isValueValid 可能访问文件（如 stat），须在不持有任何锁时调用：先在锁内取出候选，校验后再加锁移除
+    void dropStaleValues(const std::vector<keyType>& keys) {
+        std::vector<std::pair<keyType, ValuePtr>> cached;
+        {
+            std::shared_lock<std::shared_mutex> cache_lock(cache_mutex);
+            for (const auto& key : keys) {
+                auto it = cache_map.find(key);
+                if (it != cache_map.end() && !it->second->provisional)
+                    cached.emplace_back(key, it->second->value);
             }
+        }
 
-            lock.lock();
-            preload_queue.pop();
-            preload_pending.erase(loadingKey);
-            lock.unlock();
+        std::erase_if(cached, [this](const auto& item) { return isValueValid(item.first, *item.second); });
+        if (cached.empty())
+            return;
+
+        std::unique_lock<std::shared_mutex> cache_lock(cache_mutex);
+        for (const auto& [key, value] : cached) {
+            auto it = cache_map.find(key);
+            if (it != cache_map.end() && it->second->value == value) // 期间未被新值替换
+                eraseInternal(it);
         }
     }
 
+    // 向当前线程池提交一个预读任务，需持有 preload_mutex
+    void enqueuePreloadLocked() {
+        if (!preload_pool)
+            return;
+        preload_pending->fetch_add(1, std::memory_order_relaxed);
+        preload_pool->enqueue_detach([this, pending = preload_pending] {
+            preloadOne();
+            pending->fetch_sub(1, std::memory_order_release);
+            });
+    }
+
+    // 取出任务已全部结束的旧线程池，需持有 preload_mutex  返回值应在释放锁后析构（等待线程退出）
+    std::vector<RetiredPool> takeIdleRetiredPoolsLocked() {
+        std::vector<RetiredPool> idle;
+        for (auto it = retired_pools.begin(); it != retired_pools.end(); ) {
+            if (it->pending->load(std::memory_order_acquire) == 0) {
+                idle.push_back(std::move(*it));
+                it = retired_pools.erase(it);
+            }
+            else {
+                ++it;
+            }
+        }
+        return idle;
+    }
+
+    // 取消所有正在解码的任务，需持有 preload_mutex
+    void cancelAllLocked() {
+        for (auto& [key, job] : preload_running)
+            job->cancelled = true;
+        preload_running.clear();
+    }
+
     // 内部put函数，不加锁版本
-    void putInternal(const keyType& key, ValuePtr value_ptr) {
+    void putInternal(const keyType& key, ValuePtr value_ptr, bool provisional = false) {
+        const size_t bytes = value_ptr ? valueBytes(*value_ptr) : 0;
+
         auto it = cache_map.find(key);
         if (it != cache_map.end()) {
-            it->second->second = value_ptr;
+            cache_bytes = cache_bytes - it->second->bytes + bytes;
+            it->second->value = value_ptr;
+            it->second->bytes = bytes;
+            it->second->provisional = provisional;
             cache_list.splice(cache_list.begin(), cache_list, it->second);
         }
         else {
-            if (cache_map.size() >= CAPACITY) {
-                cache_map.erase(cache_list.back().first);
-                cache_list.pop_back();
-            }
-            cache_list.emplace_front(key, value_ptr);
+            cache_list.emplace_front(key, value_ptr, bytes, provisional);
             cache_map[key] = cache_list.begin();
+            cache_bytes += bytes;
         }
+
+        evictInternal();
+    }
+
+    // 不受缩减和淘汰的条目：当前显示的key，以及最近写入的条目
+    bool isPinnedLocked(ListIterator it) const {
+        return it == cache_list.begin() || (has_active_key && it->key == active_key);
+    }
+
+    // 内部淘汰函数，不加锁版本  条目数或内存占用超出上限时淘汰最久未使用的条目
+    // 内存超出上限时先将较久未使用的条目缩减（shrinkValue），仍超出才整条淘汰
+    void evictInternal() {
+        for (auto it = cache_list.end(); it != cache_list.begin() && cache_bytes > MEMORY_BUDGET; ) {
+            --it;
+            if (isPinnedLocked(it))
+                continue;
+            auto shrunkValue = it->value ? shrinkValue(*it->value) : nullptr;
+            if (!shrunkValue)
+                continue;
+
+            const size_t bytes = valueBytes(*shrunkValue);
+            if (bytes >= it->bytes)
+                continue;
+            cache_bytes = cache_bytes - it->bytes + bytes;
+            it->value = std::move(shrunkValue);
+            it->bytes = bytes;
+            stat_shrinks.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        for (auto it = cache_list.end(); it != cache_list.begin() &&
+            (cache_list.size() > CAPACITY || cache_bytes > MEMORY_BUDGET); ) {
+            auto victim = std::prev(it);
+            if (isPinnedLocked(victim)) {
+                it = victim;
+                continue;
+            }
+            eraseInternal(cache_map.find(victim->key));
+            stat_evictions.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // 内部删除函数，不加锁版本
+    void eraseInternal(typename std::unordered_map<keyType, ListIterator>::iterator mapIt) {
+        cache_bytes -= mapIt->second->bytes;
+        cache_list.erase(mapIt->second);
+        cache_map.erase(mapIt);
     }
 
 public:
     LRU() {
-        preload_thread = std::thread(&LRU::preloadWorker, this);
+        preload_pool = std::make_unique<PreloadPool>((unsigned int)DEFAULT_PRELOAD_THREADS);
     }
 
     virtual ~LRU() {
         stop_preload = true;
-        preload_cv.notify_all();
-        if (preload_thread.joinable()) {
-            preload_thread.join();
+        notifyWaiters();
+
+        std::unique_ptr<PreloadPool> pool;
+        std::vector<RetiredPool> retired;
+        {
+            std::lock_guard<std::mutex> lock(preload_mutex);
+            preload_queue.clear();
+            cancelAllLocked();
+            pool = std::move(preload_pool);
+            retired = std::move(retired_pools);
         }
+        pool.reset();   // 等待正在进行的解码结束
+        retired.clear();
     }
 
     // 禁用拷贝构造和赋值
@@ -104,99 +424,269 @@ public:
 
     virtual valueType loader(const keyType&) = 0;
 
-    std::shared_ptr<valueType> getDataPtr(const keyType& key) {
-        int cnt_16ms = 0;
-        while (true) {
-            std::unique_lock<std::shared_mutex> lock(cache_mutex);
-            auto it = cache_map.find(key);
-            if (it != cache_map.end()) {
-                cache_list.splice(cache_list.begin(), cache_list, it->second);
-                return it->second->second;
-            }
-            lock.unlock();
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(10)); // 因windows系统限制 实际最小 15.625ms
-            if (++cnt_16ms > 3750) // 最多等60秒
-                break;
-        }
-        return nullptr;
+    // 当前线程正在执行的解码任务是否已被取消（不再需要），供 loader 中耗时的解码器轮询
+    static bool isLoadCancelled() {
+        return tls_cancel_flag && tls_cancel_flag->load(std::memory_order_relaxed);
     }
 
-    std::shared_ptr<valueType> getSafePtr(const keyType& key) {
-        requestPreload(key);
-        return getDataPtr(key);
+    // 当前解码任务的取消标志，可传给会在其他线程回调的解码器，非预读线程返回nullptr
+    static const std::atomic<bool>* loadCancelFlag() {
+        return tls_cancel_flag;
     }
 
-    std::shared_ptr<valueType> getSafePtr(const keyType& key, const keyType& nextKey) {
-        if (key == nextKey)
-            requestPreload(key);
-        else
-            requestPreloadBatch({ key, nextKey });
-
-        return getDataPtr(key);
+    // 当前解码任务由 reload 发起（已缓存的值不满足需要，如只剩缩减后的值），loader 应给出完整数据
+    static bool isReloadRequest() {
+        return tls_is_reload;
     }
 
-    // 请求预读取指定的key
-    void requestPreload(const keyType& key) {
-        std::lock_guard<std::mutex> lock(preload_mutex);
-
-        if (preload_pending.contains(key))
+    // 在 loader 中调用：完整结果就绪前先发布一个临时值（如内嵌缩略图），等待该key的调用者立即取得它
+    // loader 完成后被最终结果原子替换，加载被取消或失败则移除  缓存中已有正式值（如 reload 时的旧值）时不发布
+    void publishProvisional(const keyType& key, valueType&& value) {
+        if (!tls_cancel_flag || isLoadCancelled())
             return;
 
-        // 使用读锁检查缓存
+        auto value_ptr = std::make_shared<valueType>(std::move(value));
         {
-            std::shared_lock<std::shared_mutex> cache_lock(cache_mutex);
-            if (cache_map.contains(key)) {
+            std::unique_lock<std::shared_mutex> cache_lock(cache_mutex);
+            if (isCachedFinalLocked(key))
                 return;
-            }
+            putInternal(key, value_ptr, true);
         }
+        tls_provisional = std::move(value_ptr);
+        notifyWaiters();
+    }
+
+    // 请求已缓存的key时调用，返回false表示缓存值已过期（例如源文件已被修改），将被丢弃并重新加载
+    virtual bool isValueValid(const keyType&, const valueType&) { return true; }
+
+    // 一次加载成功完成（未被取消）后调用，可用于统计解码耗时，在预读线程中执行
+    virtual void onLoadFinished(const keyType&, const valueType&, double /*elapsedMs*/) {}
+
+    // 计算一个缓存值实际占用的内存字节数，用于按内存上限淘汰，默认不计
+    virtual size_t valueBytes(const valueType&) const { return 0; }
 
-        preload_queue.push(key);
-        preload_pending.insert(key);
-        preload_cv.notify_one();
+    // 内存紧张时调用，返回占用更少内存的替代值（例如只保留低分辨率预览），不能缩减则返回nullptr
+    // 在持有缓存锁时调用，须轻量且不可访问缓存
+    virtual std::shared_ptr<valueType> shrinkValue(const valueType&) { return nullptr; }
+
+    // 等待超时或加载失败时调用，返回值作为 getSafePtr 的结果（不写入缓存，下次访问会重新加载）
+    virtual std::shared_ptr<valueType> onWaitFailed(const keyType&, LRUWaitStatus, const std::string&) {
+        return nullptr;
     }
 
-    // 批量预读取
-    void requestPreloadBatch(const std::vector<keyType>& keys) {
-        std::lock_guard<std::mutex> lock(preload_mutex);
+    // 等待key对应的数据就绪，加载完成时立即被唤醒  超时或失败时返回nullptr，结果写入status/errorMsg
+    std::shared_ptr<valueType> getDataPtr(const keyType& key,
+        LRUWaitStatus* status = nullptr,
+        std::string* errorMsg = nullptr,
+        std::chrono::milliseconds timeout = std::chrono::seconds(60)) {
+        return waitForValue(key, nullptr, status, errorMsg, timeout);
+    }
 
-        for (const auto& key : keys) {
-            if (preload_pending.find(key) != preload_pending.end()) {
-                continue;
+    // 重新加载并等待新值就绪（例如缓存中只剩缩减后的值，而当前操作需要完整数据）  超时或失败时返回nullptr
+    std::shared_ptr<valueType> getReloadedPtr(const keyType& key,
+        LRUWaitStatus* status = nullptr,
+        std::string* errorMsg = nullptr,
+        std::chrono::milliseconds timeout = std::chrono::seconds(60)) {
+        auto staleValue = tryGetDataPtr(key);
+        reload(key);
+        return waitForValue(key, staleValue, status, errorMsg, timeout);
+    }
+
+    // 不等待，仅返回当前已缓存的值，未缓存返回nullptr
+    std::shared_ptr<valueType> tryGetDataPtr(const keyType& key) const {
+        std::shared_lock<std::shared_mutex> lock(cache_mutex);
+        auto it = cache_map.find(key);
+        return it == cache_map.end() ? nullptr : it->second->value;
+    }
+
+    // 缓存中的值是 loader 先行发布的临时值，完整结果尚未就绪
+    bool isProvisional(const keyType& key) const {
+        std::shared_lock<std::shared_mutex> lock(cache_mutex);
+        auto it = cache_map.find(key);
+        return it != cache_map.end() && it->second->provisional;
+    }
+
+    // 不等待，仅查询key最近一次加载是否失败，失败时原因写入errorMsg  下次 getSafePtr 会清除失败记录并重新加载
+    bool isFailed(const keyType& key, std::string* errorMsg = nullptr) {
+        std::lock_guard<std::mutex> wait_lock(wait_mutex);
+        auto it = failed_map.find(key);
+        if (it == failed_map.end())
+            return false;
+        if (errorMsg)
+            *errorMsg = it->second;
+        return true;
+    }
+
+private:
+    // 等待缓存中出现key对应且不同于 staleValue 的值
+    std::shared_ptr<valueType> waitForValue(const keyType& key,
+        const ValuePtr& staleValue,
+        LRUWaitStatus* status,
+        std::string* errorMsg,
+        std::chrono::milliseconds timeout) {
+        auto setResult = [&](LRUWaitStatus s, std::string msg = {}) {
+            if (status) *status = s;
+            if (errorMsg) *errorMsg = std::move(msg);
+        };
+        const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+        bool isFirstCheck = true;
+        while (true) {
+            uint64_t seenEpoch;
+            {
+                std::lock_guard<std::mutex> wait_lock(wait_mutex);
+                seenEpoch = load_epoch;
+                auto failedIt = failed_map.find(key);
+                if (failedIt != failed_map.end()) {
+                    setResult(LRUWaitStatus::Failed, failedIt->second);
+                    return nullptr;
+                }
             }
 
             {
-                std::shared_lock<std::shared_mutex> cache_lock(cache_mutex);
-                if (cache_map.find(key) != cache_map.end()) {
-                    continue;
+                std::unique_lock<std::shared_mutex> lock(cache_mutex);
+                auto it = cache_map.find(key);
+                if (it != cache_map.end() && it->second->value != staleValue) {
+                    if (isFirstCheck)
+                        stat_hits.fetch_add(1, std::memory_order_relaxed);
+                    cache_list.splice(cache_list.begin(), cache_list, it->second);
+                    setResult(LRUWaitStatus::Ready);
+                    return it->second->value;
                 }
             }
 
-            preload_queue.push(key);
-            preload_pending.insert(key);
-        }
+            if (isFirstCheck) {
+                isFirstCheck = false;
+                stat_misses.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            // 既不在缓存也不在加载队列（未请求、已被淘汰或被clear），补发一次加载请求
+            bool isPending;
+            {
+                std::lock_guard<std::mutex> lock(preload_mutex);
+                isPending = isPendingLocked(key);
+            }
+            if (!isPending) {
+                if (staleValue)
+                    reload(key);
+                else
+                    requestPreload(key);
+            }
 
-        if (!keys.empty()) {
-            preload_cv.notify_all();
+            std::unique_lock<std::mutex> wait_lock(wait_mutex);
+            if (!wait_cv.wait_until(wait_lock, deadline, [&] { return load_epoch != seenEpoch || stop_preload; })) {
+                setResult(LRUWaitStatus::Timeout, "timeout");
+                return nullptr;
+            }
+            if (stop_preload) {
+                setResult(LRUWaitStatus::Failed, "stopped");
+                return nullptr;
+            }
         }
     }
 
+public:
+    std::shared_ptr<valueType> getSafePtr(const keyType& key) {
+        requestPreload(key);
+        return waitOrFallback(key);
+    }
+
+    // 切换图像时使用：开启新一轮预读，当前图最高优先级，nextKey 次之
+    std::shared_ptr<valueType> getSafePtr(const keyType& key, const keyType& nextKey) {
+        setActiveKey(key);
+        beginPreloadGeneration({ { key, LRUPriority::Visible }, { nextKey, LRUPriority::Next } });
+        return waitOrFallback(key);
+    }
+
+    // 切换图像时使用：开启新一轮预读，requests 为预读窗口内的其他key及其优先级
+    std::shared_ptr<valueType> getSafePtr(const keyType& key, std::vector<std::pair<keyType, LRUPriority>> requests) {
+        setActiveKey(key);
+        requests.insert(requests.begin(), { key, LRUPriority::Visible });
+        beginPreloadGeneration(requests);
+        return waitOrFallback(key);
+    }
+
+    // 设置当前显示的key，它不会因内存上限被缩减或淘汰，也不会因条目数被淘汰
+    void setActiveKey(const keyType& key) {
+        std::unique_lock<std::shared_mutex> lock(cache_mutex);
+        active_key = key;
+        has_active_key = true;
+    }
+
+    // 开启新一代预读请求：按给定优先级请求这些key，上一代未被再次请求的排队项丢弃，正在解码的取消
+    void beginPreloadGeneration(const std::vector<std::pair<keyType, LRUPriority>>& requests) {
+        std::vector<keyType> keys;
+        keys.reserve(requests.size());
+        for (const auto& [key, priority] : requests)
+            keys.push_back(key);
+        dropStaleValues(keys);
+
+        std::vector<RetiredPool> idlePools; // 在释放 preload_mutex 后析构
+        std::lock_guard<std::mutex> lock(preload_mutex);
+        idlePools = takeIdleRetiredPoolsLocked();
+        ++preload_generation;
+
+        for (const auto& [key, priority] : requests)
+            requestLocked(key, priority);
+
+        std::erase_if(preload_queue, [this](const auto& item) {
+            return item.second.generation != preload_generation;
+            });
+        std::erase_if(preload_running, [this](const auto& item) {
+            if (item.second->generation == preload_generation)
+                return false;
+            item.second->cancelled = true;
+            return true;
+            });
+    }
+
+    // 请求预读取指定的key（归入当前代）  若此前加载失败则清除失败记录并重试
+    void requestPreload(const keyType& key, LRUPriority priority = LRUPriority::Visible) {
+        dropStaleValues({ key });
+        std::lock_guard<std::mutex> lock(preload_mutex);
+        requestLocked(key, priority);
+    }
+
+    // 已缓存也重新加载（例如缓存中只剩缩减后的值），新值就绪前缓存中仍保留旧值
+    void reload(const keyType& key, LRUPriority priority = LRUPriority::Visible) {
+        std::lock_guard<std::mutex> lock(preload_mutex);
+        requestLocked(key, priority, true);
+    }
+
+    // 批量预读取
+    void requestPreloadBatch(const std::vector<keyType>& keys, LRUPriority priority = LRUPriority::Speculative) {
+        dropStaleValues(keys);
+        std::lock_guard<std::mutex> lock(preload_mutex);
+        for (const auto& key : keys)
+            requestLocked(key, priority);
+    }
+
     void put(const keyType& key, valueType&& value) {
         auto value_ptr = std::make_shared<valueType>(std::move(value));
-        std::unique_lock<std::shared_mutex> lock(cache_mutex);
-        putInternal(key, value_ptr);
+        {
+            std::unique_lock<std::shared_mutex> lock(cache_mutex);
+            putInternal(key, value_ptr);
+        }
+        clearFailed(key);
+        notifyWaiters();
     }
 
     void clear() {
+        std::lock_guard<std::mutex> preload_lock(preload_mutex);  // 与 requestPreload 保持相同加锁顺序
         std::unique_lock<std::shared_mutex> cache_lock(cache_mutex);
-        std::lock_guard<std::mutex> preload_lock(preload_mutex);
 
         cache_map.clear();
         cache_list.clear();
+        cache_bytes = 0;
+        active_key = {};
+        has_active_key = false;
+
+        preload_queue.clear();
+        cancelAllLocked();
+        ++preload_generation;
 
-        std::queue<keyType> empty_queue;
-        preload_queue.swap(empty_queue);
-        preload_pending.clear();
+        std::lock_guard<std::mutex> wait_lock(wait_mutex);
+        failed_map.clear();
     }
 
     size_t size() const {
@@ -204,16 +694,94 @@ public:
         return cache_map.size();
     }
 
+    size_t capacity() const {
+        std::shared_lock<std::shared_mutex> lock(cache_mutex);
+        return CAPACITY;
+    }
+
     void setCapacity(size_t capacity) {
         if (capacity < 3 || capacity > 4096)
             capacity = 3;
 
         std::unique_lock<std::shared_mutex> lock(cache_mutex);
         CAPACITY = capacity;
+        evictInternal();
+    }
 
-        while (cache_map.size() > CAPACITY) {
-            cache_map.erase(cache_list.back().first);
-            cache_list.pop_back();
-        }
+    // 设置并发预读取（解码）的线程数  0 表示默认值
+    void setPreloadThreads(size_t threads) {
+        if (threads == 0)
+            threads = DEFAULT_PRELOAD_THREADS;
+        threads = std::min<size_t>(threads, 64);
+
+        std::vector<RetiredPool> idlePools; // 在释放 preload_mutex 后析构
+        std::lock_guard<std::mutex> lock(preload_mutex);
+        idlePools = takeIdleRetiredPoolsLocked();
+        if (stop_preload || (preload_pool && preload_pool->size() == threads))
+            return;
+
+        // 旧线程池中正在进行的解码不打断，完成后照常写入缓存；为仍在排队的key在新线程池补充任务
+        if (preload_pool)
+            retired_pools.push_back({ std::move(preload_pool), std::move(preload_pending) });
+        preload_pool = std::make_unique<PreloadPool>((unsigned int)threads);
+        preload_pending = std::make_shared<std::atomic<size_t>>(0);
+        for (size_t i = 0; i < preload_queue.size(); i++)
+            enqueuePreloadLocked();
+    }
+
+    // 在预读线程池中执行一个轻量的后台任务（如读取文件头），不参与优先级排序  停止预读后不再执行
+    void runOnPreloadThread(std::function<void()> task) {
+        std::lock_guard<std::mutex> lock(preload_mutex);
+        if (stop_preload || !preload_pool)
+            return;
+        preload_pending->fetch_add(1, std::memory_order_relaxed);
+        preload_pool->enqueue_detach([this, task = std::move(task), pending = preload_pending] {
+            if (!stop_preload)
+                task();
+            pending->fetch_sub(1, std::memory_order_release);
+            });
+    }
+
+    size_t preloadThreads() {
+        std::lock_guard<std::mutex> lock(preload_mutex);
+        return preload_pool ? preload_pool->size() : 0;
+    }
+
+    // 设置缓存内存上限（字节），0 表示不限制
+    void setMemoryBudget(size_t bytes) {
+        std::unique_lock<std::shared_mutex> lock(cache_mutex);
+        MEMORY_BUDGET = bytes == 0 ? SIZE_MAX : bytes;
+        evictInternal();
+    }
+
+    size_t memoryBudget() const {
+        std::shared_lock<std::shared_mutex> lock(cache_mutex);
+        return MEMORY_BUDGET;
+    }
+
+    // 当前缓存的全部条目占用的内存字节数
+    size_t memoryUsage() const {
+        std::shared_lock<std::shared_mutex> lock(cache_mutex);
+        return cache_bytes;
+    }
+
+    LRUStats stats() {
+        LRUStats ret;
+        ret.hits = stat_hits.load(std::memory_order_relaxed);
+        ret.misses = stat_misses.load(std::memory_order_relaxed);
+        ret.evictions = stat_evictions.load(std::memory_order_relaxed);
+        ret.shrinks = stat_shrinks.load(std::memory_order_relaxed);
+
+        std::lock_guard<std::mutex> lock(preload_mutex);
+        ret.queueDepth = preload_queue.size();
+        ret.running = preload_running.size();
+        return ret;
+    }
+
+    // 指定条目占用的内存字节数，不在缓存中则返回 0
+    size_t entryBytes(const keyType& key) const {
+        std::shared_lock<std::shared_mutex> lock(cache_mutex);
+        auto it = cache_map.find(key);
+        return it == cache_map.end() ? 0 : it->second->bytes;
     }
 };
@@ -0,0 +1,91 @@
+#pragma once
+#include "jarkUtils.h"
+#include <array>
+#include <map>
+
+/*
+* 运行统计（发布版同样启用）：按格式分阶段的加载耗时直方图、缓存命中/未命中/淘汰、内存占用、预读队列深度等
+* Ctrl+M 或启动参数 --dump-metrics=<文件路径> 导出为 JSON，便于收集不同机器上的数据
+* 加载耗时只含读取/解码/解析：EXIF 方向在绘制时变换，EXIF 信息文本在首次显示时生成，均不在加载中
+*/
+class Metrics {
+public:
+    enum class Stage : int {
+        Read = 0,       // 读取文件
+        Decode,         // 解码（总耗时减去其他阶段）
+        Exif,           // 解析 EXIF 为结构化记录  信息文本在首次显示时才生成，不计入加载耗时
+        DiskCache,      // 从磁盘缓存读取
+        Total,          // 一次加载的总耗时
+        Count,
+    };
+
+    // 耗时直方图  第 i 个桶统计耗时不超过 2^i ms 的样本，最后一个桶为更大的样本
+    struct Histogram {
+        static constexpr int BUCKETS = 16;
+        uint64_t count = 0;
+        double sumMs = 0;
+        double maxMs = 0;
+        std::array<uint64_t, BUCKETS + 1> buckets{};
+
+        void add(double ms);
+    };
+
+    // 一次图像加载的统计范围，其间各阶段计时累加，结束时按扩展名写入直方图
+    class LoadScope {
+    public:
+        explicit LoadScope(wstring_view ext);
+        ~LoadScope();
+
+        LoadScope(const LoadScope&) = delete;
+        LoadScope& operator=(const LoadScope&) = delete;
+
+        // 本次加载已被取消，结果不计入统计
+        void discard() { isDiscarded = true; }
+
+    private:
+        wstring ext;
+        std::array<double, (size_t)Stage::Count> stageMs{};
+        std::chrono::steady_clock::time_point startTime;
+        LoadScope* parent;
+        bool isDiscarded = false;
+
+        friend class Metrics;
+    };
+
+    // 阶段计时，累加到当前线程的 LoadScope，不在 LoadScope 内则不计
+    class StageTimer {
+    public:
+        explicit StageTimer(Stage stage) : stage(stage), startTime(std::chrono::steady_clock::now()) {}
+        ~StageTimer();
+
+        StageTimer(const StageTimer&) = delete;
+        StageTimer& operator=(const StageTimer&) = delete;
+
+    private:
+        Stage stage;
+        std::chrono::steady_clock::time_point startTime;
+    };
+
+    static void addCounter(string_view name, uint64_t delta = 1);
+    static void setGauge(string_view name, int64_t value);
+
+    static string toJson();
+    static bool dumpJson(const wstring& path);
+
+    // 默认导出路径 %LOCALAPPDATA%\jarkViewer\metrics\metrics_时间.json
+    static wstring defaultDumpPath();
+
+private:
+    static constexpr std::array<string_view, (size_t)Stage::Count> STAGE_NAMES{
+        "read", "decode", "exif", "diskCache", "total",
+    };
+
+    static inline std::mutex mutex;
+    static inline std::map<wstring, std::array<Histogram, (size_t)Stage::Count>> histograms;
+    static inline std::map<string, uint64_t, std::less<>> counters;
+    static inline std::map<string, int64_t, std::less<>> gauges;
+    static inline const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    static inline thread_local LoadScope* tlsScope = nullptr;
+
+    static void record(const LoadScope& scope);
+};
@@ -0,0 +1,40 @@
+#pragma once
+#include "jarkUtils.h"
+
+/*
+* 内存中的 MP4/MOV (ISO-BMFF) 解析，直接读取实况照片中的视频数据，不复制、不创建临时文件
+* 只解析第一条视频轨：帧数、尺寸、旋转及每帧时间戳
+*/
+
+struct Mp4VideoTrack {
+    uint32_t codec = 0;                 // 样本描述的四字符码，如 'hvc1' 'avc1'
+    int width = 0;                      // 编码尺寸，未旋转
+    int height = 0;
+    int rotation = 0;                   // tkhd 矩阵的顺时针旋转角度 0/90/180/270
+    uint32_t timescale = 0;             // mdhd 每秒的时间单位数
+    vector<int64_t> decodeTimes;        // 每个样本的解码时间（解码顺序）
+    vector<int32_t> compositionOffsets; // 显示时间相对解码时间的偏移，无 ctts 时为空
+    uint32_t lastDelta = 0;             // 最后一个样本的时长
+
+    int sampleCount() const { return (int)decodeTimes.size(); }
+
+    // 旋转后的显示尺寸
+    cv::Size displaySize() const {
+        return (rotation == 90 || rotation == 270) ? cv::Size(height, width) : cv::Size(width, height);
+    }
+
+    // 按显示顺序每帧的时长(ms)，由容器时间戳计算
+    vector<int> frameDurationsMs() const;
+};
+
+class Mp4Demuxer {
+public:
+    static constexpr int MAX_SAMPLES = 1 << 20; // 样本数上限，防止损坏的文件导致巨量分配
+
+    static constexpr uint32_t fourcc(const char(&s)[5]) {
+        return ((uint32_t)(uint8_t)s[0] << 24) | ((uint32_t)(uint8_t)s[1] << 16) | ((uint32_t)(uint8_t)s[2] << 8) | (uint8_t)s[3];
+    }
+
+    // 解析第一条视频轨，失败返回 false
+    static bool parseVideoTrack(span<const uint8_t> buf, Mp4VideoTrack& track);
+};
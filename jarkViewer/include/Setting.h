@@ -65,12 +65,16 @@ private:
                 { {50, 100, 180, 50}, "旋转动画", &GlobalVar::settingParameter.isAllowRotateAnimation },
                 { {50, 150, 180, 50}, "缩放动画", &GlobalVar::settingParameter.isAllowZoomAnimation },
                 { {50, 200, 760, 50}, "平移图像加速 (拖动图像时优化渲染速度，图像会微微失真)", &GlobalVar::settingParameter.isOptimizeSlide },
+                { {50, 250, 760, 50}, "磁盘缓存 (RAW/PSD/JXL/HEIC/AVIF等解码较慢的图像，再次打开更快)", &GlobalVar::settingParameter.isEnableDiskCache },
+                { {50, 300, 760, 50}, "RAW后台解码 (先显示内嵌预览，随后在后台替换为完整解码的原图)", &GlobalVar::settingParameter.isRawDecodeInBackground },
             };
         }
         if (generalTabRadioList.empty()) {
             generalTabRadioList = {
-                {{50, 300, 600, 50}, {"切图动画", "无动画", "上下滑动", "左右滑动"}, &GlobalVar::settingParameter.switchImageAnimationMode },
-                {{50, 360, 600, 50}, {"界面主题", "跟随系统", "浅色", "深色"}, &GlobalVar::settingParameter.UI_Mode },
+                {{50, 350, 600, 50}, {"切图动画", "无动画", "上下滑动", "左右滑动"}, &GlobalVar::settingParameter.switchImageAnimationMode },
+                {{50, 410, 600, 50}, {"界面主题", "跟随系统", "浅色", "深色"}, &GlobalVar::settingParameter.UI_Mode },
+                {{50, 470, 600, 50}, {"缓存上限", "自动", "1GB", "2GB", "4GB"}, &GlobalVar::settingParameter.cacheMemoryMode },
+                {{50, 530, 600, 50}, {"预读线程", "自动", "1", "2", "4", "8"}, &GlobalVar::settingParameter.preloadThreadsMode },
             };
         }
 
@@ -251,6 +255,12 @@ public:
                         if (radio.text.front() == "界面主题") {
                             GlobalVar::isNeedUpdateTheme = true;
                         }
+                        else if (radio.text.front() == "缓存上限") {
+                            GlobalVar::isNeedUpdateCacheBudget = true;
+                        }
+                        else if (radio.text.front() == "预读线程") {
+                            GlobalVar::isNeedUpdatePreloadThreads = true;
+                        }
                     }
                 }
             }
@@ -1830,5 +1830,7 @@
 //#define USE_AV_LOG /* include av_log() */
 #define USE_FRAME_DURATION_SEI /* for animations */
 //#define USE_BIPRED /* allow bi-prediction */
+#define USE_WPP /* decode wavefront (WPP) rows in parallel on slice threads */
+#define USE_SIMD /* SSE2/AVX2 DSP functions, selected at run time */
 
 #endif /* FFMPEG_CONFIG_H */
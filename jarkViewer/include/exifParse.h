@@ -5,6 +5,30 @@
 #include "exiv2/exiv2.hpp"
 
 
+// 一个文件的元数据解析结果  加载流程需要的方向、实况视频长度在解析时取出，
+// 信息面板的文本在首次显示（或复制、写入磁盘缓存）时才生成，生成后释放结构化数据
+class ExifMetadata {
+public:
+    int orientation = 1;    // Exif.Image.Orientation 1~8，没有该字段或取值无效时为 1
+    size_t videoSize = 0;   // Android 实况照片附在文件末尾的视频字节数，0 为没有
+
+    // EXIF/XMP/IPTC/AI 提示词的全部文本，可在任意线程调用
+    const std::string& text();
+
+private:
+    friend class ExifParse;
+
+    std::wstring path;
+    Exiv2::ExifData exifData;
+    Exiv2::XmpData xmpData;
+    Exiv2::IptcData iptcData;
+    std::string prompt;
+
+    std::once_flag textOnce;
+    std::string textCache;
+};
+
+
 class ExifParse {
 public:
     static std::string getSimpleInfo(std::wstring_view path, int width, int height, const uint8_t* buf, size_t fileSize);
@@ -13,9 +37,20 @@ public:
     static std::string xmpDataToString(std::wstring_view path, const Exiv2::XmpData& xmpData);
     static std::string iptcDataToString(std::wstring_view path, const Exiv2::IptcData& IptcData);
     static std::string AI_Prompt(std::wstring_view path, const uint8_t* buf);
-    static std::string getExif(std::wstring_view path, const uint8_t* buf, size_t fileSize);
+
+    // 解析元数据，不生成文本  无法解析返回nullptr
+    static std::shared_ptr<ExifMetadata> parse(std::wstring_view path, const uint8_t* buf, size_t fileSize);
+
+    // Exiv2 全局初始化（XMP 工具包等），须在多线程解析前调用一次，之后 parse 可在各加载线程并发执行
+    static void initialize();
+
+    // --bench-exif=<文件夹>  以 1、2、4…个线程并发解析文件夹内图像的元数据，返回各线程数的吞吐量
+    static std::string benchmark(std::wstring_view dirPath);
 
 private:
+    static int getOrientation(const Exiv2::ExifData& exifData);
+    static size_t getVideoSize(const Exiv2::XmpData& xmpData);
+
     // https://exiv2.org/tags.html
     // https://www.colorpilot.com/exiftable-thumbnail.html
     // https://exiftool.org/TagNames/PNG.html
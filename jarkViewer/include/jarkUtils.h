@@ -16,8 +16,11 @@
 #include<unordered_map>
 #include<stdexcept>
 #include<ranges>
+#include<span>
+#include<memory>
 
 using std::vector;
+using std::span;
 using std::string;
 using std::wstring;
 using std::string_view;
@@ -107,13 +110,13 @@ struct SettingParameter {
     bool printerInvertColors = false;      // 是否反相
     bool printerBalancedBrightness = false;// 是否均衡亮度 文档优化
 
-    bool reserve1 = false;
+    bool isRawDecodeInBackground = false;   // RAW 先显示内嵌预览，随后在后台解码原图替换
     bool reserve2 = false;
 
     bool isAllowRotateAnimation = true;
     bool isAllowZoomAnimation = true;
     bool isOptimizeSlide = true;            // 优化图像平移性能 （实为渲染工作量偷懒减半）
-    bool reserve4 = false;
+    bool isEnableDiskCache = false;         // 耗时格式的解码结果缓存到磁盘
     int switchImageAnimationMode = 0;       // 0: 无动画  1:上下滑动  2:左右滑动
 
     int pptOrder = 0;                       // 幻灯片模式  0: 顺序  1:逆序  2:随机
@@ -121,7 +124,10 @@ struct SettingParameter {
 
     int UI_Mode = 0;                        // 界面主题 0:跟随系统  1:浅色  2:深色
 
-    uint32_t reserve[802];
+    int cacheMemoryMode = 0;                // 图像缓存内存上限 0:自动(物理内存1/4)  1:1GB  2:2GB  3:4GB
+    int preloadThreadsMode = 0;             // 预读解码线程数 0:自动  1:1  2:2  3:4  4:8
+
+    uint32_t reserve[800];
 
     char extCheckedListStr[800];
 
@@ -231,12 +237,88 @@ enum class ImageFormat {
     //LivePhoto       // 实况图: livp/MVIMG ...
 };
 
+// 文件身份：大小、修改时间、卷序列号及文件ID，任一变化即视为文件已被修改或替换
+struct FileIdentity {
+    uint64_t size = 0;
+    uint64_t mtime = 0;                 // FILETIME
+    uint64_t fileId = 0;                // NTFS 文件索引
+    uint32_t volume = 0;                // 卷序列号
+
+    bool isValid() const { return size || mtime || fileId; }
+    bool operator==(const FileIdentity&) const = default;
+};
+
+// 只读的文件内容：优先以内存映射打开（Windows 文件映射 / 其他平台 mmap），解码器直接读取映射内存，不复制整个文件
+// 映射失败（如部分网络路径）时退回到读入内存
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile() { close(); }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(wstring_view path);
+    void close();
+
+    span<const uint8_t> bytes() const { return { fileData, (size_t)fileSize }; }
+    const uint8_t* data() const { return fileData; }
+    uint64_t size() const { return fileSize; }
+    bool isMapped() const { return fileData != nullptr && fallbackBuf.empty(); }
+
+private:
+    const uint8_t* fileData = nullptr;
+    uint64_t fileSize = 0;
+    vector<uint8_t> fallbackBuf;
+#ifdef _WIN32
+    HANDLE hFile = INVALID_HANDLE_VALUE;
+    HANDLE hMapping = nullptr;
+#else
+    int fd = -1;
+#endif
+};
+
+class ExifMetadata;
+class AnimationStream;
+class FrameStore;
+
 struct ImageAsset {
     ImageFormat format;                 // 图像类型：静态/动图/实况
     cv::Mat primaryFrame;               // 静态图或实况的静态图
     std::vector<cv::Mat> frames;        // 动态图或实况的视频
     std::vector<int> frameDurations;    // 每帧时长
-    string exifInfo;                    // 图像EXIF等信息
+    string exifInfo;                    // 路径/大小/分辨率等基本信息
+    std::shared_ptr<ExifMetadata> metadata; // EXIF 等元数据，文本在显示时才生成
+    FileIdentity fileIdentity{};        // 解码时源文件的身份，用于判断缓存是否过期
+    cv::Mat previewFrame;               // 远大于屏幕的静态图缩小至屏幕尺寸的预览，内存紧张时缓存只保留预览
+    cv::Size fullSize{};                // 有预览时记录原图尺寸，primaryFrame 被释放后仍用于计算缩放
+    bool isEmbeddedPreview = false;     // 预览取自 RAW 内嵌的 JPEG，尚未解码原图
+    bool isProvisional = false;         // 完整解码前先行显示的缩略图，加载完成后被缓存中的完整结果替换
+    int orientation = 1;                // EXIF 方向 1~8，静态图/预览保持存储方向，绘制时才变换；动画帧不受影响
+    std::shared_ptr<AnimationStream> animationStream; // 流式解码的大动画，此时 frames 为空
+    std::shared_ptr<FrameStore> frameStore; // 压缩存储的常驻动画帧，此时 frames 为空
+
+    // 信息面板显示的全部文本：基本信息 + 元数据，在 exifParse.cpp 中实现
+    string infoText() const;
+
+    // 缓存中只剩预览，原图已被释放
+    bool isPreviewOnly() const { return primaryFrame.empty() && !previewFrame.empty(); }
+
+    // 动画/实况的帧数及取帧，兼容流式解码和压缩存储的动画，在 AnimationStream.cpp 中实现
+    int frameCount() const;
+    cv::Mat frameAt(int idx, int* durationMs = nullptr) const;
+};
+
+// 只解析文件头得到的图像信息，不解码像素
+struct ImageProbe {
+    int width = 0;          // 显示尺寸，已计入解码流程会应用的方向旋转
+    int height = 0;
+    int bitDepth = 0;       // 每通道位深，未知为0
+    int frameCount = 0;     // 帧数，动图帧数未知为0
+    int orientation = 1;    // EXIF 方向 1~8
+
+    bool isValid() const { return width > 0 && height > 0; }
+    double pixels() const { return (double)width * height * std::max(frameCount, 1); }
 };
 
 enum class ActionENUM:int64_t {
@@ -332,6 +414,8 @@ struct MatPack {
 
 struct GlobalVar {
     static inline bool isNeedUpdateTheme = false;
+    static inline bool isNeedUpdateCacheBudget = false;
+    static inline bool isNeedUpdatePreloadThreads = false;
 
     static inline BOOL isSystemDarkMode = 0;
     static inline ThemeColor theme = deepTheme;
@@ -384,6 +468,9 @@ public:
 
     static string size2Str(const size_t fileSize);
 
+    // 只查询文件属性不读取内容，开销很小
+    static bool getFileIdentity(wstring_view path, FileIdentity& identity);
+
     static string timeStamp2Str(time_t timeStamp);
 
     static WinSize getWindowSize(HWND hwnd);
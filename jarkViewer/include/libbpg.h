@@ -95,6 +95,16 @@ BPGDecoderContext *bpg_decoder_open(void);
    discarded. */
 void bpg_decoder_keep_extension_data(BPGDecoderContext *s, int enable);
 
+/* Number of threads used to decode wavefront (WPP) rows. 0 (the
+   default) uses the number of cores, 1 decodes serially. Must be
+   called before bpg_decoder_decode(). */
+void bpg_decoder_set_threads(BPGDecoderContext *s, int thread_count);
+
+/* Compare the SIMD HEVC kernels used for bit_depth with the C ones on
+   random blocks. Return the number of kernels that differ (their names
+   are written to failed) or -1 if no SIMD kernels are used. */
+int bpg_decoder_check_simd(int bit_depth, char *failed, int failed_size);
+
 /* return 0 if 0K, < 0 if error */
 int bpg_decoder_decode(BPGDecoderContext *s, const uint8_t *buf, int buf_len);
 
@@ -3,16 +3,31 @@
 #include "jarkUtils.h"
 
 
-class VideoDecoder {
-private:
-    static inline IMFSourceReader* m_pSourceReader = nullptr;
-    static inline IMFMediaType* m_pDecoderOutputType = nullptr;
-    static inline GUID m_outputFormat = GUID_NULL;
-    static inline bool m_initialized = false;
-    static inline UINT32 m_rotation = MFVideoRotationFormat_0;
+// 只读取压缩样本（不解码）得到的视频轨信息
+struct VideoSampleInfo {
+    UINT32 width = 0;                   // 编码尺寸，未旋转
+    UINT32 height = 0;
+    UINT32 rotation = 0;                // 顺时针旋转角度 0/90/180/270
+    std::vector<LONGLONG> timeStamps;   // 按显示顺序每帧的显示时间，单位 100ns
+    LONGLONG lastDuration = 0;          // 最后一帧的时长，单位 100ns
+};
 
 
-    static HRESULT Initialize(const uint8_t* videoBuffer, size_t size) {
+// 每个实例持有独立的 Media Foundation 源读取器，可在不同线程中同时解码不同视频
+class VideoDecoder {
+private:
+    IMFSourceReader* m_pSourceReader = nullptr;
+    IMFMediaType* m_pDecoderOutputType = nullptr;
+    GUID m_outputFormat = GUID_NULL;
+    bool m_initialized = false;
+    bool m_mfStarted = false;
+    UINT32 m_rotation = MFVideoRotationFormat_0;
+    UINT32 m_width = 0;
+    UINT32 m_height = 0;
+
+
+    // isDecode 为 false 时不配置解码器，ReadSample 直接输出压缩样本
+    HRESULT Initialize(const uint8_t* videoBuffer, size_t size, bool isDecode = true) {
         HRESULT hr = S_OK;
 
         // 初始化Media Foundation
@@ -21,29 +36,22 @@ private:
             jarkUtils::log("Failed to initialize Media Foundation");
             return hr;
         }
+        m_mfStarted = true;
 
-        // 创建内存字节流
-        IMFByteStream* pByteStream = nullptr;
-        hr = MFCreateTempFile(MF_ACCESSMODE_READWRITE, MF_OPENMODE_DELETE_IF_EXIST,
-            MF_FILEFLAGS_NONE, &pByteStream);
-        if (FAILED(hr)) {
-            jarkUtils::log("Failed to create byte stream");
-            return hr;
+        // 创建内存字节流，不经过临时文件
+        if (size > UINT_MAX)
+            return E_INVALIDARG;
+        IStream* pStream = SHCreateMemStream(videoBuffer, (UINT)size);
+        if (!pStream) {
+            jarkUtils::log("Failed to create memory stream");
+            return E_OUTOFMEMORY;
         }
 
-        // 将视频数据写入字节流
-        ULONG bytesWritten = 0;
-        hr = pByteStream->Write(videoBuffer, size, &bytesWritten);
-        if (FAILED(hr)) {
-            pByteStream->Release();
-            return hr;
-        }
-
-        // 重置流位置到开始
-        QWORD currentPosition = 0;
-        hr = pByteStream->Seek(msoBegin, 0, MFBYTESTREAM_SEEK_FLAG_CANCEL_PENDING_IO, &currentPosition);
+        IMFByteStream* pByteStream = nullptr;
+        hr = MFCreateMFByteStreamOnStream(pStream, &pByteStream);
+        pStream->Release();
         if (FAILED(hr)) {
-            pByteStream->Release();
+            jarkUtils::log("Failed to create byte stream");
             return hr;
         }
 
@@ -70,7 +78,14 @@ private:
         }
 
         // 配置解码器输出格式为RGB24
-        hr = ConfigureDecoder();
+        if (isDecode) {
+            hr = ConfigureDecoder();
+            if (FAILED(hr)) {
+                return hr;
+            }
+        }
+
+        hr = ReadVideoInfo();
         if (FAILED(hr)) {
             return hr;
         }
@@ -79,7 +94,7 @@ private:
         return S_OK;
     }
 
-    static HRESULT ConfigureDecoder() {
+    HRESULT ConfigureDecoder() {
         HRESULT hr = S_OK;
 
         // 首先尝试获取原始媒体类型
@@ -158,29 +173,16 @@ private:
         return hr;
     }
 
-    static std::vector<cv::Mat> DecodeAllFrames() {
-        std::vector<cv::Mat> frames;
-
-        if (!m_initialized) {
-            jarkUtils::log("Decoder not initialized");
-            return frames;
-        }
-
-        HRESULT hr = S_OK;
-        DWORD streamFlags = 0;
-        LONGLONG timeStamp = 0;
-        IMFSample* pSample = nullptr;
-
+    HRESULT ReadVideoInfo() {
         // 获取视频信息
         IMFMediaType* pMediaType = nullptr;
-        hr = m_pSourceReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &pMediaType);
+        HRESULT hr = m_pSourceReader->GetCurrentMediaType(MF_SOURCE_READER_FIRST_VIDEO_STREAM, &pMediaType);
         if (FAILED(hr)) {
             jarkUtils::log("Failed to get media type");
-            return frames;
+            return hr;
         }
 
-        UINT32 width, height;
-        hr = MFGetAttributeSize(pMediaType, MF_MT_FRAME_SIZE, &width, &height);
+        hr = MFGetAttributeSize(pMediaType, MF_MT_FRAME_SIZE, &m_width, &m_height);
 
         // 读取旋转信息
         if (FAILED(pMediaType->GetUINT32(MF_MT_VIDEO_ROTATION, &m_rotation))) {
@@ -191,40 +193,14 @@ private:
 
         if (FAILED(hr)) {
             jarkUtils::log("Failed to get frame size");
-            return frames;
-        }
-
-        jarkUtils::log("Video dimensions: {}x{}", width, height);
-
-        // 解码所有帧
-        while (true) {
-            hr = m_pSourceReader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM,
-                0, nullptr, &streamFlags, &timeStamp, &pSample);
-
-            if (FAILED(hr)) {
-                jarkUtils::log("Failed to read sample");
-                break;
-            }
-
-            if (streamFlags & MF_SOURCE_READERF_ENDOFSTREAM) {
-                jarkUtils::log("End of stream reached");
-                break;
-            }
-
-            if (pSample) {
-                cv::Mat frame = ConvertSampleToMat(pSample, width, height);
-                if (!frame.empty()) {
-                    frames.push_back(frame);
-                }
-                pSample->Release();
-                pSample = nullptr;
-            }
+            return hr;
         }
 
-        return frames;
+        jarkUtils::log("Video dimensions: {}x{}", m_width, m_height);
+        return S_OK;
     }
 
-    static cv::Mat ConvertSampleToMat(IMFSample* pSample, UINT32 width, UINT32 height) {
+    cv::Mat ConvertSampleToMat(IMFSample* pSample, UINT32 width, UINT32 height) {
         HRESULT hr = S_OK;
         IMFMediaBuffer* pBuffer = nullptr;
 
@@ -284,7 +260,7 @@ private:
         return result;
     }
 
-    static void Cleanup() {
+    void Cleanup() {
         if (m_pDecoderOutputType) {
             m_pDecoderOutputType->Release();
             m_pDecoderOutputType = nullptr;
@@ -295,24 +271,126 @@ private:
             m_pSourceReader = nullptr;
         }
 
-        if (m_initialized) {
+        if (m_mfStarted) {
             MFShutdown();
-            m_initialized = false;
+            m_mfStarted = false;
         }
+        m_initialized = false;
     }
 
 public:
-    static std::vector<cv::Mat> DecodeVideoFrames(const uint8_t* videoBuffer, size_t size) {
+    VideoDecoder() = default;
+    ~VideoDecoder() { Cleanup(); }
+
+    VideoDecoder(const VideoDecoder&) = delete;
+    VideoDecoder& operator=(const VideoDecoder&) = delete;
+
+    // 打开内存中的视频，之后逐帧 ReadFrame
+    bool Open(const uint8_t* videoBuffer, size_t size) {
         HRESULT hr = Initialize(videoBuffer, size);
         if (FAILED(hr)) {
             jarkUtils::log("Failed to initialize decoder, HRESULT: 0x{:x}", hr);
-            return {};
+            Cleanup();
+            return false;
+        }
+        return true;
+    }
+
+    // 按显示顺序解码下一帧（BGR，已按视频的旋转信息旋转）  timeStamp 为显示时间，duration 为该帧时长（未知时为 0），单位均为 100ns
+    // 已到末尾或失败返回 false
+    bool ReadFrame(cv::Mat& frame, LONGLONG* timeStamp = nullptr, LONGLONG* duration = nullptr) {
+        if (!m_initialized) {
+            jarkUtils::log("Decoder not initialized");
+            return false;
+        }
+
+        while (true) {
+            DWORD streamFlags = 0;
+            LONGLONG sampleTime = 0;
+            IMFSample* pSample = nullptr;
+            HRESULT hr = m_pSourceReader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM,
+                0, nullptr, &streamFlags, &sampleTime, &pSample);
+
+            if (FAILED(hr)) {
+                jarkUtils::log("Failed to read sample");
+                return false;
+            }
+
+            if (streamFlags & MF_SOURCE_READERF_ENDOFSTREAM) {
+                if (pSample)
+                    pSample->Release();
+                return false;
+            }
+
+            if (pSample) {
+                LONGLONG sampleDuration = 0;
+                if (FAILED(pSample->GetSampleDuration(&sampleDuration)))
+                    sampleDuration = 0;
+                frame = ConvertSampleToMat(pSample, m_width, m_height);
+                pSample->Release();
+                if (!frame.empty()) {
+                    if (timeStamp)
+                        *timeStamp = sampleTime;
+                    if (duration)
+                        *duration = sampleDuration;
+                    return true;
+                }
+            }
         }
+    }
+
+    // 读取全部压缩样本的时间戳而不解码，用于容器无法自行解析时得到帧数、尺寸和每帧时长
+    static bool ScanSamples(const uint8_t* videoBuffer, size_t size, VideoSampleInfo& info) {
+        VideoDecoder decoder;
+        HRESULT hr = decoder.Initialize(videoBuffer, size, false);
+        if (FAILED(hr)) {
+            jarkUtils::log("Failed to open video for scanning, HRESULT: 0x{:x}", hr);
+            return false;
+        }
+
+        // 只读视频流，避免源读取器为未读取的音频流缓存样本
+        decoder.m_pSourceReader->SetStreamSelection((DWORD)MF_SOURCE_READER_ALL_STREAMS, FALSE);
+        decoder.m_pSourceReader->SetStreamSelection((DWORD)MF_SOURCE_READER_FIRST_VIDEO_STREAM, TRUE);
+
+        info = {};
+        info.width = decoder.m_width;
+        info.height = decoder.m_height;
+        info.rotation = decoder.m_rotation;
+
+        LONGLONG streamEnd = 0;
+        while (true) {
+            DWORD streamFlags = 0;
+            LONGLONG sampleTime = 0;
+            IMFSample* pSample = nullptr;
+            hr = decoder.m_pSourceReader->ReadSample(MF_SOURCE_READER_FIRST_VIDEO_STREAM,
+                0, nullptr, &streamFlags, &sampleTime, &pSample);
+            if (FAILED(hr)) {
+                jarkUtils::log("Failed to read sample");
+                break;
+            }
 
-        auto frames = DecodeAllFrames();
+            if (pSample) {
+                LONGLONG sampleDuration = 0;
+                if (FAILED(pSample->GetSampleDuration(&sampleDuration)))
+                    sampleDuration = 0;
+                info.timeStamps.push_back(sampleTime);
+                streamEnd = std::max(streamEnd, sampleTime + sampleDuration);
+                pSample->Release();
+            }
+
+            if (streamFlags & MF_SOURCE_READERF_ENDOFSTREAM)
+                break;
+        }
 
-        Cleanup();
+        // 压缩样本按解码顺序输出，B 帧的显示时间不递增
+        std::sort(info.timeStamps.begin(), info.timeStamps.end());
+        const size_t count = info.timeStamps.size();
+        if (count == 0)
+            return false;
 
-        return frames;
+        info.lastDuration = streamEnd - info.timeStamps.back();
+        if (info.lastDuration <= 0 && count >= 2) // 样本未带时长，沿用前一帧的间隔
+            info.lastDuration = info.timeStamps[count - 1] - info.timeStamps[count - 2];
+        return true;
     }
 };
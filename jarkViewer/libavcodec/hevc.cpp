@@ -345,7 +345,7 @@ static int set_sps(HEVCContext *s, const HEVCSPS *sps)
         s->avctx->colorspace      = AVCOL_SPC_UNSPECIFIED;
     }
 
-#ifdef USE_FUNC_PTR
+#ifdef HEVC_PRED_FUNC_PTR
     ff_hevc_pred_init(&s->hpc,     sps->bit_depth);
 #endif
     ff_hevc_dsp_init (&s->hevcdsp, sps->bit_depth);
@@ -2425,7 +2425,7 @@ static int hls_slice_data(HEVCContext *s)
     return ret[0];
 }
 
-#ifdef USE_FULL
+#if defined(USE_FULL) || defined(USE_WPP)
 static int hls_decode_entry_wpp(AVCodecContext *avctxt, void *input_ctb_row, int job, int self_id)
 {
     HEVCContext *s1  = (HEVCContext*)avctxt->priv_data, *s;
@@ -2465,10 +2465,16 @@ static int hls_decode_entry_wpp(AVCodecContext *avctxt, void *input_ctb_row, int
 
         ff_hevc_cabac_init(s, ctb_addr_ts);
         hls_sao_param(s, x_ctb >> s->sps->log2_ctb_size, y_ctb >> s->sps->log2_ctb_size);
+
+        s->deblock[ctb_addr_rs].beta_offset = s->sh.beta_offset;
+        s->deblock[ctb_addr_rs].tc_offset   = s->sh.tc_offset;
+        s->filter_slice_edges[ctb_addr_rs]  = s->sh.slice_loop_filter_across_slices_enabled_flag;
+
         more_data = hls_coding_quadtree(s, x_ctb, y_ctb, s->sps->log2_ctb_size, 0);
 
         if (more_data < 0) {
             s->tab_slice_address[ctb_addr_rs] = -1;
+            ff_thread_report_progress2(s->avctx, ctb_row, thread, SHIFT_CTB_WPP);
             return more_data;
         }
 
@@ -2510,17 +2516,30 @@ static int hls_slice_data_wpp(HEVCContext *s, const uint8_t *nal, int length)
     int startheader, cmpt = 0;
     int i, j, res = 0;
 
+    if (!ret || !arg || ff_alloc_entries(s->avctx, s->sh.num_entry_point_offsets + 1) < 0) {
+        res = AVERROR(ENOMEM);
+        goto end;
+    }
 
-    if (!s->sList[1]) {
-        ff_alloc_entries(s->avctx, s->sh.num_entry_point_offsets + 1);
-
-
-        for (i = 1; i < s->threads_number; i++) {
+    for (i = 1; i < s->threads_number; i++) {
+        if (!s->sList[i])
             s->sList[i] = (HEVCContext*)av_malloc(sizeof(HEVCContext));
-            memcpy(s->sList[i], s, sizeof(HEVCContext));
+        if (!s->HEVClcList[i])
             s->HEVClcList[i] = (HEVCLocalContext*)av_mallocz(sizeof(HEVCLocalContext));
-            s->sList[i]->HEVClc = s->HEVClcList[i];
+        if (!s->sList[i] || !s->HEVClcList[i]) {
+            res = AVERROR(ENOMEM);
+            goto end;
+        }
+#ifdef USE_SAO_SMALL_BUFFER
+        /* SAO writes through a CTB sized scratch buffer, one per thread */
+        if (!s->HEVClcList[i]->sao_pixel_buffer)
+            s->HEVClcList[i]->sao_pixel_buffer = (uint8_t*)av_malloc(
+                ((1 << MAX_LOG2_CTB_SIZE) + 2) * ((1 << MAX_LOG2_CTB_SIZE) + 2) * 2);
+        if (!s->HEVClcList[i]->sao_pixel_buffer) {
+            res = AVERROR(ENOMEM);
+            goto end;
         }
+#endif
     }
 
     offset = (lc->gb.index >> 3);
@@ -2554,10 +2573,13 @@ static int hls_slice_data_wpp(HEVCContext *s, const uint8_t *nal, int length)
     s->data = nal;
 
     for (i = 1; i < s->threads_number; i++) {
-        s->sList[i]->HEVClc->first_qp_group = 1;
-        s->sList[i]->HEVClc->qp_y = s->sList[0]->HEVClc->qp_y;
+        s->HEVClcList[i]->first_qp_group = 1;
+        s->HEVClcList[i]->qp_y = s->HEVClc->qp_y;
         memcpy(s->sList[i], s, sizeof(HEVCContext));
         s->sList[i]->HEVClc = s->HEVClcList[i];
+#ifdef USE_SAO_SMALL_BUFFER
+        s->sList[i]->sao_pixel_buffer = s->HEVClcList[i]->sao_pixel_buffer;
+#endif
     }
 
     avpriv_atomic_int_set(&s->wpp_err, 0);
@@ -2573,6 +2595,7 @@ static int hls_slice_data_wpp(HEVCContext *s, const uint8_t *nal, int length)
 
     for (i = 0; i <= s->sh.num_entry_point_offsets; i++)
         res += ret[i];
+end:
     av_free(ret);
     av_free(arg);
     return res;
@@ -2829,7 +2852,7 @@ static int decode_nal_unit(HEVCContext *s, const uint8_t *nal, int length)
         }
 #endif
 
-#ifdef USE_FULL
+#if defined(USE_FULL) || defined(USE_WPP)
         if (s->threads_number > 1 && s->sh.num_entry_point_offsets > 0)
             ctb_addr_ts = hls_slice_data_wpp(s, nal, length);
         else
@@ -3323,12 +3346,16 @@ static av_cold int hevc_decode_free(AVCodecContext *avctx)
     av_freep(&s->sh.offset);
     av_freep(&s->sh.size);
 
-    for (i = 1; i < s->threads_number; i++) {
+    /* threads_number may have dropped to 1 after the contexts were made */
+    for (i = 1; i < MAX_NB_THREADS; i++) {
         HEVCLocalContext *lc = s->HEVClcList[i];
         if (lc) {
+#ifdef USE_SAO_SMALL_BUFFER
+            av_freep(&lc->sao_pixel_buffer);
+#endif
             av_freep(&s->HEVClcList[i]);
-            av_freep(&s->sList[i]);
         }
+        av_freep(&s->sList[i]);
     }
     if (s->HEVClc == s->HEVClcList[0])
         s->HEVClc = NULL;
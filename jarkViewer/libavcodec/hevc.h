@@ -795,6 +795,10 @@ typedef struct HEVCLocalContext {
     /* properties of the boundary of the current CTB for the purposes
      * of the deblocking filter */
     int boundary_flags;
+#ifdef USE_SAO_SMALL_BUFFER
+    /* SAO scratch buffer of a WPP thread context, see hls_slice_data_wpp() */
+    uint8_t *sao_pixel_buffer;
+#endif
 } HEVCLocalContext;
 
 typedef struct HEVCContext {
@@ -862,7 +866,7 @@ typedef struct HEVCContext {
 
     int is_decoded;
 
-#ifdef USE_FUNC_PTR
+#ifdef HEVC_PRED_FUNC_PTR
     HEVCPredContext hpc;
 #endif
     HEVCDSPContext hevcdsp;
@@ -320,6 +320,8 @@ int i = 0;
     }
 #endif /* USE_VAR_BIT_DEPTH */
 
-    //if (ARCH_X86)
-        //ff_hevc_dsp_init_x86(hevcdsp, bit_depth);
+#if defined(USE_SIMD) && defined(USE_VAR_BIT_DEPTH) && \
+    (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+    ff_hevc_dsp_init_x86(hevcdsp, bit_depth);
+#endif
 }
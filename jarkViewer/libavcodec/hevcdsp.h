@@ -137,6 +137,13 @@ extern const int8_t ff_hevc_qpel_filters[3][16];
 
 void ff_hevc_dsp_init_x86(HEVCDSPContext *c, const int bit_depth);
 
+/**
+ * Compare the SIMD kernels used for bit_depth, including the intra predictors
+ * of hevcpred.h, with the C versions on random blocks. Returns the number of kernels that differ and lists their names in
+ * failed, or -1 when no SIMD kernels are built or the CPU has none.
+ */
+int ff_hevc_dsp_check_simd(int bit_depth, char *failed, int failed_size);
+
 #ifdef CONFIG_SMALL
 void hevc_transform_init(void);
 #endif
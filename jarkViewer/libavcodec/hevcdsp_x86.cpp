@@ -0,0 +1,1919 @@
+/*
+ * HEVC DSP functions for x86 (SSE2/AVX2 intrinsics)
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * SIMD versions of the hot HEVC DSP kernels: inverse transforms, residual
+ * add, SAO, deblocking, the uni-directional luma/chroma interpolation and
+ * the intra predictors of hevcpred_template.h. They only cover the USE_VAR_BIT_DEPTH layout
+ * (16 bit pixels, bit depth passed at run time) and are bit exact with the
+ * C functions in hevcdsp_template.h and hevcpred_template.h, which stay the
+ * reference. Debug builds
+ * compare every kernel against C on random blocks at init and fall back
+ * to C on any mismatch; ff_hevc_dsp_check_simd() runs the same comparison
+ * on demand in any build.
+ */
+
+#include "config.h"
+#include "hevcdsp.h"
+
+#if defined(USE_SIMD) && defined(USE_VAR_BIT_DEPTH) && \
+    (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+
+#include <mutex>
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/common.h"
+#include "libavutil/log.h"
+#include "hevc.h"
+#include "hevcpred.h"
+
+#if defined(__GNUC__) || defined(__clang__)
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_AVX2
+#endif
+
+enum {
+    HEVC_CPU_SSE2 = 1,
+    HEVC_CPU_AVX2 = 2,
+};
+
+static void cpuid(int leaf, int regs[4])
+{
+#ifdef _MSC_VER
+    __cpuidex(regs, leaf, 0);
+#else
+    unsigned int a, b, c, d;
+    __cpuid_count(leaf, 0, a, b, c, d);
+    regs[0] = a; regs[1] = b; regs[2] = c; regs[3] = d;
+#endif
+}
+
+static uint64_t xgetbv0(void)
+{
+#ifdef _MSC_VER
+    return _xgetbv(0);
+#else
+    unsigned int eax, edx;
+    __asm__ volatile ("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+    return ((uint64_t)edx << 32) | eax;
+#endif
+}
+
+static int hevc_cpu_flags(void)
+{
+    int regs[4], flags = 0, max_leaf;
+
+    cpuid(0, regs);
+    max_leaf = regs[0];
+    cpuid(1, regs);
+    if (regs[3] & (1 << 26))
+        flags |= HEVC_CPU_SSE2;
+    /* AVX2 needs OSXSAVE + AVX and the OS saving the YMM state */
+    if (max_leaf >= 7 && (regs[2] & (1 << 27)) && (regs[2] & (1 << 28)) &&
+        (xgetbv0() & 6) == 6) {
+        cpuid(7, regs);
+        if (regs[1] & (1 << 5))
+            flags |= HEVC_CPU_AVX2;
+    }
+    return flags;
+}
+
+static av_always_inline __m128i clip_pixel(__m128i v, __m128i maxv)
+{
+    return _mm_min_epi16(_mm_max_epi16(v, _mm_setzero_si128()), maxv);
+}
+
+static av_always_inline __m128i select16(__m128i mask, __m128i a, __m128i b)
+{
+    return _mm_or_si128(_mm_and_si128(mask, a), _mm_andnot_si128(mask, b));
+}
+
+static av_always_inline __m128i abs16(__m128i v)
+{
+    return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+static av_always_inline void transpose8x8(__m128i r[8])
+{
+    __m128i a0 = _mm_unpacklo_epi16(r[0], r[1]);
+    __m128i a1 = _mm_unpackhi_epi16(r[0], r[1]);
+    __m128i a2 = _mm_unpacklo_epi16(r[2], r[3]);
+    __m128i a3 = _mm_unpackhi_epi16(r[2], r[3]);
+    __m128i a4 = _mm_unpacklo_epi16(r[4], r[5]);
+    __m128i a5 = _mm_unpackhi_epi16(r[4], r[5]);
+    __m128i a6 = _mm_unpacklo_epi16(r[6], r[7]);
+    __m128i a7 = _mm_unpackhi_epi16(r[6], r[7]);
+    __m128i b0 = _mm_unpacklo_epi32(a0, a2);
+    __m128i b1 = _mm_unpackhi_epi32(a0, a2);
+    __m128i b2 = _mm_unpacklo_epi32(a1, a3);
+    __m128i b3 = _mm_unpackhi_epi32(a1, a3);
+    __m128i b4 = _mm_unpacklo_epi32(a4, a6);
+    __m128i b5 = _mm_unpackhi_epi32(a4, a6);
+    __m128i b6 = _mm_unpacklo_epi32(a5, a7);
+    __m128i b7 = _mm_unpackhi_epi32(a5, a7);
+    r[0] = _mm_unpacklo_epi64(b0, b4);
+    r[1] = _mm_unpackhi_epi64(b0, b4);
+    r[2] = _mm_unpacklo_epi64(b1, b5);
+    r[3] = _mm_unpackhi_epi64(b1, b5);
+    r[4] = _mm_unpacklo_epi64(b2, b6);
+    r[5] = _mm_unpackhi_epi64(b2, b6);
+    r[6] = _mm_unpacklo_epi64(b3, b7);
+    r[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// residual add
+
+template <int N>
+static void transform_add_sse2(uint8_t *_dst, int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+    uint16_t *dst = (uint16_t *)_dst;
+    const __m128i maxv = _mm_set1_epi16((1 << bit_depth) - 1);
+    int x, y;
+
+    stride /= sizeof(uint16_t);
+    for (y = 0; y < N; y++) {
+        if (N == 4) {
+            __m128i d = _mm_loadl_epi64((const __m128i *)dst);
+            __m128i c = _mm_loadl_epi64((const __m128i *)coeffs);
+            _mm_storel_epi64((__m128i *)dst, clip_pixel(_mm_adds_epi16(d, c), maxv));
+        } else {
+            for (x = 0; x < N; x += 8) {
+                __m128i d = _mm_loadu_si128((const __m128i *)(dst + x));
+                __m128i c = _mm_loadu_si128((const __m128i *)(coeffs + x));
+                _mm_storeu_si128((__m128i *)(dst + x), clip_pixel(_mm_adds_epi16(d, c), maxv));
+            }
+        }
+        dst    += stride;
+        coeffs += N;
+    }
+}
+
+template <int N>
+static TARGET_AVX2 void transform_add_avx2(uint8_t *_dst, int16_t *coeffs, ptrdiff_t stride, int bit_depth)
+{
+    uint16_t *dst = (uint16_t *)_dst;
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i maxv = _mm256_set1_epi16((1 << bit_depth) - 1);
+    int x, y;
+
+    stride /= sizeof(uint16_t);
+    for (y = 0; y < N; y++) {
+        for (x = 0; x < N; x += 16) {
+            __m256i d = _mm256_loadu_si256((const __m256i *)(dst + x));
+            __m256i c = _mm256_loadu_si256((const __m256i *)(coeffs + x));
+            d = _mm256_adds_epi16(d, c);
+            d = _mm256_min_epi16(_mm256_max_epi16(d, zero), maxv);
+            _mm256_storeu_si256((__m256i *)(dst + x), d);
+        }
+        dst    += stride;
+        coeffs += N;
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// inverse transform
+//
+// A N point pass is a plain matrix product, out[n] = sum(T[k][n] * in[k]),
+// done with pmaddwd on pairs of input rows. This is exact: the butterflies in
+// the C code compute the same integer sums and clip only at the end.
+
+struct IdctPairs {
+    int32_t v[32][16];  ///< [n][k / 2]: T[k][n] in the low, T[k + 1][n] in the high 16 bits
+};
+
+/* transform[k][n] of the 32 point table, as built by hevc_transform_init() */
+static constexpr int dct_coef(int k, int n)
+{
+    constexpr int8_t coefs[32] = {
+        64, 90, 90, 90, 89, 88, 87, 85, 83, 82, 80, 78, 75, 73, 70, 67,
+        64, 61, 57, 54, 50, 46, 43, 38, 36, 31, 25, 22, 18, 13,  9,  4
+    };
+    int m = ((2 * n + 1) * k) % 128;
+    int s = 1;
+    if (m >= 64) {
+        m -= 64;
+        s  = -1;
+    }
+    if (m >= 32) {
+        m = 64 - m;
+        s = -s;
+    }
+    return coefs[m] * s;
+}
+
+template <int N>
+static constexpr IdctPairs make_idct_pairs()
+{
+    IdctPairs p = {};
+    for (int n = 0; n < N; n++)
+        for (int k = 0; k < N; k += 2)
+            p.v[n][k / 2] = (int32_t)((uint32_t)(uint16_t)dct_coef(k * (32 / N), n) |
+                                      ((uint32_t)(uint16_t)dct_coef((k + 1) * (32 / N), n) << 16));
+    return p;
+}
+
+template <int N>
+static constexpr IdctPairs idct_pairs = make_idct_pairs<N>();
+
+/* one vertical pass over columns [0, cols), rows [0, K) of src are the only non-zero ones */
+template <int N>
+static void idct_pass_sse2(const int16_t *src, int16_t *dst, int K, int cols, int shift)
+{
+    const IdctPairs &pairs = idct_pairs<N>;
+    const __m128i rnd = _mm_set1_epi32(1 << (shift - 1));
+    const __m128i sh  = _mm_cvtsi32_si128(shift);
+    __m128i lo[N / 2], hi[N / 2];
+    int c, k, n;
+
+    if (N == 4) {
+        for (k = 0; k < K; k += 2)
+            lo[k / 2] = _mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)(src + k * N)),
+                                           _mm_loadl_epi64((const __m128i *)(src + (k + 1) * N)));
+        for (n = 0; n < N; n++) {
+            __m128i s0 = _mm_setzero_si128();
+            for (k = 0; k < K; k += 2)
+                s0 = _mm_add_epi32(s0, _mm_madd_epi16(lo[k / 2], _mm_set1_epi32(pairs.v[n][k / 2])));
+            s0 = _mm_sra_epi32(_mm_add_epi32(s0, rnd), sh);
+            _mm_storel_epi64((__m128i *)(dst + n * N), _mm_packs_epi32(s0, s0));
+        }
+        return;
+    }
+
+    for (c = 0; c < cols; c += 8) {
+        for (k = 0; k < K; k += 2) {
+            __m128i r0 = _mm_loadu_si128((const __m128i *)(src + k * N + c));
+            __m128i r1 = _mm_loadu_si128((const __m128i *)(src + (k + 1) * N + c));
+            lo[k / 2] = _mm_unpacklo_epi16(r0, r1);
+            hi[k / 2] = _mm_unpackhi_epi16(r0, r1);
+        }
+        for (n = 0; n < N; n++) {
+            __m128i s0 = _mm_setzero_si128();
+            __m128i s1 = _mm_setzero_si128();
+            for (k = 0; k < K; k += 2) {
+                const __m128i coef = _mm_set1_epi32(pairs.v[n][k / 2]);
+                s0 = _mm_add_epi32(s0, _mm_madd_epi16(lo[k / 2], coef));
+                s1 = _mm_add_epi32(s1, _mm_madd_epi16(hi[k / 2], coef));
+            }
+            s0 = _mm_sra_epi32(_mm_add_epi32(s0, rnd), sh);
+            s1 = _mm_sra_epi32(_mm_add_epi32(s1, rnd), sh);
+            _mm_storeu_si128((__m128i *)(dst + n * N + c), _mm_packs_epi32(s0, s1));
+        }
+    }
+    for (n = 0; n < N; n++)
+        for (c = cols; c < N; c += 8)
+            _mm_storeu_si128((__m128i *)(dst + n * N + c), _mm_setzero_si128());
+}
+
+template <int N>
+static TARGET_AVX2 void idct_pass_avx2(const int16_t *src, int16_t *dst, int K, int cols, int shift)
+{
+    const IdctPairs &pairs = idct_pairs<N>;
+    const __m256i rnd = _mm256_set1_epi32(1 << (shift - 1));
+    const __m128i sh  = _mm_cvtsi32_si128(shift);
+    __m256i lo[N / 2], hi[N / 2];
+    int c, k, n;
+
+    /* unpack and pack both work per 128 bit lane, so the column order is kept */
+    for (c = 0; c < cols; c += 16) {
+        for (k = 0; k < K; k += 2) {
+            __m256i r0 = _mm256_loadu_si256((const __m256i *)(src + k * N + c));
+            __m256i r1 = _mm256_loadu_si256((const __m256i *)(src + (k + 1) * N + c));
+            lo[k / 2] = _mm256_unpacklo_epi16(r0, r1);
+            hi[k / 2] = _mm256_unpackhi_epi16(r0, r1);
+        }
+        for (n = 0; n < N; n++) {
+            __m256i s0 = _mm256_setzero_si256();
+            __m256i s1 = _mm256_setzero_si256();
+            for (k = 0; k < K; k += 2) {
+                const __m256i coef = _mm256_set1_epi32(pairs.v[n][k / 2]);
+                s0 = _mm256_add_epi32(s0, _mm256_madd_epi16(lo[k / 2], coef));
+                s1 = _mm256_add_epi32(s1, _mm256_madd_epi16(hi[k / 2], coef));
+            }
+            s0 = _mm256_sra_epi32(_mm256_add_epi32(s0, rnd), sh);
+            s1 = _mm256_sra_epi32(_mm256_add_epi32(s1, rnd), sh);
+            _mm256_storeu_si256((__m256i *)(dst + n * N + c), _mm256_packs_epi32(s0, s1));
+        }
+    }
+    for (n = 0; n < N; n++)
+        for (c = cols; c < N; c += 16)
+            _mm256_storeu_si256((__m256i *)(dst + n * N + c), _mm256_setzero_si256());
+}
+
+template <int N>
+static void transpose(const int16_t *src, int16_t *dst)
+{
+    int i, j, k;
+
+    if (N == 4) {
+        for (i = 0; i < 4; i++)
+            for (j = 0; j < 4; j++)
+                dst[j * 4 + i] = src[i * 4 + j];
+        return;
+    }
+    for (i = 0; i < N; i += 8) {
+        for (j = 0; j < N; j += 8) {
+            __m128i r[8];
+            for (k = 0; k < 8; k++)
+                r[k] = _mm_loadu_si128((const __m128i *)(src + (i + k) * N + j));
+            transpose8x8(r);
+            for (k = 0; k < 8; k++)
+                _mm_storeu_si128((__m128i *)(dst + (j + k) * N + i), r[k]);
+        }
+    }
+}
+
+/*
+ * col_limit carries the same promise the C code relies on: in the first
+ * pass only rows below col_limit + 4 are non-zero, and only the columns
+ * below col_limit.
+ */
+template <int N>
+static void idct_sse2(int16_t *coeffs, int col_limit, int bit_depth)
+{
+    DECLARE_ALIGNED(16, int16_t, tmp)[N * N];
+    const int rows = FFMIN(N, (col_limit + 5) & ~1);
+    const int cols = FFMIN(N, col_limit);
+
+    idct_pass_sse2<N>(coeffs, tmp, rows, FFMIN(N, (cols + 7) & ~7), 7);
+    transpose<N>(tmp, coeffs);
+    idct_pass_sse2<N>(coeffs, tmp, (cols + 1) & ~1, N, 20 - bit_depth);
+    transpose<N>(tmp, coeffs);
+}
+
+template <int N>
+static TARGET_AVX2 void idct_avx2(int16_t *coeffs, int col_limit, int bit_depth)
+{
+    DECLARE_ALIGNED(32, int16_t, tmp)[N * N];
+    const int rows = FFMIN(N, (col_limit + 5) & ~1);
+    const int cols = FFMIN(N, col_limit);
+
+    if (cols <= 8)
+        idct_pass_sse2<N>(coeffs, tmp, rows, 8, 7);
+    else
+        idct_pass_avx2<N>(coeffs, tmp, rows, FFMIN(N, (cols + 15) & ~15), 7);
+    transpose<N>(tmp, coeffs);
+    idct_pass_avx2<N>(coeffs, tmp, (cols + 1) & ~1, N, 20 - bit_depth);
+    transpose<N>(tmp, coeffs);
+}
+
+template <int N>
+static void idct_dc_sse2(int16_t *coeffs, int bit_depth)
+{
+    const int shift = 14 - bit_depth;
+    const int add   = 1 << (shift - 1);
+    const __m128i v = _mm_set1_epi16((((coeffs[0] + 1) >> 1) + add) >> shift);
+    int i;
+
+    for (i = 0; i < N * N; i += 8)
+        _mm_storeu_si128((__m128i *)(coeffs + i), v);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// SAO
+
+static void sao_band_filter_sse2(uint8_t *_dst, uint8_t *_src,
+                                 ptrdiff_t stride_dst, ptrdiff_t stride_src, SAOParams *sao,
+                                 int *borders, int width, int height,
+                                 int c_idx, int bit_depth)
+{
+    uint16_t *dst = (uint16_t *)_dst;
+    uint16_t *src = (uint16_t *)_src;
+    const int shift = bit_depth - 5;
+    const int16_t *sao_offset_val = sao->offset_val[c_idx];
+    const int sao_left_class = sao->band_position[c_idx];
+    const __m128i maxv = _mm_set1_epi16((1 << bit_depth) - 1);
+    const __m128i sh   = _mm_cvtsi32_si128(shift);
+    int offset_table[32] = { 0 };
+    __m128i band[4], offset[4];
+    int k, x, y;
+
+    stride_dst /= sizeof(uint16_t);
+    stride_src /= sizeof(uint16_t);
+
+    for (k = 0; k < 4; k++) {
+        offset_table[(k + sao_left_class) & 31] = sao_offset_val[k + 1];
+        band[k]   = _mm_set1_epi16((k + sao_left_class) & 31);
+        offset[k] = _mm_set1_epi16(sao_offset_val[k + 1]);
+    }
+    for (y = 0; y < height; y++) {
+        for (x = 0; x + 8 <= width; x += 8) {
+            __m128i s = _mm_loadu_si128((const __m128i *)(src + x));
+            __m128i b = _mm_srl_epi16(s, sh);
+            __m128i o = _mm_and_si128(_mm_cmpeq_epi16(b, band[0]), offset[0]);
+            for (k = 1; k < 4; k++)
+                o = _mm_or_si128(o, _mm_and_si128(_mm_cmpeq_epi16(b, band[k]), offset[k]));
+            _mm_storeu_si128((__m128i *)(dst + x), clip_pixel(_mm_adds_epi16(s, o), maxv));
+        }
+        for (; x < width; x++)
+            dst[x] = av_clip_uintp2(src[x] + offset_table[src[x] >> shift], bit_depth);
+        dst += stride_dst;
+        src += stride_src;
+    }
+}
+
+#define CMP(a, b) ((a) > (b) ? 1 : ((a) == (b) ? 0 : -1))
+
+/* strides in pixels */
+static void sao_edge_filter_sse2(uint16_t *dst, const uint16_t *src,
+                                 ptrdiff_t stride_dst, ptrdiff_t stride_src, SAOParams *sao,
+                                 int width, int height, int c_idx,
+                                 int init_x, int init_y, int bit_depth)
+{
+    static const uint8_t edge_idx[] = { 1, 2, 0, 3, 4 };
+    static const int8_t pos[4][2][2] = {
+        { { -1,  0 }, {  1, 0 } }, // horizontal
+        { {  0, -1 }, {  0, 1 } }, // vertical
+        { { -1, -1 }, {  1, 1 } }, // 45 degree
+        { {  1, -1 }, { -1, 1 } }, // 135 degree
+    };
+    const int16_t *sao_offset_val = sao->offset_val[c_idx];
+    const int sao_eo_class = sao->eo_class[c_idx];
+    const ptrdiff_t a_off = pos[sao_eo_class][0][0] + pos[sao_eo_class][0][1] * stride_src;
+    const ptrdiff_t b_off = pos[sao_eo_class][1][0] + pos[sao_eo_class][1][1] * stride_src;
+    const __m128i maxv = _mm_set1_epi16((1 << bit_depth) - 1);
+    const __m128i two  = _mm_set1_epi16(2);
+    __m128i offset[5];
+    int i, x, y;
+
+    for (i = 0; i < 5; i++)
+        offset[i] = _mm_set1_epi16(sao_offset_val[edge_idx[i]]);
+
+    for (y = init_y; y < height; y++) {
+        const uint16_t *s = src + y * stride_src;
+        uint16_t *d = dst + y * stride_dst;
+
+        for (x = init_x; x + 8 <= width; x += 8) {
+            __m128i c  = _mm_loadu_si128((const __m128i *)(s + x));
+            __m128i a  = _mm_loadu_si128((const __m128i *)(s + x + a_off));
+            __m128i b  = _mm_loadu_si128((const __m128i *)(s + x + b_off));
+            __m128i d0 = _mm_sub_epi16(_mm_cmpgt_epi16(a, c), _mm_cmpgt_epi16(c, a));
+            __m128i d1 = _mm_sub_epi16(_mm_cmpgt_epi16(b, c), _mm_cmpgt_epi16(c, b));
+            __m128i e  = _mm_add_epi16(_mm_add_epi16(d0, d1), two);
+            __m128i o  = _mm_setzero_si128();
+            for (i = 0; i < 5; i++)
+                o = _mm_or_si128(o, _mm_and_si128(_mm_cmpeq_epi16(e, _mm_set1_epi16(i)), offset[i]));
+            _mm_storeu_si128((__m128i *)(d + x), clip_pixel(_mm_adds_epi16(c, o), maxv));
+        }
+        for (; x < width; x++) {
+            int diff0 = CMP(s[x], s[x + a_off]);
+            int diff1 = CMP(s[x], s[x + b_off]);
+            d[x] = av_clip_uintp2(s[x] + sao_offset_val[edge_idx[2 + diff0 + diff1]], bit_depth);
+        }
+    }
+}
+
+#undef CMP
+
+/* the picture border handling of sao_edge_filter_0/1 in hevcdsp_template.h */
+static void sao_edge_borders(uint16_t *dst, const uint16_t *src,
+                             ptrdiff_t stride_dst, ptrdiff_t stride_src, SAOParams *sao,
+                             int *borders, int *init_x, int *init_y, int *width, int *height,
+                             int c_idx, int bit_depth)
+{
+    const int offset_val   = sao->offset_val[c_idx][0];
+    const int sao_eo_class = sao->eo_class[c_idx];
+    int x, y;
+
+    if (sao_eo_class != SAO_EO_VERT) {
+        if (borders[0]) {
+            for (y = 0; y < *height; y++)
+                dst[y * stride_dst] = av_clip_uintp2(src[y * stride_src] + offset_val, bit_depth);
+            *init_x = 1;
+        }
+        if (borders[2]) {
+            int offset = *width - 1;
+            for (y = 0; y < *height; y++)
+                dst[y * stride_dst + offset] = av_clip_uintp2(src[y * stride_src + offset] + offset_val, bit_depth);
+            (*width)--;
+        }
+    }
+    if (sao_eo_class != SAO_EO_HORIZ) {
+        if (borders[1]) {
+            for (x = *init_x; x < *width; x++)
+                dst[x] = av_clip_uintp2(src[x] + offset_val, bit_depth);
+            *init_y = 1;
+        }
+        if (borders[3]) {
+            ptrdiff_t y_stride_dst = stride_dst * (*height - 1);
+            ptrdiff_t y_stride_src = stride_src * (*height - 1);
+            for (x = *init_x; x < *width; x++)
+                dst[x + y_stride_dst] = av_clip_uintp2(src[x + y_stride_src] + offset_val, bit_depth);
+            (*height)--;
+        }
+    }
+}
+
+static void sao_edge_filter_0_sse2(uint8_t *_dst, uint8_t *_src,
+                                   ptrdiff_t stride_dst, ptrdiff_t stride_src, SAOParams *sao,
+                                   int *borders, int _width, int _height,
+                                   int c_idx, uint8_t *vert_edge,
+                                   uint8_t *horiz_edge, uint8_t *diag_edge, int bit_depth)
+{
+    uint16_t *dst = (uint16_t *)_dst;
+    uint16_t *src = (uint16_t *)_src;
+    int init_x = 0, init_y = 0, width = _width, height = _height;
+
+    stride_dst /= sizeof(uint16_t);
+    stride_src /= sizeof(uint16_t);
+
+    sao_edge_borders(dst, src, stride_dst, stride_src, sao, borders,
+                     &init_x, &init_y, &width, &height, c_idx, bit_depth);
+    sao_edge_filter_sse2(dst, src, stride_dst, stride_src, sao, width, height,
+                         c_idx, init_x, init_y, bit_depth);
+}
+
+static void sao_edge_filter_1_sse2(uint8_t *_dst, uint8_t *_src,
+                                   ptrdiff_t stride_dst, ptrdiff_t stride_src, SAOParams *sao,
+                                   int *borders, int _width, int _height,
+                                   int c_idx, uint8_t *vert_edge,
+                                   uint8_t *horiz_edge, uint8_t *diag_edge, int bit_depth)
+{
+    uint16_t *dst = (uint16_t *)_dst;
+    uint16_t *src = (uint16_t *)_src;
+    const int sao_eo_class = sao->eo_class[c_idx];
+    int init_x = 0, init_y = 0, width = _width, height = _height;
+    int x, y;
+
+    stride_dst /= sizeof(uint16_t);
+    stride_src /= sizeof(uint16_t);
+
+    sao_edge_borders(dst, src, stride_dst, stride_src, sao, borders,
+                     &init_x, &init_y, &width, &height, c_idx, bit_depth);
+    sao_edge_filter_sse2(dst, src, stride_dst, stride_src, sao, width, height,
+                         c_idx, init_x, init_y, bit_depth);
+
+    {
+        int save_upper_left  = !diag_edge[0] && sao_eo_class == SAO_EO_135D && !borders[0] && !borders[1];
+        int save_upper_right = !diag_edge[1] && sao_eo_class == SAO_EO_45D  && !borders[1] && !borders[2];
+        int save_lower_right = !diag_edge[2] && sao_eo_class == SAO_EO_135D && !borders[2] && !borders[3];
+        int save_lower_left  = !diag_edge[3] && sao_eo_class == SAO_EO_45D  && !borders[0] && !borders[3];
+
+        // Restore pixels that can't be modified
+        if (vert_edge[0] && sao_eo_class != SAO_EO_VERT) {
+            for (y = init_y + save_upper_left; y < height - save_lower_left; y++)
+                dst[y * stride_dst] = src[y * stride_src];
+        }
+        if (vert_edge[1] && sao_eo_class != SAO_EO_VERT) {
+            for (y = init_y + save_upper_right; y < height - save_lower_right; y++)
+                dst[y * stride_dst + width - 1] = src[y * stride_src + width - 1];
+        }
+        if (horiz_edge[0] && sao_eo_class != SAO_EO_HORIZ) {
+            for (x = init_x + save_upper_left; x < width - save_upper_right; x++)
+                dst[x] = src[x];
+        }
+        if (horiz_edge[1] && sao_eo_class != SAO_EO_HORIZ) {
+            for (x = init_x + save_lower_left; x < width - save_lower_right; x++)
+                dst[(height - 1) * stride_dst + x] = src[(height - 1) * stride_src + x];
+        }
+        if (diag_edge[0] && sao_eo_class == SAO_EO_135D)
+            dst[0] = src[0];
+        if (diag_edge[1] && sao_eo_class == SAO_EO_45D)
+            dst[width - 1] = src[width - 1];
+        if (diag_edge[2] && sao_eo_class == SAO_EO_135D)
+            dst[stride_dst * (height - 1) + width - 1] = src[stride_src * (height - 1) + width - 1];
+        if (diag_edge[3] && sao_eo_class == SAO_EO_45D)
+            dst[stride_dst * (height - 1)] = src[stride_src * (height - 1)];
+    }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// deblocking
+//
+// Both 4 line segments of an edge are filtered at once, one line per 16 bit
+// lane: lanes 0-3 are segment 0, lanes 4-7 segment 1. The decisions are
+// taken per segment on scalar values like in the C code. Intermediate sums
+// fit in 16 bits for bit depths up to 10, deeper content uses the AVX2
+// versions on 32 bit lanes further down.
+
+static av_always_inline __m128i segment_mask(int seg0, int seg1)
+{
+    return _mm_set_epi16(-seg1, -seg1, -seg1, -seg1, -seg0, -seg0, -seg0, -seg0);
+}
+
+static av_always_inline __m128i segment_value(int v0, int v1)
+{
+    return _mm_set_epi16(v1, v1, v1, v1, v0, v0, v0, v0);
+}
+
+static av_always_inline __m128i clip3(__m128i v, __m128i lim)
+{
+    return _mm_min_epi16(_mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), lim)), lim);
+}
+
+/* r[0..7] = p3 p2 p1 p0 q0 q1 q2 q3; returns which segments were modified */
+static av_always_inline int loop_filter_luma(__m128i r[8], int beta, int32_t *_tc,
+                                             uint8_t *_no_p, uint8_t *_no_q, int bit_depth)
+{
+    const __m128i p3 = r[0], p2 = r[1], p1 = r[2], p0 = r[3];
+    const __m128i q0 = r[4], q1 = r[5], q2 = r[6], q3 = r[7];
+    const __m128i maxv = _mm_set1_epi16((1 << bit_depth) - 1);
+    const __m128i dp = abs16(_mm_add_epi16(_mm_sub_epi16(p2, _mm_add_epi16(p1, p1)), p0));
+    const __m128i dq = abs16(_mm_add_epi16(_mm_sub_epi16(q2, _mm_add_epi16(q1, q1)), q0));
+    const __m128i d_p3p0 = _mm_add_epi16(abs16(_mm_sub_epi16(p3, p0)), abs16(_mm_sub_epi16(q3, q0)));
+    const __m128i d_p0q0 = abs16(_mm_sub_epi16(p0, q0));
+    DECLARE_ALIGNED(16, int16_t, vdp)[8];
+    DECLARE_ALIGNED(16, int16_t, vdq)[8];
+    DECLARE_ALIGNED(16, int16_t, v30)[8];
+    DECLARE_ALIGNED(16, int16_t, v00)[8];
+    int strong[2] = { 0 }, normal[2] = { 0 }, nd_p[2] = { 0 }, nd_q[2] = { 0 }, tc[2];
+    int j;
+
+    _mm_store_si128((__m128i *)vdp, dp);
+    _mm_store_si128((__m128i *)vdq, dq);
+    _mm_store_si128((__m128i *)v30, d_p3p0);
+    _mm_store_si128((__m128i *)v00, d_p0q0);
+
+    beta <<= bit_depth - 8;
+    for (j = 0; j < 2; j++) {
+        const int l0 = 4 * j, l3 = 4 * j + 3;
+        const int d0 = vdp[l0] + vdq[l0];
+        const int d3 = vdp[l3] + vdq[l3];
+        const int beta_3 = beta >> 3;
+        const int beta_2 = beta >> 2;
+        int tc25;
+
+        tc[j] = _tc[j] << (bit_depth - 8);
+        if (d0 + d3 >= beta)
+            continue;
+        tc25 = (tc[j] * 5 + 1) >> 1;
+        if (v30[l0] < beta_3 && v00[l0] < tc25 &&
+            v30[l3] < beta_3 && v00[l3] < tc25 &&
+            (d0 << 1) < beta_2 && (d3 << 1) < beta_2) {
+            strong[j] = 1;
+        } else {
+            normal[j] = 1;
+            nd_p[j] = vdp[l0] + vdp[l3] < ((beta + (beta >> 1)) >> 3);
+            nd_q[j] = vdq[l0] + vdq[l3] < ((beta + (beta >> 1)) >> 3);
+        }
+    }
+    if (!strong[0] && !strong[1] && !normal[0] && !normal[1])
+        return 0;
+
+    {
+        const __m128i tcv    = segment_value(tc[0], tc[1]);
+        const __m128i tc2    = _mm_add_epi16(tcv, tcv);
+        const __m128i tc_2   = _mm_srai_epi16(tcv, 1);
+        const __m128i four   = _mm_set1_epi16(4);
+        const __m128i p_ok   = segment_mask(!_no_p[0], !_no_p[1]);
+        const __m128i q_ok   = segment_mask(!_no_q[0], !_no_q[1]);
+        const __m128i s_mask = segment_mask(strong[0], strong[1]);
+        __m128i n_mask       = segment_mask(normal[0], normal[1]);
+        __m128i sp0, sp1, sp2, sq0, sq1, sq2, np0, np1, nq0, nq1, delta0, t;
+
+        // strong filtering
+        t   = _mm_add_epi16(_mm_add_epi16(p1, p0), q0);
+        sp0 = _mm_add_epi16(_mm_add_epi16(_mm_add_epi16(p2, q1), _mm_add_epi16(t, t)), four);
+        sp0 = _mm_add_epi16(p0, clip3(_mm_sub_epi16(_mm_srai_epi16(sp0, 3), p0), tc2));
+        sp1 = _mm_add_epi16(_mm_add_epi16(p2, t), _mm_set1_epi16(2));
+        sp1 = _mm_add_epi16(p1, clip3(_mm_sub_epi16(_mm_srai_epi16(sp1, 2), p1), tc2));
+        sp2 = _mm_add_epi16(_mm_add_epi16(_mm_add_epi16(p3, p3), _mm_add_epi16(p2, _mm_add_epi16(p2, p2))), _mm_add_epi16(t, four));
+        sp2 = _mm_add_epi16(p2, clip3(_mm_sub_epi16(_mm_srai_epi16(sp2, 3), p2), tc2));
+
+        t   = _mm_add_epi16(_mm_add_epi16(q1, q0), p0);
+        sq0 = _mm_add_epi16(_mm_add_epi16(_mm_add_epi16(q2, p1), _mm_add_epi16(t, t)), four);
+        sq0 = _mm_add_epi16(q0, clip3(_mm_sub_epi16(_mm_srai_epi16(sq0, 3), q0), tc2));
+        sq1 = _mm_add_epi16(_mm_add_epi16(q2, t), _mm_set1_epi16(2));
+        sq1 = _mm_add_epi16(q1, clip3(_mm_sub_epi16(_mm_srai_epi16(sq1, 2), q1), tc2));
+        sq2 = _mm_add_epi16(_mm_add_epi16(_mm_add_epi16(q3, q3), _mm_add_epi16(q2, _mm_add_epi16(q2, q2))), _mm_add_epi16(t, four));
+        sq2 = _mm_add_epi16(q2, clip3(_mm_sub_epi16(_mm_srai_epi16(sq2, 3), q2), tc2));
+
+        // normal filtering
+        t      = _mm_sub_epi16(q0, p0);
+        delta0 = _mm_sub_epi16(_mm_add_epi16(_mm_slli_epi16(t, 3), t),
+                               _mm_mullo_epi16(_mm_sub_epi16(q1, p1), _mm_set1_epi16(3)));
+        delta0 = _mm_srai_epi16(_mm_add_epi16(delta0, _mm_set1_epi16(8)), 4);
+        n_mask = _mm_and_si128(n_mask, _mm_cmplt_epi16(abs16(delta0), _mm_mullo_epi16(tcv, _mm_set1_epi16(10))));
+        delta0 = clip3(delta0, tcv);
+        np0 = clip_pixel(_mm_add_epi16(p0, delta0), maxv);
+        nq0 = clip_pixel(_mm_sub_epi16(q0, delta0), maxv);
+        t   = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(p2, p0), _mm_set1_epi16(1)), 1);
+        np1 = clip3(_mm_srai_epi16(_mm_add_epi16(_mm_sub_epi16(t, p1), delta0), 1), tc_2);
+        np1 = clip_pixel(_mm_add_epi16(p1, np1), maxv);
+        t   = _mm_srai_epi16(_mm_add_epi16(_mm_add_epi16(q2, q0), _mm_set1_epi16(1)), 1);
+        nq1 = clip3(_mm_srai_epi16(_mm_sub_epi16(_mm_sub_epi16(t, q1), delta0), 1), tc_2);
+        nq1 = clip_pixel(_mm_add_epi16(q1, nq1), maxv);
+
+        {
+            const __m128i sp = _mm_and_si128(s_mask, p_ok), sq = _mm_and_si128(s_mask, q_ok);
+            const __m128i np = _mm_and_si128(n_mask, p_ok), nq = _mm_and_si128(n_mask, q_ok);
+            const __m128i np_1 = _mm_and_si128(np, segment_mask(nd_p[0], nd_p[1]));
+            const __m128i nq_1 = _mm_and_si128(nq, segment_mask(nd_q[0], nd_q[1]));
+
+            r[1] = select16(sp, sp2, p2);
+            r[2] = select16(sp, sp1, select16(np_1, np1, p1));
+            r[3] = select16(sp, sp0, select16(np, np0, p0));
+            r[4] = select16(sq, sq0, select16(nq, nq0, q0));
+            r[5] = select16(sq, sq1, select16(nq_1, nq1, q1));
+            r[6] = select16(sq, sq2, q2);
+        }
+    }
+    return (strong[0] | normal[0]) | ((strong[1] | normal[1]) << 1);
+}
+
+static void hevc_h_loop_filter_luma_sse2(uint8_t *_pix, ptrdiff_t stride,
+                                         int beta, int32_t *tc, uint8_t *no_p,
+                                         uint8_t *no_q, int bit_depth)
+{
+    uint16_t *pix = (uint16_t *)_pix;
+    __m128i r[8];
+    int i, segs;
+
+    stride /= sizeof(uint16_t);
+    for (i = 0; i < 8; i++)
+        r[i] = _mm_loadu_si128((const __m128i *)(pix + (i - 4) * stride));
+    segs = loop_filter_luma(r, beta, tc, no_p, no_q, bit_depth);
+    for (i = 1; i < 7; i++) {
+        uint16_t *row = pix + (i - 4) * stride;
+        if (segs == 3)
+            _mm_storeu_si128((__m128i *)row, r[i]);
+        else if (segs == 1)
+            _mm_storel_epi64((__m128i *)row, r[i]);
+        else if (segs == 2)
+            _mm_storel_epi64((__m128i *)(row + 4), _mm_unpackhi_epi64(r[i], r[i]));
+    }
+}
+
+static void hevc_v_loop_filter_luma_sse2(uint8_t *_pix, ptrdiff_t stride,
+                                         int beta, int32_t *tc, uint8_t *no_p,
+                                         uint8_t *no_q, int bit_depth)
+{
+    uint16_t *pix = (uint16_t *)_pix - 4;
+    __m128i r[8];
+    int i, segs;
+
+    stride /= sizeof(uint16_t);
+    for (i = 0; i < 8; i++)
+        r[i] = _mm_loadu_si128((const __m128i *)(pix + i * stride));
+    transpose8x8(r);
+    segs = loop_filter_luma(r, beta, tc, no_p, no_q, bit_depth);
+    if (!segs)
+        return;
+    transpose8x8(r);
+    for (i = 0; i < 8; i++)
+        if (segs & (1 << (i >> 2)))
+            _mm_storeu_si128((__m128i *)(pix + i * stride), r[i]);
+}
+
+/* r[0..3] = p1 p0 q0 q1 */
+static av_always_inline int loop_filter_chroma(__m128i r[4], int32_t *_tc,
+                                               uint8_t *_no_p, uint8_t *_no_q, int bit_depth)
+{
+    const int tc0 = _tc[0] << (bit_depth - 8);
+    const int tc1 = _tc[1] << (bit_depth - 8);
+    const __m128i maxv = _mm_set1_epi16((1 << bit_depth) - 1);
+    const __m128i p1 = r[0], p0 = r[1], q0 = r[2], q1 = r[3];
+    __m128i delta0, p_ok, q_ok;
+
+    if (tc0 <= 0 && tc1 <= 0)
+        return 0;
+
+    p_ok = segment_mask(tc0 > 0 && !_no_p[0], tc1 > 0 && !_no_p[1]);
+    q_ok = segment_mask(tc0 > 0 && !_no_q[0], tc1 > 0 && !_no_q[1]);
+    delta0 = _mm_add_epi16(_mm_slli_epi16(_mm_sub_epi16(q0, p0), 2), _mm_sub_epi16(p1, q1));
+    delta0 = _mm_srai_epi16(_mm_add_epi16(delta0, _mm_set1_epi16(4)), 3);
+    delta0 = clip3(delta0, segment_value(FFMAX(tc0, 0), FFMAX(tc1, 0)));
+    r[1] = select16(p_ok, clip_pixel(_mm_add_epi16(p0, delta0), maxv), p0);
+    r[2] = select16(q_ok, clip_pixel(_mm_sub_epi16(q0, delta0), maxv), q0);
+    return (tc0 > 0) | ((tc1 > 0) << 1);
+}
+
+static void hevc_h_loop_filter_chroma_sse2(uint8_t *_pix, ptrdiff_t stride,
+                                           int32_t *tc, uint8_t *no_p,
+                                           uint8_t *no_q, int bit_depth)
+{
+    uint16_t *pix = (uint16_t *)_pix;
+    __m128i r[4];
+    int i, segs;
+
+    stride /= sizeof(uint16_t);
+    for (i = 0; i < 4; i++)
+        r[i] = _mm_loadu_si128((const __m128i *)(pix + (i - 2) * stride));
+    segs = loop_filter_chroma(r, tc, no_p, no_q, bit_depth);
+    for (i = 1; i < 3; i++) {
+        uint16_t *row = pix + (i - 2) * stride;
+        if (segs == 3)
+            _mm_storeu_si128((__m128i *)row, r[i]);
+        else if (segs == 1)
+            _mm_storel_epi64((__m128i *)row, r[i]);
+        else if (segs == 2)
+            _mm_storel_epi64((__m128i *)(row + 4), _mm_unpackhi_epi64(r[i], r[i]));
+    }
+}
+
+static void hevc_v_loop_filter_chroma_sse2(uint8_t *_pix, ptrdiff_t stride,
+                                           int32_t *tc, uint8_t *no_p,
+                                           uint8_t *no_q, int bit_depth)
+{
+    uint16_t *pix = (uint16_t *)_pix - 2;
+    __m128i r[8];
+    int i, segs;
+
+    stride /= sizeof(uint16_t);
+    for (i = 0; i < 8; i++)
+        r[i] = _mm_loadl_epi64((const __m128i *)(pix + i * stride));
+    transpose8x8(r);
+    segs = loop_filter_chroma(r, tc, no_p, no_q, bit_depth);
+    if (!segs)
+        return;
+    r[4] = r[5] = r[6] = r[7] = _mm_setzero_si128();
+    transpose8x8(r);
+    for (i = 0; i < 8; i++)
+        if (segs & (1 << (i >> 2)))
+            _mm_storel_epi64((__m128i *)(pix + i * stride), r[i]);
+}
+
+/*
+ * Bit depths above 10 overflow the 16 bit sums (9 * (q0 - p0) alone needs
+ * 17 bits at 12 bit), so the same filters run on 32 bit lanes with AVX2:
+ * one __m256i still holds the 8 lines of both segments.
+ */
+
+static TARGET_AVX2 av_always_inline __m256i widen16(__m128i v)
+{
+    return _mm256_cvtepu16_epi32(v);
+}
+
+static TARGET_AVX2 av_always_inline __m128i narrow32(__m256i v)
+{
+    return _mm256_castsi256_si128(_mm256_permute4x64_epi64(_mm256_packus_epi32(v, v), 0x08));
+}
+
+static TARGET_AVX2 av_always_inline __m256i segment_mask32(int seg0, int seg1)
+{
+    return _mm256_set_epi32(-seg1, -seg1, -seg1, -seg1, -seg0, -seg0, -seg0, -seg0);
+}
+
+static TARGET_AVX2 av_always_inline __m256i segment_value32(int v0, int v1)
+{
+    return _mm256_set_epi32(v1, v1, v1, v1, v0, v0, v0, v0);
+}
+
+static TARGET_AVX2 av_always_inline __m256i select32(__m256i mask, __m256i a, __m256i b)
+{
+    return _mm256_blendv_epi8(b, a, mask);
+}
+
+static TARGET_AVX2 av_always_inline __m256i clip3_32(__m256i v, __m256i lim)
+{
+    return _mm256_min_epi32(_mm256_max_epi32(v, _mm256_sub_epi32(_mm256_setzero_si256(), lim)), lim);
+}
+
+static TARGET_AVX2 av_always_inline __m256i clip_pixel32(__m256i v, __m256i maxv)
+{
+    return _mm256_min_epi32(_mm256_max_epi32(v, _mm256_setzero_si256()), maxv);
+}
+
+/* same as loop_filter_luma() on 32 bit lanes */
+static TARGET_AVX2 av_always_inline int loop_filter_luma_32(__m256i r[8], int beta, int32_t *_tc,
+                                                            uint8_t *_no_p, uint8_t *_no_q, int bit_depth)
+{
+    const __m256i p3 = r[0], p2 = r[1], p1 = r[2], p0 = r[3];
+    const __m256i q0 = r[4], q1 = r[5], q2 = r[6], q3 = r[7];
+    const __m256i maxv = _mm256_set1_epi32((1 << bit_depth) - 1);
+    const __m256i dp = _mm256_abs_epi32(_mm256_add_epi32(_mm256_sub_epi32(p2, _mm256_add_epi32(p1, p1)), p0));
+    const __m256i dq = _mm256_abs_epi32(_mm256_add_epi32(_mm256_sub_epi32(q2, _mm256_add_epi32(q1, q1)), q0));
+    const __m256i d_p3p0 = _mm256_add_epi32(_mm256_abs_epi32(_mm256_sub_epi32(p3, p0)),
+                                            _mm256_abs_epi32(_mm256_sub_epi32(q3, q0)));
+    const __m256i d_p0q0 = _mm256_abs_epi32(_mm256_sub_epi32(p0, q0));
+    DECLARE_ALIGNED(32, int32_t, vdp)[8];
+    DECLARE_ALIGNED(32, int32_t, vdq)[8];
+    DECLARE_ALIGNED(32, int32_t, v30)[8];
+    DECLARE_ALIGNED(32, int32_t, v00)[8];
+    int strong[2] = { 0 }, normal[2] = { 0 }, nd_p[2] = { 0 }, nd_q[2] = { 0 }, tc[2];
+    int j;
+
+    _mm256_store_si256((__m256i *)vdp, dp);
+    _mm256_store_si256((__m256i *)vdq, dq);
+    _mm256_store_si256((__m256i *)v30, d_p3p0);
+    _mm256_store_si256((__m256i *)v00, d_p0q0);
+
+    beta <<= bit_depth - 8;
+    for (j = 0; j < 2; j++) {
+        const int l0 = 4 * j, l3 = 4 * j + 3;
+        const int d0 = vdp[l0] + vdq[l0];
+        const int d3 = vdp[l3] + vdq[l3];
+        const int beta_3 = beta >> 3;
+        const int beta_2 = beta >> 2;
+        int tc25;
+
+        tc[j] = _tc[j] << (bit_depth - 8);
+        if (d0 + d3 >= beta)
+            continue;
+        tc25 = (tc[j] * 5 + 1) >> 1;
+        if (v30[l0] < beta_3 && v00[l0] < tc25 &&
+            v30[l3] < beta_3 && v00[l3] < tc25 &&
+            (d0 << 1) < beta_2 && (d3 << 1) < beta_2) {
+            strong[j] = 1;
+        } else {
+            normal[j] = 1;
+            nd_p[j] = vdp[l0] + vdp[l3] < ((beta + (beta >> 1)) >> 3);
+            nd_q[j] = vdq[l0] + vdq[l3] < ((beta + (beta >> 1)) >> 3);
+        }
+    }
+    if (!strong[0] && !strong[1] && !normal[0] && !normal[1])
+        return 0;
+
+    {
+        const __m256i tcv    = segment_value32(tc[0], tc[1]);
+        const __m256i tc2    = _mm256_add_epi32(tcv, tcv);
+        const __m256i tc_2   = _mm256_srai_epi32(tcv, 1);
+        const __m256i one    = _mm256_set1_epi32(1);
+        const __m256i two    = _mm256_set1_epi32(2);
+        const __m256i four   = _mm256_set1_epi32(4);
+        const __m256i p_ok   = segment_mask32(!_no_p[0], !_no_p[1]);
+        const __m256i q_ok   = segment_mask32(!_no_q[0], !_no_q[1]);
+        const __m256i s_mask = segment_mask32(strong[0], strong[1]);
+        __m256i n_mask       = segment_mask32(normal[0], normal[1]);
+        __m256i sp0, sp1, sp2, sq0, sq1, sq2, np0, np1, nq0, nq1, delta0, t;
+
+        // strong filtering
+        t   = _mm256_add_epi32(_mm256_add_epi32(p1, p0), q0);
+        sp0 = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(p2, q1), _mm256_add_epi32(t, t)), four);
+        sp0 = _mm256_add_epi32(p0, clip3_32(_mm256_sub_epi32(_mm256_srai_epi32(sp0, 3), p0), tc2));
+        sp1 = _mm256_add_epi32(_mm256_add_epi32(p2, t), two);
+        sp1 = _mm256_add_epi32(p1, clip3_32(_mm256_sub_epi32(_mm256_srai_epi32(sp1, 2), p1), tc2));
+        sp2 = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(p3, p3), _mm256_mullo_epi32(p2, _mm256_set1_epi32(3))),
+                               _mm256_add_epi32(t, four));
+        sp2 = _mm256_add_epi32(p2, clip3_32(_mm256_sub_epi32(_mm256_srai_epi32(sp2, 3), p2), tc2));
+
+        t   = _mm256_add_epi32(_mm256_add_epi32(q1, q0), p0);
+        sq0 = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(q2, p1), _mm256_add_epi32(t, t)), four);
+        sq0 = _mm256_add_epi32(q0, clip3_32(_mm256_sub_epi32(_mm256_srai_epi32(sq0, 3), q0), tc2));
+        sq1 = _mm256_add_epi32(_mm256_add_epi32(q2, t), two);
+        sq1 = _mm256_add_epi32(q1, clip3_32(_mm256_sub_epi32(_mm256_srai_epi32(sq1, 2), q1), tc2));
+        sq2 = _mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(q3, q3), _mm256_mullo_epi32(q2, _mm256_set1_epi32(3))),
+                               _mm256_add_epi32(t, four));
+        sq2 = _mm256_add_epi32(q2, clip3_32(_mm256_sub_epi32(_mm256_srai_epi32(sq2, 3), q2), tc2));
+
+        // normal filtering
+        delta0 = _mm256_sub_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(q0, p0), _mm256_set1_epi32(9)),
+                                  _mm256_mullo_epi32(_mm256_sub_epi32(q1, p1), _mm256_set1_epi32(3)));
+        delta0 = _mm256_srai_epi32(_mm256_add_epi32(delta0, _mm256_set1_epi32(8)), 4);
+        n_mask = _mm256_and_si256(n_mask, _mm256_cmpgt_epi32(_mm256_mullo_epi32(tcv, _mm256_set1_epi32(10)),
+                                                             _mm256_abs_epi32(delta0)));
+        delta0 = clip3_32(delta0, tcv);
+        np0 = clip_pixel32(_mm256_add_epi32(p0, delta0), maxv);
+        nq0 = clip_pixel32(_mm256_sub_epi32(q0, delta0), maxv);
+        t   = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(p2, p0), one), 1);
+        np1 = clip3_32(_mm256_srai_epi32(_mm256_add_epi32(_mm256_sub_epi32(t, p1), delta0), 1), tc_2);
+        np1 = clip_pixel32(_mm256_add_epi32(p1, np1), maxv);
+        t   = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(q2, q0), one), 1);
+        nq1 = clip3_32(_mm256_srai_epi32(_mm256_sub_epi32(_mm256_sub_epi32(t, q1), delta0), 1), tc_2);
+        nq1 = clip_pixel32(_mm256_add_epi32(q1, nq1), maxv);
+
+        {
+            const __m256i sp = _mm256_and_si256(s_mask, p_ok), sq = _mm256_and_si256(s_mask, q_ok);
+            const __m256i np = _mm256_and_si256(n_mask, p_ok), nq = _mm256_and_si256(n_mask, q_ok);
+            const __m256i np_1 = _mm256_and_si256(np, segment_mask32(nd_p[0], nd_p[1]));
+            const __m256i nq_1 = _mm256_and_si256(nq, segment_mask32(nd_q[0], nd_q[1]));
+
+            r[1] = select32(sp, sp2, p2);
+            r[2] = select32(sp, sp1, select32(np_1, np1, p1));
+            r[3] = select32(sp, sp0, select32(np, np0, p0));
+            r[4] = select32(sq, sq0, select32(nq, nq0, q0));
+            r[5] = select32(sq, sq1, select32(nq_1, nq1, q1));
+            r[6] = select32(sq, sq2, q2);
+        }
+    }
+    return (strong[0] | normal[0]) | ((strong[1] | normal[1]) << 1);
+}
+
+static TARGET_AVX2 void hevc_h_loop_filter_luma_avx2(uint8_t *_pix, ptrdiff_t stride,
+                                                     int beta, int32_t *tc, uint8_t *no_p,
+                                                     uint8_t *no_q, int bit_depth)
+{
+    uint16_t *pix = (uint16_t *)_pix;
+    __m256i r[8];
+    int i, segs;
+
+    stride /= sizeof(uint16_t);
+    for (i = 0; i < 8; i++)
+        r[i] = widen16(_mm_loadu_si128((const __m128i *)(pix + (i - 4) * stride)));
+    segs = loop_filter_luma_32(r, beta, tc, no_p, no_q, bit_depth);
+    for (i = 1; i < 7; i++) {
+        uint16_t *row = pix + (i - 4) * stride;
+        const __m128i v = narrow32(r[i]);
+        if (segs == 3)
+            _mm_storeu_si128((__m128i *)row, v);
+        else if (segs == 1)
+            _mm_storel_epi64((__m128i *)row, v);
+        else if (segs == 2)
+            _mm_storel_epi64((__m128i *)(row + 4), _mm_unpackhi_epi64(v, v));
+    }
+}
+
+static TARGET_AVX2 void hevc_v_loop_filter_luma_avx2(uint8_t *_pix, ptrdiff_t stride,
+                                                     int beta, int32_t *tc, uint8_t *no_p,
+                                                     uint8_t *no_q, int bit_depth)
+{
+    uint16_t *pix = (uint16_t *)_pix - 4;
+    __m128i r[8];
+    __m256i w[8];
+    int i, segs;
+
+    stride /= sizeof(uint16_t);
+    for (i = 0; i < 8; i++)
+        r[i] = _mm_loadu_si128((const __m128i *)(pix + i * stride));
+    transpose8x8(r);
+    for (i = 0; i < 8; i++)
+        w[i] = widen16(r[i]);
+    segs = loop_filter_luma_32(w, beta, tc, no_p, no_q, bit_depth);
+    if (!segs)
+        return;
+    for (i = 0; i < 8; i++)
+        r[i] = narrow32(w[i]);
+    transpose8x8(r);
+    for (i = 0; i < 8; i++)
+        if (segs & (1 << (i >> 2)))
+            _mm_storeu_si128((__m128i *)(pix + i * stride), r[i]);
+}
+
+/* same as loop_filter_chroma() on 32 bit lanes */
+static TARGET_AVX2 av_always_inline int loop_filter_chroma_32(__m256i r[4], int32_t *_tc,
+                                                              uint8_t *_no_p, uint8_t *_no_q, int bit_depth)
+{
+    const int tc0 = _tc[0] << (bit_depth - 8);
+    const int tc1 = _tc[1] << (bit_depth - 8);
+    const __m256i maxv = _mm256_set1_epi32((1 << bit_depth) - 1);
+    const __m256i p1 = r[0], p0 = r[1], q0 = r[2], q1 = r[3];
+    __m256i delta0, p_ok, q_ok;
+
+    if (tc0 <= 0 && tc1 <= 0)
+        return 0;
+
+    p_ok = segment_mask32(tc0 > 0 && !_no_p[0], tc1 > 0 && !_no_p[1]);
+    q_ok = segment_mask32(tc0 > 0 && !_no_q[0], tc1 > 0 && !_no_q[1]);
+    delta0 = _mm256_add_epi32(_mm256_slli_epi32(_mm256_sub_epi32(q0, p0), 2), _mm256_sub_epi32(p1, q1));
+    delta0 = _mm256_srai_epi32(_mm256_add_epi32(delta0, _mm256_set1_epi32(4)), 3);
+    delta0 = clip3_32(delta0, segment_value32(FFMAX(tc0, 0), FFMAX(tc1, 0)));
+    r[1] = select32(p_ok, clip_pixel32(_mm256_add_epi32(p0, delta0), maxv), p0);
+    r[2] = select32(q_ok, clip_pixel32(_mm256_sub_epi32(q0, delta0), maxv), q0);
+    return (tc0 > 0) | ((tc1 > 0) << 1);
+}
+
+static TARGET_AVX2 void hevc_h_loop_filter_chroma_avx2(uint8_t *_pix, ptrdiff_t stride,
+                                                       int32_t *tc, uint8_t *no_p,
+                                                       uint8_t *no_q, int bit_depth)
+{
+    uint16_t *pix = (uint16_t *)_pix;
+    __m256i r[4];
+    int i, segs;
+
+    stride /= sizeof(uint16_t);
+    for (i = 0; i < 4; i++)
+        r[i] = widen16(_mm_loadu_si128((const __m128i *)(pix + (i - 2) * stride)));
+    segs = loop_filter_chroma_32(r, tc, no_p, no_q, bit_depth);
+    for (i = 1; i < 3; i++) {
+        uint16_t *row = pix + (i - 2) * stride;
+        const __m128i v = narrow32(r[i]);
+        if (segs == 3)
+            _mm_storeu_si128((__m128i *)row, v);
+        else if (segs == 1)
+            _mm_storel_epi64((__m128i *)row, v);
+        else if (segs == 2)
+            _mm_storel_epi64((__m128i *)(row + 4), _mm_unpackhi_epi64(v, v));
+    }
+}
+
+static TARGET_AVX2 void hevc_v_loop_filter_chroma_avx2(uint8_t *_pix, ptrdiff_t stride,
+                                                       int32_t *tc, uint8_t *no_p,
+                                                       uint8_t *no_q, int bit_depth)
+{
+    uint16_t *pix = (uint16_t *)_pix - 2;
+    __m128i r[8];
+    __m256i w[4];
+    int i, segs;
+
+    stride /= sizeof(uint16_t);
+    for (i = 0; i < 8; i++)
+        r[i] = _mm_loadl_epi64((const __m128i *)(pix + i * stride));
+    transpose8x8(r);
+    for (i = 0; i < 4; i++)
+        w[i] = widen16(r[i]);
+    segs = loop_filter_chroma_32(w, tc, no_p, no_q, bit_depth);
+    if (!segs)
+        return;
+    for (i = 0; i < 4; i++)
+        r[i] = narrow32(w[i]);
+    r[4] = r[5] = r[6] = r[7] = _mm_setzero_si128();
+    transpose8x8(r);
+    for (i = 0; i < 8; i++)
+        if (segs & (1 << (i >> 2)))
+            _mm_storel_epi64((__m128i *)(pix + i * stride), r[i]);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// motion compensation
+//
+// Only the uni-directional h/v/hv filters are used without USE_BIPRED. A tap
+// pair is applied to two interleaved rows with pmaddwd, which reads the
+// pixels as signed 16 bit values; the hv intermediate of the C code is int16
+// too, so bit depths up to 14 are exact. The pixel copies stay C (memcpy).
+
+#ifdef USE_PRED
+
+/* sum(filter[k] * src[(k - TAPS / 2 + 1) * step]) on 8 lanes, or 4 when half is set */
+template <int TAPS, int CLIP>
+static av_always_inline __m128i mc_filter(const int16_t *src, ptrdiff_t step, const __m128i *coef,
+                                          int half, __m128i sh1, __m128i sh2, __m128i offset,
+                                          __m128i maxv)
+{
+    __m128i lo = _mm_setzero_si128(), hi = _mm_setzero_si128(), v;
+    int k;
+
+    src -= (TAPS / 2 - 1) * step;
+    for (k = 0; k < TAPS; k += 2) {
+        const __m128i a = half ? _mm_loadl_epi64((const __m128i *)(src + k * step))
+                               : _mm_loadu_si128((const __m128i *)(src + k * step));
+        const __m128i b = half ? _mm_loadl_epi64((const __m128i *)(src + (k + 1) * step))
+                               : _mm_loadu_si128((const __m128i *)(src + (k + 1) * step));
+        lo = _mm_add_epi32(lo, _mm_madd_epi16(_mm_unpacklo_epi16(a, b), coef[k / 2]));
+        if (!half)
+            hi = _mm_add_epi32(hi, _mm_madd_epi16(_mm_unpackhi_epi16(a, b), coef[k / 2]));
+    }
+    lo = _mm_sra_epi32(lo, sh1);
+    hi = _mm_sra_epi32(hi, sh1);
+    if (!CLIP)
+        return _mm_packs_epi32(lo, hi);
+    lo = _mm_sra_epi32(_mm_add_epi32(lo, offset), sh2);
+    hi = _mm_sra_epi32(_mm_add_epi32(hi, offset), sh2);
+    v  = _mm_packs_epi32(lo, hi);
+    return clip_pixel(v, maxv);
+}
+
+/*
+ * One row of a TAPS tap filter applied along step. With CLIP set this is
+ * dst[x] = clip(((sum >> shift1) + offset) >> shift2) like the uni C
+ * functions; without it the first hv pass, tmp[x] = sum >> shift1.
+ */
+template <int TAPS, int CLIP>
+static av_always_inline void mc_row(int16_t *dst, const int16_t *src, ptrdiff_t step,
+                                    const int8_t *filter, const __m128i *coef, int width,
+                                    int shift1, int bit_depth)
+{
+    const int shift2     = 14 - bit_depth;
+    const __m128i sh1    = _mm_cvtsi32_si128(shift1);
+    const __m128i sh2    = _mm_cvtsi32_si128(shift2);
+    const __m128i offset = _mm_set1_epi32((1 << shift2) >> 1);
+    const __m128i maxv   = _mm_set1_epi16((1 << bit_depth) - 1);
+    int x, k;
+
+    for (x = 0; x + 8 <= width; x += 8)
+        _mm_storeu_si128((__m128i *)(dst + x),
+                         mc_filter<TAPS, CLIP>(src + x, step, coef, 0, sh1, sh2, offset, maxv));
+    if (x + 4 <= width) {
+        _mm_storel_epi64((__m128i *)(dst + x),
+                         mc_filter<TAPS, CLIP>(src + x, step, coef, 1, sh1, sh2, offset, maxv));
+        x += 4;
+    }
+    for (; x < width; x++) {
+        int sum = 0;
+        for (k = 0; k < TAPS; k++)
+            sum += filter[k] * src[x + (k - TAPS / 2 + 1) * step];
+        sum >>= shift1;
+        dst[x] = CLIP ? av_clip_uintp2((sum + ((1 << shift2) >> 1)) >> shift2, bit_depth) : sum;
+    }
+}
+
+template <int TAPS>
+static av_always_inline const int8_t *mc_taps(intptr_t m, __m128i coef[TAPS / 2])
+{
+    const int8_t *filter = TAPS == 8 ? ff_hevc_qpel_filters[m - 1] : ff_hevc_epel_filters[m - 1];
+    int k;
+
+    for (k = 0; k < TAPS; k += 2)
+        coef[k / 2] = _mm_set1_epi32((int)(((uint32_t)(uint16_t)filter[k + 1] << 16) | (uint16_t)filter[k]));
+    return filter;
+}
+
+/* put_hevc_qpel_uni_h/v/hv (TAPS 8) and put_hevc_epel_uni_h/v/hv (TAPS 4) */
+template <int TAPS, int H, int V>
+static void put_hevc_pel_uni_sse2(uint8_t *_dst, ptrdiff_t _dststride, uint8_t *_src, ptrdiff_t _srcstride,
+                                  int height, intptr_t mx, intptr_t my, int width, int bit_depth)
+{
+    const int16_t *src  = (const int16_t *)_src;
+    int16_t *dst        = (int16_t *)_dst;
+    ptrdiff_t srcstride = _srcstride / sizeof(uint16_t);
+    ptrdiff_t dststride = _dststride / sizeof(uint16_t);
+    __m128i coef_h[TAPS / 2], coef_v[TAPS / 2];
+    const int8_t *filter_h = H ? mc_taps<TAPS>(mx, coef_h) : NULL;
+    const int8_t *filter_v = V ? mc_taps<TAPS>(my, coef_v) : NULL;
+    int y;
+
+    if (H && V) {
+        DECLARE_ALIGNED(16, int16_t, tmp_array)[(MAX_PB_SIZE + TAPS - 1) * MAX_PB_SIZE];
+        const int16_t *tmp = tmp_array + (TAPS / 2 - 1) * MAX_PB_SIZE;
+
+        src -= (TAPS / 2 - 1) * srcstride;
+        for (y = 0; y < height + TAPS - 1; y++)
+            mc_row<TAPS, 0>(tmp_array + y * MAX_PB_SIZE, src + y * srcstride, 1,
+                            filter_h, coef_h, width, bit_depth - 8, bit_depth);
+        for (y = 0; y < height; y++)
+            mc_row<TAPS, 1>(dst + y * dststride, tmp + y * MAX_PB_SIZE, MAX_PB_SIZE,
+                            filter_v, coef_v, width, 6, bit_depth);
+    } else {
+        for (y = 0; y < height; y++)
+            mc_row<TAPS, 1>(dst + y * dststride, src + y * srcstride, H ? 1 : srcstride,
+                            H ? filter_h : filter_v, H ? coef_h : coef_v, width, bit_depth - 8, bit_depth);
+    }
+}
+
+#endif /* USE_PRED */
+
+////////////////////////////////////////////////////////////////////////////////
+// intra prediction
+//
+// Strides are in pixels here, like in hevcpred_template.h. The weighted sums
+// go through pmaddwd as well, exact for pixels up to 15 bits.
+
+template <int LOG2>
+static void pred_planar_sse2(uint8_t *_src, const uint8_t *_top, const uint8_t *_left, ptrdiff_t stride)
+{
+    enum { N = 1 << LOG2 };
+    uint16_t *src        = (uint16_t *)_src;
+    const uint16_t *top  = (const uint16_t *)_top;
+    const uint16_t *left = (const uint16_t *)_left;
+    const __m128i rnd    = _mm_set1_epi32(N);
+    const __m128i shift  = _mm_cvtsi32_si128(LOG2 + 1);
+    const __m128i top_n  = _mm_set1_epi16(top[N]);
+    const __m128i left_n = _mm_set1_epi16(left[N]);
+    __m128i wx_lo[(N + 7) / 8], wx_hi[(N + 7) / 8], t_lo[(N + 7) / 8], t_hi[(N + 7) / 8];
+    int x, y;
+
+    /* (N - 1 - x, x + 1) against (left[y], top[N]), (top[x], left[N]) against (N - 1 - y, y + 1) */
+    for (x = 0; x < N; x += 8) {
+        const __m128i xs = _mm_add_epi16(_mm_set1_epi16(x), _mm_setr_epi16(0, 1, 2, 3, 4, 5, 6, 7));
+        const __m128i a  = _mm_sub_epi16(_mm_set1_epi16(N - 1), xs);
+        const __m128i b  = _mm_add_epi16(xs, _mm_set1_epi16(1));
+        const __m128i tx = N == 4 ? _mm_loadl_epi64((const __m128i *)(top + x))
+                                  : _mm_loadu_si128((const __m128i *)(top + x));
+        wx_lo[x / 8] = _mm_unpacklo_epi16(a, b);
+        wx_hi[x / 8] = _mm_unpackhi_epi16(a, b);
+        t_lo[x / 8]  = _mm_unpacklo_epi16(tx, left_n);
+        t_hi[x / 8]  = _mm_unpackhi_epi16(tx, left_n);
+    }
+    for (y = 0; y < N; y++) {
+        const __m128i ly = _mm_unpacklo_epi16(_mm_set1_epi16(left[y]), top_n);
+        const __m128i wy = _mm_set1_epi32(((y + 1) << 16) | (N - 1 - y));
+
+        for (x = 0; x < N; x += 8) {
+            __m128i lo = _mm_add_epi32(_mm_madd_epi16(ly, wx_lo[x / 8]), _mm_madd_epi16(t_lo[x / 8], wy));
+            __m128i hi = _mm_add_epi32(_mm_madd_epi16(ly, wx_hi[x / 8]), _mm_madd_epi16(t_hi[x / 8], wy));
+            __m128i v;
+            lo = _mm_sra_epi32(_mm_add_epi32(lo, rnd), shift);
+            hi = _mm_sra_epi32(_mm_add_epi32(hi, rnd), shift);
+            v  = _mm_packs_epi32(lo, hi);
+            if (N == 4)
+                _mm_storel_epi64((__m128i *)(src + y * stride), v);
+            else
+                _mm_storeu_si128((__m128i *)(src + y * stride + x), v);
+        }
+    }
+}
+
+static void pred_dc_sse2(uint8_t *_src, const uint8_t *_top, const uint8_t *_left,
+                         ptrdiff_t stride, int log2_size, int c_idx)
+{
+    const int size       = 1 << log2_size;
+    uint16_t *src        = (uint16_t *)_src;
+    const uint16_t *top  = (const uint16_t *)_top;
+    const uint16_t *left = (const uint16_t *)_left;
+    const __m128i one    = _mm_set1_epi16(1);
+    __m128i sum = _mm_setzero_si128(), v;
+    int dc, x, y;
+
+    if (size == 4) {
+        sum = _mm_madd_epi16(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i *)left),
+                                                _mm_loadl_epi64((const __m128i *)top)), one);
+    } else {
+        for (x = 0; x < size; x += 8) {
+            const __m128i l = _mm_loadu_si128((const __m128i *)(left + x));
+            const __m128i t = _mm_loadu_si128((const __m128i *)(top + x));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpacklo_epi16(l, t), one));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(_mm_unpackhi_epi16(l, t), one));
+        }
+    }
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+    sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+    dc  = (_mm_cvtsi128_si32(sum) + size) >> (log2_size + 1);
+
+    v = _mm_set1_epi16(dc);
+    for (y = 0; y < size; y++) {
+        if (size == 4)
+            _mm_storel_epi64((__m128i *)(src + y * stride), v);
+        else
+            for (x = 0; x < size; x += 8)
+                _mm_storeu_si128((__m128i *)(src + y * stride + x), v);
+    }
+
+    if (c_idx == 0 && size < 32) {
+        src[0] = (left[0] + 2 * dc + top[0] + 2) >> 2;
+        for (x = 1; x < size; x++)
+            src[x] = (top[x] + 3 * dc + 2) >> 2;
+        for (y = 1; y < size; y++)
+            src[y * stride] = (left[y] + 3 * dc + 2) >> 2;
+    }
+}
+
+/* dst[x] = ((32 - fact) * ref[x + 1] + fact * ref[x + 2] + 16) >> 5 for x < N */
+template <int N>
+static av_always_inline void angular_row(uint16_t *dst, const uint16_t *ref, int fact)
+{
+    const __m128i w   = _mm_set1_epi32((fact << 16) | (32 - fact));
+    const __m128i rnd = _mm_set1_epi32(16);
+    int x;
+
+    if (N == 4) {
+        __m128i a = _mm_loadl_epi64((const __m128i *)(ref + 1));
+        if (fact) {
+            const __m128i b = _mm_loadl_epi64((const __m128i *)(ref + 2));
+            a = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(_mm_unpacklo_epi16(a, b), w), rnd), 5);
+            a = _mm_packs_epi32(a, a);
+        }
+        _mm_storel_epi64((__m128i *)dst, a);
+        return;
+    }
+    for (x = 0; x < N; x += 8) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(ref + x + 1));
+        if (fact) {
+            const __m128i b = _mm_loadu_si128((const __m128i *)(ref + x + 2));
+            __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a, b), w);
+            __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a, b), w);
+            lo = _mm_srai_epi32(_mm_add_epi32(lo, rnd), 5);
+            hi = _mm_srai_epi32(_mm_add_epi32(hi, rnd), 5);
+            a  = _mm_packs_epi32(lo, hi);
+        }
+        _mm_storeu_si128((__m128i *)(dst + x), a);
+    }
+}
+
+template <int LOG2>
+static void pred_angular_sse2(uint8_t *_src, const uint8_t *_top, const uint8_t *_left,
+                              ptrdiff_t stride, int c_idx, int mode,
+                              int disable_intra_boundary_filter, int bit_depth)
+{
+    enum { N = 1 << LOG2 };
+    static const int8_t intra_pred_angle[] = {
+         32,  26,  21,  17, 13,  9,  5, 2, 0, -2, -5, -9, -13, -17, -21, -26, -32,
+        -26, -21, -17, -13, -9, -5, -2, 0, 2,  5,  9, 13,  17,  21,  26,  32
+    };
+    static const int16_t inv_angle[] = {
+        -4096, -1638, -910, -630, -482, -390, -315, -256, -315, -390, -482,
+        -630, -910, -1638, -4096
+    };
+    uint16_t *src        = (uint16_t *)_src;
+    const uint16_t *top  = (const uint16_t *)_top;
+    const uint16_t *left = (const uint16_t *)_left;
+    const int angle      = intra_pred_angle[mode - 2];
+    const int last       = (N * angle) >> 5;
+    /* the horizontal modes are predicted as vertical ones with top and left
+     * swapped, into a transposed block */
+    const int vertical   = mode >= 18;
+    const uint16_t *side = vertical ? top : left;
+    const uint16_t *other = vertical ? left : top;
+    DECLARE_ALIGNED(16, uint16_t, ref_array)[3 * 32 + 16];
+    DECLARE_ALIGNED(16, uint16_t, tmp)[32 * 32];
+    const uint16_t *ref = side - 1;
+    uint16_t *dst       = vertical ? src : tmp;
+    const ptrdiff_t dst_stride = vertical ? stride : N;
+    int x, y;
+
+    if (angle < 0 && last < -1) {
+        uint16_t *ref_tmp = ref_array + N;
+        memcpy(ref_tmp, side - 1, (N + 1) * sizeof(*ref_tmp));
+        for (x = last; x <= -1; x++)
+            ref_tmp[x] = other[-1 + ((x * inv_angle[mode - 11] + 128) >> 8)];
+        ref = ref_tmp;
+    }
+
+    for (y = 0; y < N; y++) {
+        const int idx  = ((y + 1) * angle) >> 5;
+        const int fact = ((y + 1) * angle) & 31;
+        angular_row<N>(dst + y * dst_stride, ref + idx, fact);
+    }
+
+    if (vertical) {
+        if (mode == 26 && c_idx == 0 && N < 32 && !disable_intra_boundary_filter)
+            for (y = 0; y < N; y++)
+                src[y * stride] = av_clip_uintp2(top[0] + ((left[y] - left[-1]) >> 1), bit_depth);
+        return;
+    }
+
+    if (N == 4) {
+        for (y = 0; y < N; y++)
+            for (x = 0; x < N; x++)
+                src[y * stride + x] = tmp[x * N + y];
+    } else {
+        for (y = 0; y < N; y += 8) {
+            for (x = 0; x < N; x += 8) {
+                __m128i r[8];
+                int i;
+                for (i = 0; i < 8; i++)
+                    r[i] = _mm_load_si128((const __m128i *)(tmp + (x + i) * N + y));
+                transpose8x8(r);
+                for (i = 0; i < 8; i++)
+                    _mm_storeu_si128((__m128i *)(src + (y + i) * stride + x), r[i]);
+            }
+        }
+    }
+    if (mode == 10 && c_idx == 0 && N < 32 && !disable_intra_boundary_filter)
+        for (x = 0; x < N; x++)
+            src[x] = av_clip_uintp2(left[0] + ((top[x] - top[-1]) >> 1), bit_depth);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// init
+
+static unsigned int check_rand(void)
+{
+    static thread_local unsigned int state = 0x12345678;
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return state;
+}
+
+static int check_rand_range(int lo, int hi)
+{
+    return lo + (int)(check_rand() % (unsigned)(hi - lo + 1));
+}
+
+static void check_fail_name(char *failed, int failed_size, const char *name, int size)
+{
+    size_t len;
+
+    if (!failed || failed_size <= 0)
+        return;
+    len = strlen(failed);
+    if (size)
+        snprintf(failed + len, failed_size - len, "%s%s %dx%d", len ? ", " : "", name, size, size);
+    else
+        snprintf(failed + len, failed_size - len, "%s%s", len ? ", " : "", name);
+}
+
+/*
+ * Run every SIMD kernel against its C reference on random blocks and put the
+ * C version back for any that differs. Returns the number of mismatches, the
+ * names of the differing kernels are appended to failed when it is not NULL.
+ */
+static int hevc_dsp_check_x86(const HEVCDSPContext *ref, HEVCDSPContext *c, int bit_depth,
+                              char *failed, int failed_size)
+{
+    enum { W = 64 + 16, H = 64 + 8 };
+    const int maxv = (1 << bit_depth) - 1;
+    DECLARE_ALIGNED(32, int16_t, c0)[32 * 32];
+    DECLARE_ALIGNED(32, int16_t, c1)[32 * 32];
+    DECLARE_ALIGNED(32, uint16_t, src)[W * H];
+    DECLARE_ALIGNED(32, uint16_t, d0)[W * H];
+    DECLARE_ALIGNED(32, uint16_t, d1)[W * H];
+    const ptrdiff_t stride = W * sizeof(uint16_t);
+    int fails = 0, i, n, iter;
+
+    hevc_transform_init();
+
+#define CHECK_FAIL(field, name, size)                                       \
+    do {                                                                    \
+        av_log(NULL, AV_LOG_ERROR, "hevcdsp: %s differs from C\n", name);   \
+        check_fail_name(failed, failed_size, name, size);                   \
+        c->field = ref->field;                                              \
+        fails++;                                                            \
+    } while (0)
+
+    for (n = 0; n < 4; n++) {
+        const int size = 4 << n;
+
+        for (iter = 0; iter < 32; iter++) {
+            for (i = 0; i < W * H; i++)
+                d0[i] = d1[i] = check_rand_range(0, maxv);
+            for (i = 0; i < size * size; i++)
+                c0[i] = c1[i] = (int16_t)check_rand_range(-32768, 32767);
+            ref->transform_add[n]((uint8_t *)d0, c0, stride, bit_depth);
+            c->transform_add[n]((uint8_t *)d1, c1, stride, bit_depth);
+            if (memcmp(d0, d1, sizeof(d0))) {
+                CHECK_FAIL(transform_add[n], "transform_add", size);
+                break;
+            }
+        }
+
+        for (iter = 0; iter < 32; iter++) {
+            /* a full block, or one with only the top left corner set */
+            const int col_limit = (iter & 1) ? size + 4 : 4;
+            for (i = 0; i < size * size; i++) {
+                const int x = i % size, y = i / size;
+                c0[i] = (iter & 1) || (x < 4 && y < 4) ? check_rand_range(-1024, 1023) : 0;
+                c1[i] = c0[i];
+            }
+            ref->idct[n](c0, col_limit, bit_depth);
+            c->idct[n](c1, col_limit, bit_depth);
+            if (memcmp(c0, c1, size * size * sizeof(int16_t))) {
+                CHECK_FAIL(idct[n], "idct", size);
+                break;
+            }
+
+            c0[0] = c1[0] = check_rand_range(-32768, 32767);
+            ref->idct_dc[n](c0, bit_depth);
+            c->idct_dc[n](c1, bit_depth);
+            if (memcmp(c0, c1, size * size * sizeof(int16_t))) {
+                CHECK_FAIL(idct_dc[n], "idct_dc", size);
+                break;
+            }
+        }
+    }
+
+    for (iter = 0; iter < 64; iter++) {
+        SAOParams sao = { 0 };
+        int borders[4];
+        uint8_t vert_edge[2], horiz_edge[2], diag_edge[4];
+        const int width  = check_rand_range(1, 64);
+        const int height = check_rand_range(1, 64);
+        /* the edge filter reads one pixel around the block */
+        uint16_t *s = src + W + 8, *p0 = d0 + W + 8, *p1 = d1 + W + 8;
+
+        for (i = 0; i < W * H; i++) {
+            src[i] = (iter & 1) ? check_rand_range(0, maxv) : check_rand_range(maxv / 2, maxv / 2 + 3);
+            d0[i] = d1[i] = 0;
+        }
+        for (i = 0; i < 5; i++)
+            sao.offset_val[0][i] = i ? check_rand_range(-(7 << (bit_depth - 5)), 7 << (bit_depth - 5)) : 0;
+        sao.band_position[0] = check_rand_range(0, 31);
+        sao.eo_class[0]      = check_rand_range(0, 3);
+        for (i = 0; i < 4; i++) {
+            borders[i]   = check_rand() & 1;
+            diag_edge[i] = check_rand() & 1;
+        }
+        for (i = 0; i < 2; i++) {
+            vert_edge[i]  = check_rand() & 1;
+            horiz_edge[i] = check_rand() & 1;
+        }
+
+        ref->sao_band_filter((uint8_t *)p0, (uint8_t *)s, stride, stride, &sao, borders, width, height, 0, bit_depth);
+        c->sao_band_filter((uint8_t *)p1, (uint8_t *)s, stride, stride, &sao, borders, width, height, 0, bit_depth);
+        if (memcmp(d0, d1, sizeof(d0)))
+            CHECK_FAIL(sao_band_filter, "sao_band_filter", 0);
+
+        for (n = 0; n < 2; n++) {
+            ref->sao_edge_filter[n]((uint8_t *)p0, (uint8_t *)s, stride, stride, &sao, borders, width, height,
+                                    0, vert_edge, horiz_edge, diag_edge, bit_depth);
+            c->sao_edge_filter[n]((uint8_t *)p1, (uint8_t *)s, stride, stride, &sao, borders, width, height,
+                                  0, vert_edge, horiz_edge, diag_edge, bit_depth);
+            if (memcmp(d0, d1, sizeof(d0)))
+                CHECK_FAIL(sao_edge_filter[n], n ? "sao_edge_filter_1" : "sao_edge_filter_0", 0);
+        }
+        if (fails)
+            break;
+    }
+
+    for (iter = 0; iter < 256; iter++) {
+        int32_t tc[2] = { check_rand_range(0, 24), check_rand_range(0, 24) };
+        uint8_t no_p[2] = { 0 }, no_q[2] = { 0 };
+        const int beta = check_rand_range(0, 64);
+        /* smooth blocks with a step, so every filter decision gets taken */
+        const int base = check_rand_range(0, maxv);
+        const int step = check_rand_range(-64, 64) << (bit_depth - 8);
+        /* or ramps running towards each other across the edge: with p0 near 0,
+         * q0 near maxv and slopes near maxv / 2, 9 * (q0 - p0) - 3 * (q1 - p1)
+         * is up to 9 * maxv and overflows 16 bit sums above 10 bits */
+        const int top   = check_rand() & 1 ? maxv : 0;
+        const int slope = check_rand_range(maxv / 4, maxv / 2) * (top ? 1 : -1);
+        uint16_t *p0 = d0 + 8 * W + 16, *p1 = d1 + 8 * W + 16;
+
+        for (i = 0; i < W * H; i++) {
+            const int x = i % W, y = i / W;
+            const int k = (iter & 1) ? x - 16 : y - 8;   /* p0 is at -1, q0 at 0 */
+            int v;
+            if (iter & 4)
+                v = k < 0 ? maxv - top + (-1 - k) * slope : top - k * slope;
+            else
+                v = base + (k >= 0) * step + check_rand_range(-2, 2);
+            d0[i] = d1[i] = av_clip(v, 0, maxv);
+        }
+        if (iter & 2) {
+            no_p[0] = check_rand() & 1;
+            no_q[1] = check_rand() & 1;
+        }
+
+        if (iter & 1) {
+            ref->hevc_v_loop_filter_luma((uint8_t *)p0, stride, beta, tc, no_p, no_q, bit_depth);
+            c->hevc_v_loop_filter_luma((uint8_t *)p1, stride, beta, tc, no_p, no_q, bit_depth);
+            if (memcmp(d0, d1, sizeof(d0))) {
+                CHECK_FAIL(hevc_v_loop_filter_luma, "hevc_v_loop_filter_luma", 0);
+                memcpy(d1, d0, sizeof(d0));
+            }
+            ref->hevc_v_loop_filter_chroma((uint8_t *)p0, stride, tc, no_p, no_q, bit_depth);
+            c->hevc_v_loop_filter_chroma((uint8_t *)p1, stride, tc, no_p, no_q, bit_depth);
+            if (memcmp(d0, d1, sizeof(d0)))
+                CHECK_FAIL(hevc_v_loop_filter_chroma, "hevc_v_loop_filter_chroma", 0);
+        } else {
+            ref->hevc_h_loop_filter_luma((uint8_t *)p0, stride, beta, tc, no_p, no_q, bit_depth);
+            c->hevc_h_loop_filter_luma((uint8_t *)p1, stride, beta, tc, no_p, no_q, bit_depth);
+            if (memcmp(d0, d1, sizeof(d0))) {
+                CHECK_FAIL(hevc_h_loop_filter_luma, "hevc_h_loop_filter_luma", 0);
+                memcpy(d1, d0, sizeof(d0));
+            }
+            ref->hevc_h_loop_filter_chroma((uint8_t *)p0, stride, tc, no_p, no_q, bit_depth);
+            c->hevc_h_loop_filter_chroma((uint8_t *)p1, stride, tc, no_p, no_q, bit_depth);
+            if (memcmp(d0, d1, sizeof(d0)))
+                CHECK_FAIL(hevc_h_loop_filter_chroma, "hevc_h_loop_filter_chroma", 0);
+        }
+        if (fails)
+            break;
+    }
+
+#ifdef USE_PRED
+    if (bit_depth <= 14) {
+        for (iter = 0; iter < 96; iter++) {
+            const int width  = check_rand_range(1, 64);
+            const int height = check_rand_range(1, 64);
+            const int qpel   = iter & 1;
+            const int hv     = (iter >> 1) % 3 + 1;   /* 1 h, 2 v, 3 hv */
+            const intptr_t mx = check_rand_range(1, qpel ? 3 : 7);
+            const intptr_t my = check_rand_range(1, qpel ? 3 : 7);
+            /* the filters read 3 pixels before and 4 after the block */
+            uint16_t *s = src + 4 * W + 8;
+
+            for (i = 0; i < W * H; i++) {
+                src[i] = check_rand_range(0, maxv);
+                d0[i] = d1[i] = 0;
+            }
+            if (qpel) {
+                ref->put_hevc_qpel_uni[0][hv >> 1][hv & 1]((uint8_t *)d0, stride, (uint8_t *)s, stride,
+                                                           height, mx, my, width, bit_depth);
+                c->put_hevc_qpel_uni[0][hv >> 1][hv & 1]((uint8_t *)d1, stride, (uint8_t *)s, stride,
+                                                         height, mx, my, width, bit_depth);
+            } else {
+                ref->put_hevc_epel_uni[0][hv >> 1][hv & 1]((uint8_t *)d0, stride, (uint8_t *)s, stride,
+                                                           height, mx, my, width, bit_depth);
+                c->put_hevc_epel_uni[0][hv >> 1][hv & 1]((uint8_t *)d1, stride, (uint8_t *)s, stride,
+                                                         height, mx, my, width, bit_depth);
+            }
+            if (memcmp(d0, d1, sizeof(d0))) {
+                static const char *const names[2][4] = {
+                    { "", "put_hevc_epel_uni_h", "put_hevc_epel_uni_v", "put_hevc_epel_uni_hv" },
+                    { "", "put_hevc_qpel_uni_h", "put_hevc_qpel_uni_v", "put_hevc_qpel_uni_hv" },
+                };
+                av_log(NULL, AV_LOG_ERROR, "hevcdsp: %s differs from C\n", names[qpel][hv]);
+                check_fail_name(failed, failed_size, names[qpel][hv], 0);
+                for (n = 0; n < 10; n++) {
+                    if (qpel)
+                        c->put_hevc_qpel_uni[n][hv >> 1][hv & 1] = ref->put_hevc_qpel_uni[n][hv >> 1][hv & 1];
+                    else
+                        c->put_hevc_epel_uni[n][hv >> 1][hv & 1] = ref->put_hevc_epel_uni[n][hv >> 1][hv & 1];
+                }
+                fails++;
+                break;
+            }
+        }
+    }
+#endif
+#undef CHECK_FAIL
+
+    return fails;
+}
+
+/* same as hevc_dsp_check_x86() for the intra prediction functions */
+static int hevc_pred_check_x86(const HEVCPredContext *ref, HEVCPredContext *c, int bit_depth,
+                               char *failed, int failed_size)
+{
+    enum { W = 32 + 16 };
+    const int maxv = (1 << bit_depth) - 1;
+    DECLARE_ALIGNED(16, uint16_t, top_array)[2 * 32 + 16];
+    DECLARE_ALIGNED(16, uint16_t, left_array)[2 * 32 + 16];
+    DECLARE_ALIGNED(16, uint16_t, d0)[W * 32];
+    DECLARE_ALIGNED(16, uint16_t, d1)[W * 32];
+    /* top[-1] == left[-1] is the corner, both go up to [2 * size] */
+    uint16_t *top = top_array + 8, *left = left_array + 8;
+    int fails = 0, i, n, iter, mode;
+
+    for (n = 0; n < 4; n++) {
+        const int size = 4 << n;
+        int planar_ok = 1, dc_ok = 1, angular_ok = 1;
+
+        for (iter = 0; iter < 32; iter++) {
+            for (i = 0; i < 2 * 32 + 16; i++) {
+                /* smooth edges keep the boundary filters away from clipping half the time */
+                top_array[i]  = (iter & 1) ? check_rand_range(0, maxv) : maxv / 2 + check_rand_range(-8, 8);
+                left_array[i] = (iter & 1) ? check_rand_range(0, maxv) : maxv / 2 + check_rand_range(-8, 8);
+            }
+            left[-1] = top[-1];
+
+            memset(d0, 0, sizeof(d0));
+            memset(d1, 0, sizeof(d1));
+            ref->pred_planar[n]((uint8_t *)d0, (uint8_t *)top, (uint8_t *)left, W);
+            c->pred_planar[n]((uint8_t *)d1, (uint8_t *)top, (uint8_t *)left, W);
+            planar_ok &= !memcmp(d0, d1, sizeof(d0));
+
+            for (i = 0; i < 2; i++) {
+                ref->pred_dc((uint8_t *)d0, (uint8_t *)top, (uint8_t *)left, W, n + 2, i);
+                c->pred_dc((uint8_t *)d1, (uint8_t *)top, (uint8_t *)left, W, n + 2, i);
+                dc_ok &= !memcmp(d0, d1, sizeof(d0));
+            }
+
+            for (mode = 2; mode < 35; mode++) {
+                const int c_idx = check_rand() & 1, disable = !(check_rand() & 3);
+                ref->pred_angular[n]((uint8_t *)d0, (uint8_t *)top, (uint8_t *)left, W,
+                                     c_idx, mode, disable, bit_depth);
+                c->pred_angular[n]((uint8_t *)d1, (uint8_t *)top, (uint8_t *)left, W,
+                                   c_idx, mode, disable, bit_depth);
+                angular_ok &= !memcmp(d0, d1, sizeof(d0));
+            }
+        }
+
+#define CHECK_FAIL(ok, field, name)                                         \
+        if (!ok) {                                                          \
+            av_log(NULL, AV_LOG_ERROR, "hevcpred: %s %dx%d differs from C\n", name, size, size); \
+            check_fail_name(failed, failed_size, name, size);               \
+            c->field = ref->field;                                          \
+            fails++;                                                        \
+        }
+        CHECK_FAIL(planar_ok, pred_planar[n], "pred_planar")
+        CHECK_FAIL(dc_ok, pred_dc, "pred_dc")
+        CHECK_FAIL(angular_ok, pred_angular[n], "pred_angular")
+#undef CHECK_FAIL
+    }
+    return fails;
+}
+
+/* the C and SIMD tables only depend on the bit depth, kept for the on-demand check */
+typedef struct HEVCDSPTables {
+    HEVCDSPContext c;
+    HEVCDSPContext simd;
+    HEVCDSPContext checked;
+} HEVCDSPTables;
+
+static HEVCDSPTables dsp_tables[16];
+static std::once_flag dsp_tables_once[16];
+
+void ff_hevc_dsp_init_x86(HEVCDSPContext *c, const int bit_depth)
+{
+    static const int cpu_flags = hevc_cpu_flags();
+    const HEVCDSPContext ref = *c;
+
+    if (cpu_flags & HEVC_CPU_SSE2) {
+        c->transform_add[0] = transform_add_sse2<4>;
+        c->transform_add[1] = transform_add_sse2<8>;
+        c->transform_add[2] = transform_add_sse2<16>;
+        c->transform_add[3] = transform_add_sse2<32>;
+        c->idct[0]          = idct_sse2<4>;
+        c->idct[1]          = idct_sse2<8>;
+        c->idct[2]          = idct_sse2<16>;
+        c->idct[3]          = idct_sse2<32>;
+        c->idct_dc[0]       = idct_dc_sse2<4>;
+        c->idct_dc[1]       = idct_dc_sse2<8>;
+        c->idct_dc[2]       = idct_dc_sse2<16>;
+        c->idct_dc[3]       = idct_dc_sse2<32>;
+
+        c->sao_band_filter    = sao_band_filter_sse2;
+        c->sao_edge_filter[0] = sao_edge_filter_0_sse2;
+        c->sao_edge_filter[1] = sao_edge_filter_1_sse2;
+
+        /* the *_c loop filters stay C, they are used for PCM/lossless edges */
+        if (bit_depth <= 10) {
+            c->hevc_h_loop_filter_luma   = hevc_h_loop_filter_luma_sse2;
+            c->hevc_v_loop_filter_luma   = hevc_v_loop_filter_luma_sse2;
+            c->hevc_h_loop_filter_chroma = hevc_h_loop_filter_chroma_sse2;
+            c->hevc_v_loop_filter_chroma = hevc_v_loop_filter_chroma_sse2;
+        }
+
+#ifdef USE_PRED
+        if (bit_depth <= 14) {
+            int i;
+            for (i = 0; i < 10; i++) {
+                c->put_hevc_qpel_uni[i][0][1] = put_hevc_pel_uni_sse2<8, 1, 0>;
+                c->put_hevc_qpel_uni[i][1][0] = put_hevc_pel_uni_sse2<8, 0, 1>;
+                c->put_hevc_qpel_uni[i][1][1] = put_hevc_pel_uni_sse2<8, 1, 1>;
+                c->put_hevc_epel_uni[i][0][1] = put_hevc_pel_uni_sse2<4, 1, 0>;
+                c->put_hevc_epel_uni[i][1][0] = put_hevc_pel_uni_sse2<4, 0, 1>;
+                c->put_hevc_epel_uni[i][1][1] = put_hevc_pel_uni_sse2<4, 1, 1>;
+            }
+        }
+#endif
+    }
+    if (cpu_flags & HEVC_CPU_AVX2) {
+        c->transform_add[2] = transform_add_avx2<16>;
+        c->transform_add[3] = transform_add_avx2<32>;
+        c->idct[2]          = idct_avx2<16>;
+        c->idct[3]          = idct_avx2<32>;
+
+        if (bit_depth > 10) {
+            c->hevc_h_loop_filter_luma   = hevc_h_loop_filter_luma_avx2;
+            c->hevc_v_loop_filter_luma   = hevc_v_loop_filter_luma_avx2;
+            c->hevc_h_loop_filter_chroma = hevc_h_loop_filter_chroma_avx2;
+            c->hevc_v_loop_filter_chroma = hevc_v_loop_filter_chroma_avx2;
+        }
+    }
+
+    if (bit_depth < 0 || bit_depth >= 16)
+        return;
+    std::call_once(dsp_tables_once[bit_depth], [&] {
+        HEVCDSPTables *t = &dsp_tables[bit_depth];
+        t->c       = ref;
+        t->simd    = *c;
+        t->checked = *c;
+#ifdef _DEBUG
+        /* debug builds check each bit depth once and keep C for any mismatch */
+        hevc_dsp_check_x86(&ref, &t->checked, bit_depth, NULL, 0);
+#endif
+    });
+    *c = dsp_tables[bit_depth].checked;
+}
+
+typedef struct HEVCPredTables {
+    HEVCPredContext c;
+    HEVCPredContext simd;
+    HEVCPredContext checked;
+} HEVCPredTables;
+
+static HEVCPredTables pred_tables[16];
+static std::once_flag pred_tables_once[16];
+
+void ff_hevc_pred_init_x86(HEVCPredContext *hpc, int bit_depth)
+{
+    static const int cpu_flags = hevc_cpu_flags();
+    const HEVCPredContext ref = *hpc;
+
+    if ((cpu_flags & HEVC_CPU_SSE2) && bit_depth <= 14) {
+        hpc->pred_planar[0]  = pred_planar_sse2<2>;
+        hpc->pred_planar[1]  = pred_planar_sse2<3>;
+        hpc->pred_planar[2]  = pred_planar_sse2<4>;
+        hpc->pred_planar[3]  = pred_planar_sse2<5>;
+        hpc->pred_dc         = pred_dc_sse2;
+        hpc->pred_angular[0] = pred_angular_sse2<2>;
+        hpc->pred_angular[1] = pred_angular_sse2<3>;
+        hpc->pred_angular[2] = pred_angular_sse2<4>;
+        hpc->pred_angular[3] = pred_angular_sse2<5>;
+    }
+
+    if (bit_depth < 0 || bit_depth >= 16)
+        return;
+    std::call_once(pred_tables_once[bit_depth], [&] {
+        HEVCPredTables *t = &pred_tables[bit_depth];
+        t->c       = ref;
+        t->simd    = *hpc;
+        t->checked = *hpc;
+#ifdef _DEBUG
+        hevc_pred_check_x86(&ref, &t->checked, bit_depth, NULL, 0);
+#endif
+    });
+    *hpc = pred_tables[bit_depth].checked;
+}
+
+int ff_hevc_dsp_check_simd(int bit_depth, char *failed, int failed_size)
+{
+    HEVCDSPContext c;
+    HEVCPredContext hpc;
+    int fails;
+
+    if (failed && failed_size > 0)
+        failed[0] = '\0';
+    if (bit_depth < 8 || bit_depth >= 16 || !(hevc_cpu_flags() & HEVC_CPU_SSE2))
+        return -1;
+
+    ff_hevc_dsp_init(&c, bit_depth); /* fills dsp_tables[bit_depth] */
+    c = dsp_tables[bit_depth].simd;
+    fails = hevc_dsp_check_x86(&dsp_tables[bit_depth].c, &c, bit_depth, failed, failed_size);
+
+    ff_hevc_pred_init(&hpc, bit_depth); /* fills pred_tables[bit_depth] */
+    hpc = pred_tables[bit_depth].simd;
+    fails += hevc_pred_check_x86(&pred_tables[bit_depth].c, &hpc, bit_depth, failed, failed_size);
+    return fails;
+}
+
+#else
+
+int ff_hevc_dsp_check_simd(int bit_depth, char *failed, int failed_size)
+{
+    if (failed && failed_size > 0)
+        failed[0] = '\0';
+    return -1;
+}
+
+#endif /* USE_SIMD && USE_VAR_BIT_DEPTH && x86 */
@@ -59,17 +59,24 @@
 
 #endif /* USE_VAR_BIT_DEPTH */
 
-#ifdef USE_FUNC_PTR
+#ifdef HEVC_PRED_FUNC_PTR
 void ff_hevc_pred_init(HEVCPredContext *hpc, int bit_depth)
 {
 #undef FUNC
 #define FUNC(a, depth) a ## _ ## depth
 
-#define HEVC_PRED(depth)                                \
+#ifdef USE_FUNC_PTR
+#define HEVC_PRED_INTRA(depth)                          \
     hpc->intra_pred[0]   = FUNC(intra_pred_2, depth);   \
     hpc->intra_pred[1]   = FUNC(intra_pred_3, depth);   \
     hpc->intra_pred[2]   = FUNC(intra_pred_4, depth);   \
-    hpc->intra_pred[3]   = FUNC(intra_pred_5, depth);   \
+    hpc->intra_pred[3]   = FUNC(intra_pred_5, depth);
+#else
+#define HEVC_PRED_INTRA(depth)
+#endif
+
+#define HEVC_PRED(depth)                                \
+    HEVC_PRED_INTRA(depth)                              \
     hpc->pred_planar[0]  = FUNC(pred_planar_0, depth);  \
     hpc->pred_planar[1]  = FUNC(pred_planar_1, depth);  \
     hpc->pred_planar[2]  = FUNC(pred_planar_2, depth);  \
@@ -100,5 +107,10 @@ void ff_hevc_pred_init(HEVCPredContext *hpc, int bit_depth)
         break;
     }
 #endif /* !USE_VAR_BIT_DEPTH */
+
+#if defined(USE_SIMD) && defined(USE_VAR_BIT_DEPTH) && \
+    (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__))
+    ff_hevc_pred_init_x86(hpc, bit_depth);
+#endif
 }
 #endif
@@ -28,6 +28,13 @@
 
 struct HEVCContext;
 
+/* planar, DC and angular prediction are called through HEVCPredContext when
+ * function pointers are enabled or when SIMD versions may replace them */
+#if defined(USE_FUNC_PTR) || (defined(USE_SIMD) && defined(USE_VAR_BIT_DEPTH) && \
+    (defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)))
+#define HEVC_PRED_FUNC_PTR
+#endif
+
 typedef struct HEVCPredContext {
     void (*intra_pred[4])(struct HEVCContext *s, int x0, int y0, int c_idx);
 
@@ -43,4 +50,6 @@ typedef struct HEVCPredContext {
 
 void ff_hevc_pred_init(HEVCPredContext *hpc, int bit_depth);
 
+void ff_hevc_pred_init_x86(HEVCPredContext *hpc, int bit_depth);
+
 #endif /* AVCODEC_HEVCPRED_H */
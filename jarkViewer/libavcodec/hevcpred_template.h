@@ -356,7 +356,7 @@ do {                                  \
 
     switch (mode) {
     case INTRA_PLANAR:
-#ifdef USE_FUNC_PTR
+#ifdef HEVC_PRED_FUNC_PTR
         s->hpc.pred_planar[log2_size - 2]((uint8_t *)src, (uint8_t *)top,
                                           (uint8_t *)left, stride);
 #else
@@ -365,7 +365,7 @@ do {                                  \
 #endif
         break;
     case INTRA_DC:
-#ifdef USE_FUNC_PTR
+#ifdef HEVC_PRED_FUNC_PTR
         s->hpc.pred_dc((uint8_t *)src, (uint8_t *)top,
                        (uint8_t *)left, stride, log2_size, c_idx);
 #else
@@ -376,7 +376,7 @@ do {                                  \
     default:
         disable_intra_boundary_filter = (s->sps->implicit_rdpcm_enabled_flag &&
                                          lc->cu.cu_transquant_bypass_flag);
-#ifdef USE_FUNC_PTR
+#ifdef HEVC_PRED_FUNC_PTR
         s->hpc.pred_angular[log2_size - 2]((uint8_t *)src, (uint8_t *)top,
                                            (uint8_t *)left, stride, c_idx,
                                            mode, 
@@ -423,7 +423,7 @@ static HEVC_INLINE void FUNC(pred_planar)(uint8_t *_src, const uint8_t *_top,
                          (size - 1 - y) * top[x]  + (y + 1) * left[size] + size) >> (trafo_size + 1);
 }
 
-#ifdef USE_FUNC_PTR
+#ifdef HEVC_PRED_FUNC_PTR
 
 #define PRED_PLANAR(size)\
 static void FUNC(pred_planar_ ## size)(uint8_t *src, const uint8_t *top,        \
@@ -568,7 +568,7 @@ static HEVC_INLINE void FUNC(pred_angular)(uint8_t *_src,
     }
 }
 
-#ifdef USE_FUNC_PTR
+#ifdef HEVC_PRED_FUNC_PTR
 
 static void FUNC(pred_angular_0)(uint8_t *src, const uint8_t *top,
                                  const uint8_t *left,
@@ -0,0 +1,263 @@
+/*
+ * Slice threading for the HEVC decoder
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/**
+ * @file
+ * Slice threading: execute2() on a per-context worker pool and the
+ * row progress counters used by wavefront (WPP) decoding.
+ *
+ * Job j always runs on thread j % nb_threads, in increasing job order, like
+ * the pthread implementation upstream. hls_decode_entry_wpp() relies on this:
+ * job 0 must run on thread 0 (the main context) and a row may only wait for
+ * rows that are already running on other threads.
+ */
+
+#include <algorithm>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include "config.h"
+#include "libavutil/common.h"
+#include "libavutil/internal.h"
+#include "avcodec.h"
+#include "thread.h"
+
+#define MAX_AUTO_THREADS 16
+
+typedef int (action_func2)(AVCodecContext *c, void *arg, int jobnr, int threadnr);
+
+typedef struct SliceThreadContext {
+    int thread_count;
+    std::vector<std::thread> workers;   ///< threads 1..thread_count-1, started on first use
+    std::mutex mutex;
+    std::condition_variable job_cond;
+    std::condition_variable done_cond;
+    unsigned generation;                ///< bumped for every execute2() batch
+    int running;                        ///< workers that have not finished the batch
+    bool exit;
+
+    action_func2 *func2;
+    AVCodecContext *avctx;
+    void *args;
+    int *rets;
+    int job_count;
+    int nb_active;                      ///< threads taking part in the batch
+
+    std::vector<int> entries;           ///< decoded CTB count per row
+    std::unique_ptr<std::mutex[]> progress_mutex;
+    std::unique_ptr<std::condition_variable[]> progress_cond;
+} SliceThreadContext;
+
+/* thread_opaque is deprecated for API users only, it is reserved for lavc */
+static SliceThreadContext *get_thread_ctx(AVCodecContext *avctx)
+{
+FF_DISABLE_DEPRECATION_WARNINGS
+    return (SliceThreadContext *)avctx->thread_opaque;
+FF_ENABLE_DEPRECATION_WARNINGS
+}
+
+static void set_thread_ctx(AVCodecContext *avctx, SliceThreadContext *c)
+{
+FF_DISABLE_DEPRECATION_WARNINGS
+    avctx->thread_opaque = c;
+FF_ENABLE_DEPRECATION_WARNINGS
+}
+
+static void run_jobs(SliceThreadContext *c, int self_id)
+{
+    int jobnr;
+
+    for (jobnr = self_id; jobnr < c->job_count; jobnr += c->nb_active) {
+        int ret = c->func2(c->avctx, c->args, jobnr, self_id);
+        if (c->rets)
+            c->rets[jobnr] = ret;
+    }
+}
+
+static void worker(SliceThreadContext *c, int self_id)
+{
+    unsigned seen = 0;
+
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(c->mutex);
+            c->job_cond.wait(lock, [&] { return c->exit || c->generation != seen; });
+            if (c->exit)
+                return;
+            seen = c->generation;
+        }
+
+        if (self_id < c->nb_active)
+            run_jobs(c, self_id);
+
+        std::lock_guard<std::mutex> lock(c->mutex);
+        if (--c->running == 0)
+            c->done_cond.notify_one();
+    }
+}
+
+static void stop_workers(SliceThreadContext *c)
+{
+    {
+        std::lock_guard<std::mutex> lock(c->mutex);
+        c->exit = true;
+    }
+    c->job_cond.notify_all();
+    for (auto &t : c->workers)
+        t.join();
+    c->workers.clear();
+}
+
+static int start_workers(SliceThreadContext *c)
+{
+    int i;
+
+    try {
+        for (i = 1; i < c->thread_count; i++)
+            c->workers.emplace_back(worker, c, i);
+    } catch (const std::system_error &) {
+        stop_workers(c);
+        return -1;
+    }
+    return 0;
+}
+
+static int thread_execute2(AVCodecContext *avctx, action_func2 *func2, void *arg, int *ret, int job_count)
+{
+    SliceThreadContext *c = get_thread_ctx(avctx);
+    int nb_active = FFMIN(c->thread_count, job_count);
+
+    if (nb_active <= 1 || c->exit ||
+        (c->workers.empty() && start_workers(c) < 0))
+        return avcodec_default_execute2(avctx, func2, arg, ret, job_count);
+
+    {
+        std::lock_guard<std::mutex> lock(c->mutex);
+        c->func2     = func2;
+        c->avctx     = avctx;
+        c->args      = arg;
+        c->rets      = ret;
+        c->job_count = job_count;
+        c->nb_active = nb_active;
+        c->running   = (int)c->workers.size();
+        c->generation++;
+    }
+    c->job_cond.notify_all();
+
+    run_jobs(c, 0);
+
+    std::unique_lock<std::mutex> lock(c->mutex);
+    c->done_cond.wait(lock, [&] { return c->running == 0; });
+    return 0;
+}
+
+int ff_slice_thread_init(AVCodecContext *avctx)
+{
+    SliceThreadContext *c;
+    int thread_count = avctx->thread_count;
+
+    if (!thread_count)
+        thread_count = (int)std::thread::hardware_concurrency();
+    thread_count = av_clip(thread_count, 1, MAX_AUTO_THREADS);
+
+    if (thread_count <= 1) {
+        avctx->thread_count = 1;
+        avctx->active_thread_type = 0;
+        return 0;
+    }
+
+    c = new (std::nothrow) SliceThreadContext();
+    if (!c)
+        return AVERROR(ENOMEM);
+    c->thread_count   = thread_count;
+    c->progress_mutex.reset(new (std::nothrow) std::mutex[thread_count]);
+    c->progress_cond.reset(new (std::nothrow) std::condition_variable[thread_count]);
+    if (!c->progress_mutex || !c->progress_cond) {
+        delete c;
+        return AVERROR(ENOMEM);
+    }
+
+    set_thread_ctx(avctx, c);
+    avctx->thread_count       = thread_count;
+    avctx->active_thread_type = FF_THREAD_SLICE;
+    avctx->execute2           = thread_execute2;
+    return 0;
+}
+
+void ff_slice_thread_free(AVCodecContext *avctx)
+{
+    SliceThreadContext *c = get_thread_ctx(avctx);
+
+    if (!c)
+        return;
+    stop_workers(c);
+    delete c;
+    set_thread_ctx(avctx, NULL);
+    avctx->execute2      = avcodec_default_execute2;
+}
+
+int ff_alloc_entries(AVCodecContext *avctx, int count)
+{
+    SliceThreadContext *c = get_thread_ctx(avctx);
+
+    if (!c || !(avctx->active_thread_type & FF_THREAD_SLICE))
+        return 0;
+    try {
+        if ((int)c->entries.size() < count)
+            c->entries.resize(count);
+    } catch (const std::bad_alloc &) {
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+void ff_reset_entries(AVCodecContext *avctx)
+{
+    SliceThreadContext *c = get_thread_ctx(avctx);
+
+    if (c)
+        std::fill(c->entries.begin(), c->entries.end(), 0);
+}
+
+void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, int n)
+{
+    SliceThreadContext *c = get_thread_ctx(avctx);
+
+    if (!c || field >= (int)c->entries.size())
+        return;
+    std::lock_guard<std::mutex> lock(c->progress_mutex[thread]);
+    c->entries[field] += n;
+    c->progress_cond[thread].notify_all();
+}
+
+void ff_thread_await_progress2(AVCodecContext *avctx, int field, int thread, int shift)
+{
+    SliceThreadContext *c = get_thread_ctx(avctx);
+
+    if (!c || !field || field >= (int)c->entries.size())
+        return;
+    thread = thread ? thread - 1 : c->thread_count - 1;
+    std::unique_lock<std::mutex> lock(c->progress_mutex[thread]);
+    c->progress_cond[thread].wait(lock, [&] { return c->entries[field - 1] - c->entries[field] >= shift; });
+}
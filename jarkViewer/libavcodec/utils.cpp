@@ -77,7 +77,15 @@ int attribute_align_arg avcodec_open2(AVCodecContext *avctx, const AVCodec *code
     avctx->frame_number = 0;
     //    avctx->codec_descriptor = avcodec_descriptor_get(avctx->codec_id);
 
-    avctx->thread_count = 1;
+    avctx->active_thread_type = 0;
+    if ((avctx->thread_type & FF_THREAD_SLICE) &&
+        (codec->capabilities & CODEC_CAP_SLICE_THREADS)) {
+        ret = ff_slice_thread_init(avctx);
+        if (ret < 0)
+            goto free_and_end;
+    } else {
+        avctx->thread_count = 1;
+    }
 
     avctx->pts_correction_num_faulty_pts =
     avctx->pts_correction_num_faulty_dts = 0;
@@ -91,6 +99,7 @@ int attribute_align_arg avcodec_open2(AVCodecContext *avctx, const AVCodec *code
 
     return 0;
 free_and_end:
+    ff_slice_thread_free(avctx);
     av_freep(&avctx->priv_data);
     avctx->codec = NULL;
  end:
@@ -102,6 +111,7 @@ av_cold int avcodec_close(AVCodecContext *avctx)
     if (!avctx)
         return 0;
 
+    ff_slice_thread_free(avctx);
     if (avctx->codec && avctx->codec->close)
         avctx->codec->close(avctx);
     avctx->coded_frame = NULL;
@@ -337,23 +347,6 @@ int ff_thread_can_start_frame(AVCodecContext *avctx)
     return 1;
 }
 
-int ff_alloc_entries(AVCodecContext *avctx, int count)
-{
-    return 0;
-}
-
-void ff_reset_entries(AVCodecContext *avctx)
-{
-}
-
-void ff_thread_await_progress2(AVCodecContext *avctx, int field, int thread, int shift)
-{
-}
-
-void ff_thread_report_progress2(AVCodecContext *avctx, int field, int thread, int n)
-{
-}
-
 void av_init_packet(AVPacket *pkt)
 {
     pkt->pts                  = AV_NOPTS_VALUE;
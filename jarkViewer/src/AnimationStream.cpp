@@ -0,0 +1,221 @@
+#include "AnimationStream.h"
+#include "FrameStore.h"
+
+
+AnimationStream::AnimationStream(SourceFactory makeSource, std::unique_ptr<AnimationSource> source, int frameCount, cv::Mat firstFrame, int firstDuration)
+    : makeSource(std::move(makeSource)), count(frameCount), ringFrames(std::min(RING_FRAMES, frameCount)),
+    size(firstFrame.size()), frameBytes(firstFrame.total() * firstFrame.elemSize()),
+    firstFrame(std::move(firstFrame)), firstDuration(firstDuration), endIdx(frameCount), source(std::move(source)) {
+    ring.push_back({ 0, this->firstFrame, firstDuration });
+    lastFrame = this->firstFrame;
+    lastDuration = firstDuration;
+    decodeThread = std::thread(&AnimationStream::decodeWorker, this);
+}
+
+
+AnimationStream::AnimationStream(SourceFactory makeSource, int frameCount, cv::Size frameSize, int frameType)
+    : makeSource(std::move(makeSource)), count(frameCount), ringFrames(std::min(RING_FRAMES, frameCount)),
+    size(frameSize), frameBytes((size_t)frameSize.area() * CV_ELEM_SIZE(frameType)),
+    firstDuration(0), endIdx(frameCount) {
+}
+
+
+AnimationStream::~AnimationStream() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        isStop = true;
+    }
+    frameCond.notify_all();
+    if (decodeThread.joinable())
+        decodeThread.join();
+}
+
+
+size_t AnimationStream::bytes() const {
+    // 缓冲的帧 + 常驻的第 0 帧 + 解码源内部的画布
+    return (size_t)(ringFrames + (firstFrame.empty() ? 1 : 2)) * frameBytes;
+}
+
+
+const AnimationStream::Frame* AnimationStream::findLocked(int idx) const {
+    if (ring.empty())
+        return nullptr;
+    const int offset = distance(ring.front().idx, idx);
+    return offset < (int)ring.size() ? &ring[offset] : nullptr;
+}
+
+
+// 丢弃播放位置之前（不在 [playIdx, playIdx + ringFrames) 内）的帧
+void AnimationStream::trimLocked() {
+    while (!ring.empty() && distance(playIdx, ring.front().idx) >= ringFrames)
+        ring.pop_front();
+}
+
+
+bool AnimationStream::isNeedDecodeLocked(int& nextIdx) {
+    trimLocked();
+    if ((int)ring.size() >= ringFrames)
+        return false;
+
+    nextIdx = ring.empty() ? playIdx : (ring.back().idx + 1) % count;
+    return nextIdx < endIdx && distance(playIdx, nextIdx) < ringFrames;
+}
+
+
+// 把播放位置移到 idx 并唤醒解码线程，该帧已无法解码时返回 false
+bool AnimationStream::seekLocked(int idx) {
+    if (!decodeThread.joinable() && !isStop) // 延迟模式首次取帧
+        decodeThread = std::thread(&AnimationStream::decodeWorker, this);
+
+    if (idx >= endIdx)
+        return false;
+
+    // 既不在缓冲中也不紧接缓冲之后（后退或跳帧），清空缓冲从该帧重新解码
+    // 缓冲为空且位置未变时，正在解码的正是该帧，不丢弃（tryGetFrame 会反复定位到同一帧）
+    if (ring.empty() ? idx != playIdx : distance(ring.front().idx, idx) > (int)ring.size()) {
+        ring.clear();
+        generation++;
+    }
+    playIdx = idx;
+    trimLocked();
+    frameCond.notify_all();
+    return true;
+}
+
+
+cv::Mat AnimationStream::getFrame(int idx, int* durationMs) {
+    if (idx < 0 || idx >= count)
+        return {};
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (seekLocked(idx)) {
+        const bool hasFirstFrame = idx == 0 && !firstFrame.empty();
+        if (!findLocked(idx) && !hasFirstFrame)
+            frameCond.wait(lock, [&] { return isStop || findLocked(idx) || idx >= endIdx; });
+
+        if (auto frame = findLocked(idx)) {
+            lastFrame = frame->mat;
+            lastDuration = frame->duration;
+        }
+        else if (hasFirstFrame) { // 第 0 帧常驻，回到开头时不必等待重新解码
+            lastFrame = firstFrame;
+            lastDuration = firstDuration;
+        }
+    }
+
+    if (durationMs)
+        *durationMs = lastDuration;
+    return lastFrame;
+}
+
+
+AnimationStream::FrameStatus AnimationStream::tryGetFrame(int idx, cv::Mat& frame, int* durationMs) {
+    if (idx < 0 || idx >= count)
+        return FrameStatus::Failed;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!seekLocked(idx))
+        return FrameStatus::Failed;
+
+    if (auto found = findLocked(idx)) {
+        lastFrame = found->mat;
+        lastDuration = found->duration;
+    }
+    else if (idx == 0 && !firstFrame.empty()) {
+        lastFrame = firstFrame;
+        lastDuration = firstDuration;
+    }
+    else {
+        return FrameStatus::Pending;
+    }
+
+    frame = lastFrame;
+    if (durationMs)
+        *durationMs = lastDuration;
+    return FrameStatus::Ready;
+}
+
+
+bool AnimationStream::forEachFrame(const std::function<bool(int idx, const cv::Mat& frame)>& callback) const {
+    auto exportSource = makeSource();
+    if (!exportSource)
+        return false;
+
+    cv::Mat frame;
+    int duration = 0;
+    for (int i = 0; i < count; i++) {
+        if (!exportSource->next(frame, duration) || frame.empty() || !callback(i, frame))
+            return false;
+    }
+    return true;
+}
+
+
+// 在解码线程中执行，源已越过目标帧时从头重新解码，之前的帧解码后丢弃
+bool AnimationStream::decodeAt(int idx, Frame& frame) {
+    if (!source || idx < sourceIdx) {
+        source = makeSource();
+        sourceIdx = 0;
+    }
+
+    while (source && !isStop) {
+        cv::Mat mat;
+        int duration = 0;
+        if (!source->next(mat, duration) || mat.empty()) {
+            source.reset();
+            return false;
+        }
+        if (sourceIdx++ == idx) {
+            frame = { idx, std::move(mat), duration };
+            return true;
+        }
+    }
+    return false;
+}
+
+
+void AnimationStream::decodeWorker() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        int nextIdx = 0;
+        frameCond.wait(lock, [&] { return isStop || isNeedDecodeLocked(nextIdx); });
+        if (isStop)
+            return;
+
+        const auto decodeGeneration = generation;
+        lock.unlock();
+        Frame frame;
+        const bool isDecoded = decodeAt(nextIdx, frame);
+        lock.lock();
+
+        if (isStop)
+            return;
+        if (!isDecoded) {
+            jarkUtils::log("AnimationStream decode failed at frame {}/{}", nextIdx, count);
+            endIdx = std::min(endIdx, nextIdx);
+        }
+        else if (decodeGeneration == generation) { // 解码期间未重新定位
+            ring.push_back(std::move(frame));
+        }
+        frameCond.notify_all();
+    }
+}
+
+
+int ImageAsset::frameCount() const {
+    if (animationStream)
+        return animationStream->frameCount();
+    return frameStore ? frameStore->frameCount() : (int)frames.size();
+}
+
+
+cv::Mat ImageAsset::frameAt(int idx, int* durationMs) const {
+    if (animationStream)
+        return animationStream->getFrame(idx, durationMs);
+
+    if (idx < 0 || idx >= frameCount())
+        return {};
+    if (durationMs)
+        *durationMs = idx < (int)frameDurations.size() ? frameDurations[idx] : 0;
+    return frameStore ? frameStore->getFrame(idx) : frames[idx];
+}
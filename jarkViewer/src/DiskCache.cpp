@@ -0,0 +1,389 @@
+#include "DiskCache.h"
+#include "qoi.h"
+
+
+namespace {
+#pragma pack(push, 1)
+    struct EntryHeader {
+        char magic[4];
+        uint32_t version;
+        uint64_t fileSize;
+        uint64_t fileMtime;
+        uint32_t pathBytes;     // 原图路径 UTF-16 字节数，用于校验哈希碰撞
+        uint32_t format;        // ImageFormat
+        uint32_t hasPrimary;
+        uint32_t frameCount;
+        uint32_t exifBytes;
+        uint32_t orientation;   // 静态图的 EXIF 方向，绘制时变换
+    };
+
+    struct FrameHeader {
+        int32_t cols;
+        int32_t rows;
+        int32_t channels;
+        int32_t duration;
+        uint32_t qoiBytes;
+    };
+#pragma pack(pop)
+
+    constexpr char ENTRY_MAGIC[4] = { 'J', 'V', 'D', 'C' };
+    constexpr uint32_t ENTRY_VERSION = 2;
+
+    bool isCacheableMat(const cv::Mat& mat) {
+        return mat.type() == CV_8UC3 || mat.type() == CV_8UC4;
+    }
+
+    // QOI 不关心通道顺序，BGR(A) 原样存取，无需转换
+    bool appendFrame(vector<uint8_t>& out, const cv::Mat& mat, int duration) {
+        cv::Mat continuousMat = mat.isContinuous() ? mat : mat.clone();
+        qoi_desc desc{
+            .width = (unsigned int)continuousMat.cols,
+            .height = (unsigned int)continuousMat.rows,
+            .channels = (unsigned char)continuousMat.channels(),
+            .colorspace = QOI_SRGB,
+        };
+
+        int qoiBytes = 0;
+        auto qoiData = qoi_encode(continuousMat.ptr(), &desc, &qoiBytes);
+        if (!qoiData)
+            return false;
+
+        FrameHeader frameHeader{ continuousMat.cols, continuousMat.rows, continuousMat.channels(), duration, (uint32_t)qoiBytes };
+        auto headerPtr = (const uint8_t*)&frameHeader;
+        out.insert(out.end(), headerPtr, headerPtr + sizeof(frameHeader));
+        out.insert(out.end(), (uint8_t*)qoiData, (uint8_t*)qoiData + qoiBytes);
+        free(qoiData);
+        return true;
+    }
+
+    bool readFrame(const uint8_t*& ptr, const uint8_t* end, cv::Mat& mat, int& duration) {
+        if ((size_t)(end - ptr) < sizeof(FrameHeader))
+            return false;
+
+        FrameHeader frameHeader;
+        memcpy(&frameHeader, ptr, sizeof(frameHeader));
+        ptr += sizeof(frameHeader);
+        if ((size_t)(end - ptr) < frameHeader.qoiBytes)
+            return false;
+
+        qoi_desc desc;
+        auto pixels = qoi_decode(ptr, (int)frameHeader.qoiBytes, &desc, frameHeader.channels);
+        ptr += frameHeader.qoiBytes;
+        if (!pixels)
+            return false;
+
+        if ((int)desc.width != frameHeader.cols || (int)desc.height != frameHeader.rows) {
+            free(pixels);
+            return false;
+        }
+
+        mat = cv::Mat(frameHeader.rows, frameHeader.cols, CV_8UC(frameHeader.channels), pixels).clone();
+        free(pixels);
+        duration = frameHeader.duration;
+        return true;
+    }
+
+    uint64_t fnv1a64(const void* data, size_t size, uint64_t hash = 14695981039346656037ULL) {
+        auto bytes = (const uint8_t*)data;
+        for (size_t i = 0; i < size; i++) {
+            hash ^= bytes[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+}
+
+
+DiskCache::~DiskCache() {
+    stopWrite = true;
+    writeCond.notify_all();
+    if (writeThread.joinable())
+        writeThread.join();
+}
+
+
+wstring DiskCache::entryName(const wstring& path, const FileIdentity& identity) {
+    auto hash = fnv1a64(path.data(), path.size() * sizeof(wchar_t));
+    hash = fnv1a64(&identity.size, sizeof(identity.size), hash);
+    hash = fnv1a64(&identity.mtime, sizeof(identity.mtime), hash);
+    return std::format(L"{:016x}.jvc", hash);
+}
+
+
+vector<uint8_t> DiskCache::serialize(const wstring& path, const FileIdentity& identity, const ImageAsset& imageAsset) {
+    if (imageAsset.animationStream) // 流式解码的动画不缓存，全部帧解码后正是要避免的内存占用
+        return {};
+
+    const bool hasPrimary = !imageAsset.primaryFrame.empty();
+    if (hasPrimary && !isCacheableMat(imageAsset.primaryFrame))
+        return {};
+    for (const auto& frame : imageAsset.frames) {
+        if (!isCacheableMat(frame))
+            return {};
+    }
+
+    EntryHeader header{};
+    memcpy(header.magic, ENTRY_MAGIC, sizeof(header.magic));
+    header.version = ENTRY_VERSION;
+    header.fileSize = identity.size;
+    header.fileMtime = identity.mtime;
+    header.pathBytes = (uint32_t)(path.size() * sizeof(wchar_t));
+    header.format = (uint32_t)imageAsset.format;
+    header.hasPrimary = hasPrimary;
+    header.frameCount = (uint32_t)imageAsset.frames.size();
+    header.orientation = (uint32_t)imageAsset.orientation;
+    const string infoText = imageAsset.infoText(); // 元数据文本在此生成，读取缓存时直接得到文本
+    header.exifBytes = (uint32_t)infoText.size();
+
+    vector<uint8_t> out;
+    out.reserve(16 * 1024 * 1024);
+    auto headerPtr = (const uint8_t*)&header;
+    out.insert(out.end(), headerPtr, headerPtr + sizeof(header));
+    out.insert(out.end(), (const uint8_t*)path.data(), (const uint8_t*)path.data() + header.pathBytes);
+    out.insert(out.end(), infoText.begin(), infoText.end());
+
+    if (hasPrimary && !appendFrame(out, imageAsset.primaryFrame, 0))
+        return {};
+
+    for (size_t i = 0; i < imageAsset.frames.size(); i++) {
+        int duration = i < imageAsset.frameDurations.size() ? imageAsset.frameDurations[i] : 0;
+        if (!appendFrame(out, imageAsset.frames[i], duration))
+            return {};
+    }
+    return out;
+}
+
+
+bool DiskCache::deserialize(const uint8_t* data, size_t size, const wstring& path, const FileIdentity& identity, ImageAsset& imageAsset) {
+    if (size < sizeof(EntryHeader))
+        return false;
+
+    EntryHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (memcmp(header.magic, ENTRY_MAGIC, sizeof(header.magic)) || header.version != ENTRY_VERSION ||
+        header.fileSize != identity.size || header.fileMtime != identity.mtime ||
+        header.pathBytes != path.size() * sizeof(wchar_t))
+        return false;
+
+    const uint8_t* ptr = data + sizeof(header);
+    const uint8_t* end = data + size;
+    if ((size_t)(end - ptr) < (size_t)header.pathBytes + header.exifBytes)
+        return false;
+    if (memcmp(ptr, path.data(), header.pathBytes))
+        return false;
+    ptr += header.pathBytes;
+
+    ImageAsset asset;
+    asset.format = (ImageFormat)header.format;
+    asset.orientation = (header.orientation >= 1 && header.orientation <= 8) ? (int)header.orientation : 1;
+    asset.exifInfo.assign((const char*)ptr, header.exifBytes);
+    ptr += header.exifBytes;
+
+    int duration = 0;
+    if (header.hasPrimary && !readFrame(ptr, end, asset.primaryFrame, duration))
+        return false;
+
+    asset.frames.resize(header.frameCount);
+    asset.frameDurations.resize(header.frameCount);
+    for (uint32_t i = 0; i < header.frameCount; i++) {
+        if (!readFrame(ptr, end, asset.frames[i], asset.frameDurations[i]))
+            return false;
+    }
+
+    imageAsset = std::move(asset);
+    return true;
+}
+
+
+bool DiskCache::initDirLocked() {
+    if (hasInitDir)
+        return !cacheDir.empty();
+    hasInitDir = true;
+
+    wchar_t localAppDataPath[MAX_PATH];
+    if (FAILED(SHGetFolderPathW(NULL, CSIDL_LOCAL_APPDATA, NULL, 0, localAppDataPath)))
+        return false;
+
+    std::error_code ec;
+    auto dir = std::filesystem::path(localAppDataPath) / L"jarkViewer" / L"cache";
+    std::filesystem::create_directories(dir, ec);
+    if (ec) {
+        jarkUtils::log("DiskCache create dir failed: {} {}", jarkUtils::wstringToUtf8(dir.wstring()), ec.message());
+        return false;
+    }
+
+    cacheDir = dir.wstring() + L"\\";
+    return true;
+}
+
+
+bool DiskCache::read(const wstring& path, const FileIdentity& identity, ImageAsset& imageAsset) {
+    if (!isEnabled() || !identity.isValid())
+        return false;
+
+    wstring entryPath;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (!initDirLocked())
+            return false;
+        entryPath = cacheDir + entryName(path, identity);
+    }
+
+    HANDLE hFile = CreateFileW(entryPath.c_str(), GENERIC_READ | FILE_WRITE_ATTRIBUTES,
+        FILE_SHARE_READ | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    bool isHit = false;
+    LARGE_INTEGER fileSize{};
+    if (GetFileSizeEx(hFile, &fileSize) && fileSize.QuadPart > 0) {
+        HANDLE hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (hMapping) {
+            auto data = (const uint8_t*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+            if (data) {
+                isHit = deserialize(data, (size_t)fileSize.QuadPart, path, identity, imageAsset);
+                if (isHit)
+                    imageAsset.fileIdentity = identity;
+                UnmapViewOfFile(data);
+            }
+            CloseHandle(hMapping);
+        }
+    }
+
+    if (isHit) { // 以修改时间记录最近访问，供淘汰使用
+        FILETIME now;
+        GetSystemTimeAsFileTime(&now);
+        SetFileTime(hFile, nullptr, nullptr, &now);
+    }
+    CloseHandle(hFile);
+
+    if (!isHit) {
+        jarkUtils::log("DiskCache invalid entry: {}", jarkUtils::wstringToUtf8(entryPath));
+        DeleteFileW(entryPath.c_str());
+    }
+    return isHit;
+}
+
+
+void DiskCache::write(const wstring& path, const ImageAsset& imageAsset) {
+    if (!isEnabled() || imageAsset.format == ImageFormat::None)
+        return;
+
+    size_t bytes = imageAsset.primaryFrame.total() * imageAsset.primaryFrame.elemSize();
+    for (const auto& frame : imageAsset.frames)
+        bytes += frame.total() * frame.elemSize();
+    if (bytes == 0 || bytes > MAX_ENTRY_BYTES)
+        return;
+
+    if (!imageAsset.fileIdentity.isValid())
+        return;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (stopWrite || writeQueue.size() >= MAX_PENDING_WRITES)
+        return;
+
+    writeQueue.push({ path, imageAsset.fileIdentity, imageAsset });
+    if (!writeThread.joinable())
+        writeThread = std::thread(&DiskCache::writeWorker, this);
+    writeCond.notify_one();
+}
+
+
+void DiskCache::writeWorker() {
+    while (true) {
+        WriteTask task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            writeCond.wait(lock, [this] { return !writeQueue.empty() || stopWrite; });
+            if (stopWrite)
+                break;
+
+            task = std::move(writeQueue.front());
+            writeQueue.pop();
+            if (!initDirLocked())
+                continue;
+        }
+
+        // 首次写入前统计目录大小并清理，扫描目录不持有锁，不阻塞预读线程的 read
+        if (!hasScannedDir) {
+            hasScannedDir = true;
+            cleanup();
+        }
+
+        auto data = serialize(task.path, task.identity, task.imageAsset);
+        task.imageAsset = {};
+        if (data.empty())
+            continue;
+
+        const wstring entryPath = cacheDir + entryName(task.path, task.identity);
+        const wstring tmpPath = entryPath + L".tmp";
+
+        auto f = _wfopen(tmpPath.c_str(), L"wb");
+        if (!f) {
+            jarkUtils::log("DiskCache cannot write: {}", jarkUtils::wstringToUtf8(tmpPath));
+            continue;
+        }
+        bool isWriteOK = fwrite(data.data(), 1, data.size(), f) == data.size();
+        fclose(f);
+
+        if (!isWriteOK || !MoveFileExW(tmpPath.c_str(), entryPath.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+            jarkUtils::log("DiskCache write failed: {}", jarkUtils::wstringToUtf8(entryPath));
+            DeleteFileW(tmpPath.c_str());
+            continue;
+        }
+
+        bool isOverLimit;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            totalBytes += data.size();
+            isOverLimit = totalBytes > MAX_CACHE_BYTES;
+        }
+        if (isOverLimit)
+            cleanup();
+    }
+}
+
+
+// 重新统计缓存目录大小，超出上限时按最近访问时间删除最旧的条目，降到上限的 80%
+// 只在写入线程中调用，扫描和删除不持有锁（cacheDir 初始化后不再改变，读取中的条目以共享删除方式打开）
+void DiskCache::cleanup() {
+    struct EntryInfo {
+        std::filesystem::file_time_type time;
+        uint64_t size;
+        std::filesystem::path path;
+    };
+
+    std::error_code ec;
+    vector<EntryInfo> entries;
+    uint64_t dirBytes = 0;
+    for (const auto& dirEntry : std::filesystem::directory_iterator(cacheDir, ec)) {
+        if (!dirEntry.is_regular_file(ec))
+            continue;
+
+        auto ext = dirEntry.path().extension().wstring();
+        if (ext == L".tmp") { // 上次异常退出残留
+            std::filesystem::remove(dirEntry.path(), ec);
+            continue;
+        }
+        if (ext != L".jvc")
+            continue;
+
+        auto size = dirEntry.file_size(ec);
+        auto time = dirEntry.last_write_time(ec);
+        entries.push_back({ time, size, dirEntry.path() });
+        dirBytes += size;
+    }
+
+    if (dirBytes > MAX_CACHE_BYTES) {
+        std::ranges::sort(entries, {}, &EntryInfo::time);
+        for (const auto& entry : entries) {
+            if (dirBytes <= MAX_CACHE_BYTES / 10 * 8)
+                break;
+            if (std::filesystem::remove(entry.path, ec))
+                dirBytes -= entry.size;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    totalBytes = dirBytes;
+}
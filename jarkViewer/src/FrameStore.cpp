@@ -0,0 +1,182 @@
+#include "FrameStore.h"
+#include "qoi.h"
+#include <atomic>
+#include <execution>
+
+
+namespace {
+    // a 与 b 中不同像素的外接矩形，完全相同返回空矩形
+    cv::Rect diffRect(const cv::Mat& a, const cv::Mat& b) {
+        const size_t pixelBytes = a.elemSize();
+        const size_t rowBytes = a.cols * pixelBytes;
+
+        int top = 0;
+        while (top < a.rows && memcmp(a.ptr(top), b.ptr(top), rowBytes) == 0)
+            top++;
+        if (top == a.rows)
+            return {};
+
+        int bottom = a.rows - 1;
+        while (memcmp(a.ptr(bottom), b.ptr(bottom), rowBytes) == 0)
+            bottom--;
+
+        int left = a.cols, right = -1;
+        for (int y = top; y <= bottom; y++) {
+            auto pa = a.ptr(y), pb = b.ptr(y);
+            int x = 0;
+            while (x < left && memcmp(pa + x * pixelBytes, pb + x * pixelBytes, pixelBytes) == 0)
+                x++;
+            left = std::min(left, x);
+
+            x = a.cols - 1;
+            while (x > right && memcmp(pa + x * pixelBytes, pb + x * pixelBytes, pixelBytes) == 0)
+                x--;
+            right = std::max(right, x);
+        }
+        return { left, top, right - left + 1, bottom - top + 1 };
+    }
+
+    // QOI 不关心通道顺序，BGR(A) 原样存取
+    bool encodePatch(const cv::Mat& patch, vector<uint8_t>& out) {
+        cv::Mat continuousMat = patch.isContinuous() ? patch : patch.clone();
+        qoi_desc desc{
+            .width = (unsigned int)continuousMat.cols,
+            .height = (unsigned int)continuousMat.rows,
+            .channels = (unsigned char)continuousMat.channels(),
+            .colorspace = QOI_SRGB,
+        };
+
+        int qoiBytes = 0;
+        auto qoiData = qoi_encode(continuousMat.ptr(), &desc, &qoiBytes);
+        if (!qoiData)
+            return false;
+
+        out.assign((uint8_t*)qoiData, (uint8_t*)qoiData + qoiBytes);
+        free(qoiData);
+        return true;
+    }
+}
+
+
+std::shared_ptr<FrameStore> FrameStore::create(const std::vector<cv::Mat>& frames) {
+    if (frames.size() < 2)
+        return nullptr;
+
+    const auto size = frames[0].size();
+    const int type = frames[0].type();
+    if (type != CV_8UC3 && type != CV_8UC4)
+        return nullptr;
+    for (const auto& frame : frames) {
+        if (frame.size() != size || frame.type() != type)
+            return nullptr;
+    }
+
+    // 各帧的比较、压缩互不依赖，并行执行
+    const int count = (int)frames.size();
+    vector<cv::Rect> rects(count);
+    std::for_each(std::execution::par, rects.begin() + 1, rects.end(), [&](cv::Rect& rect) {
+        const auto i = &rect - rects.data();
+        rect = diffRect(frames[i - 1], frames[i]);
+        });
+
+    // 变化区域超过半帧，或距上一关键帧已达间隔时存为关键帧
+    std::shared_ptr<FrameStore> store(new FrameStore());
+    store->size = size;
+    store->type = type;
+    store->entries.resize(count);
+    const int frameArea = size.area();
+    int lastKey = 0;
+    for (int i = 0; i < count; i++) {
+        auto& entry = store->entries[i];
+        if (i == 0 || i - lastKey >= KEYFRAME_INTERVAL || rects[i].area() * 2 > frameArea) {
+            entry.isKey = true;
+            entry.rect = { 0, 0, size.width, size.height };
+            lastKey = i;
+        }
+        else {
+            entry.rect = rects[i];
+        }
+    }
+
+    std::atomic<bool> isFailed{ false };
+    std::for_each(std::execution::par, store->entries.begin(), store->entries.end(), [&](Entry& entry) {
+        const auto i = &entry - store->entries.data();
+        if (!entry.rect.empty() && !encodePatch(frames[i](entry.rect), entry.qoi))
+            isFailed = true;
+        });
+    if (isFailed)
+        return nullptr;
+
+    for (const auto& entry : store->entries)
+        store->dataBytes += entry.qoi.size();
+
+    // 压缩后仍超过原始大小的一半，不值得每次取帧都重建
+    const size_t rawBytes = (size_t)count * frameArea * frames[0].elemSize();
+    if (store->bytes() * 2 > rawBytes)
+        return nullptr;
+
+    return store;
+}
+
+
+size_t FrameStore::bytes() const {
+    return dataBytes + (size_t)size.area() * CV_ELEM_SIZE(type);
+}
+
+
+bool FrameStore::decodePatch(const Entry& entry) {
+    if (entry.rect.empty())
+        return true;
+
+    qoi_desc desc;
+    auto pixels = qoi_decode(entry.qoi.data(), (int)entry.qoi.size(), &desc, CV_MAT_CN(type));
+    if (!pixels)
+        return false;
+
+    const bool isValid = (int)desc.width == entry.rect.width && (int)desc.height == entry.rect.height;
+    if (isValid)
+        cv::Mat(entry.rect.height, entry.rect.width, type, pixels).copyTo(buffer(entry.rect));
+    free(pixels);
+    return isValid;
+}
+
+
+cv::Mat FrameStore::getFrame(int idx) {
+    if (idx < 0 || idx >= (int)entries.size())
+        return {};
+
+    std::lock_guard<std::mutex> lock(mutex);
+    if (idx == bufferIdx)
+        return buffer;
+
+    int keyIdx = idx;
+    while (!entries[keyIdx].isKey)
+        keyIdx--;
+
+    // 顺序播放时缓冲中的帧位于 [keyIdx, idx) 内，只需应用其后的增量
+    int startIdx = keyIdx;
+    if (bufferIdx >= keyIdx && bufferIdx < idx)
+        startIdx = bufferIdx + 1;
+
+    // 缓冲仍被外部持有（正在绘制或导出）时另开一份，不改写已返回的帧
+    // 其他线程复制/释放返回的 Mat 时以原子操作增减 refcount，此处也须原子读取
+    const bool isShared = !buffer.empty() && buffer.u &&
+        std::atomic_ref<int>(buffer.u->refcount).load(std::memory_order_acquire) > 1;
+    if (startIdx == keyIdx) {
+        if (buffer.empty() || isShared)
+            buffer = cv::Mat(size, type);
+    }
+    else if (isShared) {
+        buffer = buffer.clone();
+    }
+
+    for (int i = startIdx; i <= idx; i++) {
+        if (!decodePatch(entries[i])) {
+            jarkUtils::log("FrameStore decode failed at frame {}/{}", i, entries.size());
+            bufferIdx = -1;
+            return {};
+        }
+    }
+    bufferIdx = idx;
+    return buffer;
+}
@@ -48,15 +48,19 @@ static std::string jxlStatusCode2String(JxlDecoderStatus status) {
 }
 
 
-ImageAsset ImageDatabase::loadJXL(wstring_view path, const vector<uint8_t>& buf) {
+ImageAsset ImageDatabase::loadJXL(wstring_view path, span<const uint8_t> buf) {
     ImageAsset imageAsset;
 
     // Multi-threaded parallel runner.
     auto runner = JxlResizableParallelRunnerMake(nullptr);
 
+    // 预读线程中的大图订阅渐进事件，DC 解码完成后先发布其预览
+    const bool isMaybeProvisional = loadCancelFlag() && !isReloadRequest();
+    bool isNeedProvisional = false;
+
     auto dec = JxlDecoderMake(nullptr);
     JxlDecoderStatus status = JxlDecoderSubscribeEvents(dec.get(),
-        JXL_DEC_BASIC_INFO | JXL_DEC_COLOR_ENCODING | JXL_DEC_FULL_IMAGE);
+        JXL_DEC_BASIC_INFO | JXL_DEC_COLOR_ENCODING | JXL_DEC_FULL_IMAGE | (isMaybeProvisional ? JXL_DEC_FRAME_PROGRESSION : 0));
     if (JXL_DEC_SUCCESS != status) {
         jarkUtils::log("JxlDecoderSubscribeEvents failed\n{}\n{}",
             jarkUtils::wstringToUtf8(path),
@@ -81,6 +85,11 @@ ImageAsset ImageDatabase::loadJXL(wstring_view path, const vector<uint8_t>& buf)
     cv::Mat image;
     int duration_ms = 0;
     for (;;) {
+        if (isLoadCancelled()) { // 已切走，不再需要
+            imageAsset.frames.clear();
+            break;
+        }
+
         status = JxlDecoderProcessInput(dec.get());
 
         if (status == JXL_DEC_ERROR) {
@@ -104,6 +113,8 @@ ImageAsset ImageDatabase::loadJXL(wstring_view path, const vector<uint8_t>& buf)
             }
 
             duration_ms = info.animation.tps_numerator == 0 ? 0 : (info.animation.tps_denominator * 1000 / info.animation.tps_numerator);
+            isNeedProvisional = isMaybeProvisional && !info.have_animation &&
+                isWorthProvisional(wstring(path), (double)info.xsize * info.ysize);
             JxlResizableParallelRunnerSetThreads(
                 runner.get(),
                 JxlResizableParallelRunnerSuggestThreads(info.xsize, info.ysize));
@@ -156,6 +167,19 @@ ImageAsset ImageDatabase::loadJXL(wstring_view path, const vector<uint8_t>& buf)
                 break;
             }
         }
+        else if (status == JXL_DEC_FRAME_PROGRESSION) {
+            // 输出缓冲区中为 DC（1/8 分辨率）上采样的图像，缩小后作为临时显示，之后继续完整解码
+            if (isNeedProvisional && !image.empty() && JXL_DEC_SUCCESS == JxlDecoderFlushImage(dec.get())) {
+                isNeedProvisional = false;
+                auto provisionalAsset = makeProvisionalAsset(image, image.size(),
+                    ExifParse::getSimpleInfo(path, image.cols, image.rows, buf.data(), buf.size()));
+                if (provisionalAsset.format != ImageFormat::None) {
+                    cv::cvtColor(provisionalAsset.previewFrame, provisionalAsset.previewFrame, cv::COLOR_BGRA2RGBA);
+                    Metrics::addCounter("load.provisional");
+                    publishProvisional(wstring(path), std::move(provisionalAsset));
+                }
+            }
+        }
         else if (status == JXL_DEC_FULL_IMAGE) {
             cv::cvtColor(image, image, cv::COLOR_BGRA2RGBA);
             imageAsset.frames.push_back(image.clone());
@@ -192,6 +216,64 @@ ImageAsset ImageDatabase::loadJXL(wstring_view path, const vector<uint8_t>& buf)
     return imageAsset;
 }
 
+// 逐帧解码 JXL 动画，每帧输出合成后的完整画布
+class JxlAnimationSource : public AnimationSource {
+public:
+    explicit JxlAnimationSource(std::shared_ptr<const vector<uint8_t>> data)
+        : data(std::move(data)), runner(JxlResizableParallelRunnerMake(nullptr)), dec(JxlDecoderMake(nullptr)) {
+        if (JXL_DEC_SUCCESS != JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_BASIC_INFO | JXL_DEC_FULL_IMAGE) ||
+            JXL_DEC_SUCCESS != JxlDecoderSetParallelRunner(dec.get(), JxlResizableParallelRunner, runner.get()) ||
+            JXL_DEC_SUCCESS != JxlDecoderSetInput(dec.get(), this->data->data(), this->data->size())) {
+            dec.reset();
+            return;
+        }
+        JxlDecoderCloseInput(dec.get());
+    }
+
+    bool next(cv::Mat& frame, int& durationMs) override {
+        while (dec) {
+            const auto status = JxlDecoderProcessInput(dec.get());
+            if (status == JXL_DEC_BASIC_INFO) {
+                JxlBasicInfo info{};
+                if (JXL_DEC_SUCCESS != JxlDecoderGetBasicInfo(dec.get(), &info))
+                    break;
+                duration_ms = info.animation.tps_numerator == 0 ? 0 : (info.animation.tps_denominator * 1000 / info.animation.tps_numerator);
+                JxlResizableParallelRunnerSetThreads(runner.get(), JxlResizableParallelRunnerSuggestThreads(info.xsize, info.ysize));
+            }
+            else if (status == JXL_DEC_NEED_IMAGE_OUT_BUFFER) {
+                size_t buffer_size = 0;
+                if (JXL_DEC_SUCCESS != JxlDecoderImageOutBufferSize(dec.get(), &format, &buffer_size))
+                    break;
+                JxlBasicInfo info{};
+                if (JXL_DEC_SUCCESS != JxlDecoderGetBasicInfo(dec.get(), &info) || buffer_size != 4ULL * info.xsize * info.ysize)
+                    break;
+                if (image.empty())
+                    image = cv::Mat(info.ysize, info.xsize, CV_8UC4);
+                if (JXL_DEC_SUCCESS != JxlDecoderSetImageOutBuffer(dec.get(), &format, image.ptr(), buffer_size))
+                    break;
+            }
+            else if (status == JXL_DEC_FULL_IMAGE) {
+                cv::cvtColor(image, frame, cv::COLOR_RGBA2BGRA);
+                durationMs = duration_ms;
+                return true;
+            }
+            else { // JXL_DEC_SUCCESS 已到末尾，或出错
+                break;
+            }
+        }
+        dec.reset();
+        return false;
+    }
+
+private:
+    std::shared_ptr<const vector<uint8_t>> data;
+    JxlResizableParallelRunnerPtr runner;
+    JxlDecoderPtr dec;
+    JxlPixelFormat format = { 4, JXL_TYPE_UINT8, JXL_NATIVE_ENDIAN, 0 };
+    cv::Mat image; // 解码器的输出缓冲，每帧转换后复制到新的 Mat
+    int duration_ms = 0;
+};
+
 static std::string statusExplain(WP2Status status) {
     switch (status) {
     case WP2_STATUS_OK:
@@ -235,83 +317,110 @@ static std::string statusExplain(WP2Status status) {
     }
 }
 
+// 解码器输出缓冲转为 BGRA/BGR，复制到新的 Mat，不改动解码器的缓冲（动画的后续帧在其上合成）
+static cv::Mat wp2BufferToMat(const WP2::ArgbBuffer& output_buffer) {
+    cv::Mat img; // Need BGRA or BGR
+
+    switch (output_buffer.format())
+    {
+    case WP2_Argb_32:
+    case WP2_ARGB_32:
+    case WP2_XRGB_32: {// A-RGB -> BGR-A 大小端互转
+        img = cv::Mat(output_buffer.height(), output_buffer.width(), CV_8UC4, (void*)output_buffer.GetRow(0), output_buffer.stride()).clone();
+        auto srcPtr = (uint32_t*)img.ptr();
+        auto pixelCount = (size_t)img.cols * img.rows;
+        for (size_t i = 0; i < pixelCount; ++i) {
+            srcPtr[i] = swap_endian(srcPtr[i]);
+        }
+    }break;
+
+    case WP2_rgbA_32:
+    case WP2_RGBA_32:
+    case WP2_RGBX_32: {
+        cv::cvtColor(cv::Mat(output_buffer.height(), output_buffer.width(), CV_8UC4, (void*)output_buffer.GetRow(0), output_buffer.stride()),
+            img, cv::COLOR_RGBA2BGRA);
+    }break;
+
+    case WP2_bgrA_32:
+    case WP2_BGRA_32:
+    case WP2_BGRX_32: {
+        img = cv::Mat(output_buffer.height(), output_buffer.width(), CV_8UC4, (void*)output_buffer.GetRow(0), output_buffer.stride()).clone();
+    }break;
+
+    case WP2_RGB_24: {
+        cv::cvtColor(cv::Mat(output_buffer.height(), output_buffer.width(), CV_8UC3, (void*)output_buffer.GetRow(0), output_buffer.stride()),
+            img, cv::COLOR_RGB2BGR);
+    }break;
+
+    case WP2_BGR_24: {
+        img = cv::Mat(output_buffer.height(), output_buffer.width(), CV_8UC3, (void*)output_buffer.GetRow(0), output_buffer.stride()).clone();
+    }break;
+
+    case WP2_Argb_38: { // HDR format: 8 bits for A, 10 bits per RGB.
+        img = cv::Mat(output_buffer.height(), output_buffer.width(), CV_8UC4); // 8-bit BGRA
+
+        for (uint32_t y = 0; y < output_buffer.height(); ++y) {
+            const uint8_t* src_row = (const uint8_t*)output_buffer.GetRow(y);
+            cv::Vec4b* dst_row = img.ptr<cv::Vec4b>(y);
+
+            for (uint32_t x = 0; x < output_buffer.width(); ++x) {
+                // src_row contains 5 bytes per pixel: A (8 bits), R (10 bits), G (10 bits), B (10 bits)
+                const uint8_t A = src_row[0];           // 8 bits for alpha
+                const uint16_t R = ((src_row[1] << 2) | (src_row[2] >> 6)); // 10 bits for red
+                const uint16_t G = ((src_row[2] & 0x3F) << 4) | (src_row[3] >> 4); // 10 bits for green
+                const uint16_t B = ((src_row[3] & 0x0F) << 6) | (src_row[4] >> 2); // 10 bits for blue
+
+                // Map 10-bit values (0-1023) to 8-bit values (0-255)
+                dst_row[x] = cv::Vec4b(
+                    B >> 2,  // Blue (10 -> 8 bits)
+                    G >> 2,  // Green (10 -> 8 bits)
+                    R >> 2,  // Red (10 -> 8 bits)
+                    A        // Alpha (already 8 bits)
+                );
+
+                src_row += 5; // Move to next pixel (5 bytes per pixel in WP2_Argb_38)
+            }
+        }
+    } break;
+    }
+
+    return img;
+}
+
+
+// 逐帧解码 WP2 动画
+class Wp2AnimationSource : public AnimationSource {
+public:
+    explicit Wp2AnimationSource(std::shared_ptr<const vector<uint8_t>> data)
+        : data(std::move(data)), decoder(this->data->data(), this->data->size()) {}
+
+    bool next(cv::Mat& frame, int& durationMs) override {
+        uint32_t duration_ms = 0;
+        if (!decoder.ReadFrame(&duration_ms))
+            return false;
+        frame = wp2BufferToMat(decoder.GetPixels());
+        durationMs = (int)duration_ms;
+        return !frame.empty();
+    }
+
+private:
+    std::shared_ptr<const vector<uint8_t>> data;
+    WP2::ArrayDecoder decoder;
+};
+
 // https://chromium.googlesource.com/codecs/libwebp2  commit 96720e6410284ebebff2007d4d87d7557361b952  Date:   Mon Sep 9 18:11:04 2024 +0000
 // 网络找的不少wp2图像无法解码，使用 libwebp2 的 cwp2.exe 工具编码的 .wp2 图片可以正常解码
-ImageAsset ImageDatabase::loadWP2(wstring_view path, const std::vector<uint8_t>& buf) {
+ImageAsset ImageDatabase::loadWP2(wstring_view path, span<const uint8_t> buf) {
     ImageAsset imageAsset;
 
     WP2::ArrayDecoder decoder(buf.data(), buf.size());
     uint32_t duration_ms = 0;
 
     while (decoder.ReadFrame(&duration_ms)) {
-        auto& output_buffer = decoder.GetPixels();
-        cv::Mat img; // Need BGRA or BGR
-
-        switch (output_buffer.format())
-        {
-        case WP2_Argb_32:
-        case WP2_ARGB_32:
-        case WP2_XRGB_32: {// A-RGB -> BGR-A 大小端互转
-            img = cv::Mat(output_buffer.height(), output_buffer.width(), CV_8UC4, (void*)output_buffer.GetRow(0), output_buffer.stride());
-            auto srcPtr = (uint32_t*)img.ptr();
-            auto pixelCount = (size_t)img.cols * img.rows;
-            for (size_t i = 0; i < pixelCount; ++i) {
-                srcPtr[i] = swap_endian(srcPtr[i]);
-            }
-        }break;
-
-        case WP2_rgbA_32:
-        case WP2_RGBA_32:
-        case WP2_RGBX_32: {
-            img = cv::Mat(output_buffer.height(), output_buffer.width(), CV_8UC4, (void*)output_buffer.GetRow(0), output_buffer.stride());
-            cv::cvtColor(img, img, cv::COLOR_RGBA2BGRA);
-        }break;
-
-        case WP2_bgrA_32:
-        case WP2_BGRA_32:
-        case WP2_BGRX_32: {
-            img = cv::Mat(output_buffer.height(), output_buffer.width(), CV_8UC4, (void*)output_buffer.GetRow(0), output_buffer.stride());
-        }break;
-
-        case WP2_RGB_24: {
-            img = cv::Mat(output_buffer.height(), output_buffer.width(), CV_8UC3, (void*)output_buffer.GetRow(0), output_buffer.stride());
-            cv::cvtColor(img, img, cv::COLOR_RGB2BGR);
-        }break;
-
-        case WP2_BGR_24: {
-            img = cv::Mat(output_buffer.height(), output_buffer.width(), CV_8UC3, (void*)output_buffer.GetRow(0), output_buffer.stride());
-        }break;
-
-        case WP2_Argb_38: { // HDR format: 8 bits for A, 10 bits per RGB.
-            img = cv::Mat(output_buffer.height(), output_buffer.width(), CV_8UC4); // 8-bit BGRA
-
-            for (uint32_t y = 0; y < output_buffer.height(); ++y) {
-                const uint8_t* src_row = (const uint8_t*)output_buffer.GetRow(y);
-                cv::Vec4b* dst_row = img.ptr<cv::Vec4b>(y);
-
-                for (uint32_t x = 0; x < output_buffer.width(); ++x) {
-                    // src_row contains 5 bytes per pixel: A (8 bits), R (10 bits), G (10 bits), B (10 bits)
-                    const uint8_t A = src_row[0];           // 8 bits for alpha
-                    const uint16_t R = ((src_row[1] << 2) | (src_row[2] >> 6)); // 10 bits for red
-                    const uint16_t G = ((src_row[2] & 0x3F) << 4) | (src_row[3] >> 4); // 10 bits for green
-                    const uint16_t B = ((src_row[3] & 0x0F) << 6) | (src_row[4] >> 2); // 10 bits for blue
-
-                    // Map 10-bit values (0-1023) to 8-bit values (0-255)
-                    dst_row[x] = cv::Vec4b(
-                        B >> 2,  // Blue (10 -> 8 bits)
-                        G >> 2,  // Green (10 -> 8 bits)
-                        R >> 2,  // Red (10 -> 8 bits)
-                        A        // Alpha (already 8 bits)
-                    );
-
-                    src_row += 5; // Move to next pixel (5 bytes per pixel in WP2_Argb_38)
-                }
-            }
-        } break;
-        }
+        auto img = wp2BufferToMat(decoder.GetPixels());
 
         if (!img.empty()) {
-            imageAsset.frames.push_back(img.clone());
+            imageAsset.frames.push_back(std::move(img));
             imageAsset.frameDurations.push_back(duration_ms);
         }
     }
@@ -340,8 +449,16 @@ ImageAsset ImageDatabase::loadWP2(wstring_view path, const std::vector<uint8_t>&
 }
 
 
-ImageAsset ImageDatabase::loadBPG(wstring_view path, const std::vector<uchar>& buf) {
+// 多个预读线程同时解码时，每张 BPG 的 WPP 行线程按逻辑核心数平分，避免 4 个预读线程各开满核心数的线程
+int ImageDatabase::getBPGSliceThreads() {
+    const int cores = (int)std::max(std::thread::hardware_concurrency(), 1u);
+    return std::max(cores / (int)std::max<size_t>(preloadThreads(), 1), 1);
+}
+
+
+ImageAsset ImageDatabase::loadBPG(wstring_view path, span<const uint8_t> buf) {
     auto decoderContext = bpg_decoder_open();
+    bpg_decoder_set_threads(decoderContext, getBPGSliceThreads());
     if (bpg_decoder_decode(decoderContext, buf.data(), (int)buf.size()) < 0) {
         jarkUtils::log("cvMat cannot decode: {}", jarkUtils::wstringToUtf8(path));
         return {};
@@ -409,11 +526,114 @@ ImageAsset ImageDatabase::loadBPG(wstring_view path, const std::vector<uchar>& b
 }
 
 
+std::string ImageDatabase::checkBPGSimd() {
+    string report = "HEVC SIMD 与 C 版本逐位比对（随机数据）\n";
+    int totalFails = 0;
+    for (int bitDepth = 8; bitDepth <= 14; bitDepth++) {
+        char failed[512]{};
+        const int fails = bpg_decoder_check_simd(bitDepth, failed, sizeof(failed));
+        if (fails < 0)
+            return report + "未启用 SIMD（未编译或 CPU 不支持 SSE2），解码全部使用 C 版本\n";
+        totalFails += fails;
+        report += fails ? std::format("{:>2} 位: {} 个不一致  {}\n", bitDepth, fails, failed) : std::format("{:>2} 位: 一致\n", bitDepth);
+    }
+    report += totalFails ? "存在不一致，请反馈" : "全部一致";
+    return report;
+}
+
+
+static wstring getLowerExt(const wstring& path);
+
+std::string ImageDatabase::benchmarkBPG(wstring_view dirPath) {
+    // 预先映射文件，只统计 HEVC 解码耗时，不含像素格式转换
+    std::list<MappedFile> files;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dirPath, ec)) {
+        if (files.size() >= 100)
+            break;
+        if (!entry.is_regular_file(ec) || getLowerExt(entry.path().wstring()) != L"bpg")
+            continue;
+        if (!files.emplace_back().open(entry.path().wstring()) || files.back().size() < 16)
+            files.pop_back();
+    }
+    if (files.empty())
+        return std::format("文件夹中没有可读取的 BPG 文件: {}", jarkUtils::wstringToUtf8(dirPath));
+
+    // 解码一个文件，outputHash 非空时另取第一帧的 RGBA64 输出计算哈希（不计入耗时）
+    auto decodeFile = [](const MappedFile& file, int threadCount, size_t* outputHash) {
+        auto decoderContext = bpg_decoder_open();
+        bpg_decoder_set_threads(decoderContext, threadCount);
+        bool isOK = bpg_decoder_decode(decoderContext, file.data(), (int)file.size()) >= 0;
+        if (isOK && outputHash) {
+            BPGImageInfo info{};
+            bpg_decoder_get_info(decoderContext, &info);
+            isOK = bpg_decoder_start(decoderContext, BPG_OUTPUT_FORMAT_RGBA64) == 0;
+            vector<uint16_t> line((size_t)info.width * 4);
+            size_t hash = 0;
+            for (uint32_t y = 0; isOK && y < info.height; y++) {
+                bpg_decoder_get_line(decoderContext, line.data());
+                hash = hash * 31 + std::hash<string_view>{}(string_view((const char*)line.data(), line.size() * sizeof(uint16_t)));
+            }
+            *outputHash = hash;
+        }
+        bpg_decoder_close(decoderContext);
+        return isOK;
+        };
+
+    auto decodeAll = [&](int threadCount) {
+        int failedCount = 0;
+        for (const auto& file : files)
+            failedCount += decodeFile(file, threadCount, nullptr) ? 0 : 1;
+        return failedCount;
+        };
+
+    // 预热一遍，文件页读入内存，各线程数下测得的都是纯解码耗时；单线程的输出作为基准，多线程 WPP 解码须与其逐位一致
+    int failedCount = 0;
+    vector<size_t> referenceHashes(files.size());
+    auto referenceIt = referenceHashes.begin();
+    for (const auto& file : files)
+        failedCount += decodeFile(file, 1, &*referenceIt++) ? 0 : 1;
+
+    const int rounds = 3;
+    const int maxThreads = (int)std::max(std::thread::hardware_concurrency(), 1u);
+
+    string report = std::format("BPG 解码耗时  文件数: {}  解码失败: {}  每个线程数解码 {} 遍\n", files.size(), failedCount, rounds);
+    double singleThreadMs = 0;
+    int totalMismatches = 0;
+    for (int threadCount = 1; ; threadCount = std::min(threadCount * 2, maxThreads)) {
+        const auto startTime = std::chrono::steady_clock::now();
+        for (int i = 0; i < rounds; i++)
+            decodeAll(threadCount);
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        const double msPerImage = elapsedMs / (rounds * files.size());
+        if (threadCount == 1)
+            singleThreadMs = msPerImage;
+
+        int mismatches = 0;
+        referenceIt = referenceHashes.begin();
+        for (const auto& file : files) {
+            size_t hash = 0;
+            if (decodeFile(file, threadCount, &hash) && hash != *referenceIt)
+                mismatches++;
+            ++referenceIt;
+        }
+        totalMismatches += mismatches;
+        report += std::format("{:>3} 线程: {:>10.2f} ms/张  {:.2f}x  {}\n", threadCount, msPerImage, singleThreadMs / std::max(msPerImage, 1e-6),
+            mismatches ? std::format("{} 张输出与单线程不一致", mismatches) : "输出一致");
+
+        if (threadCount == maxThreads)
+            break;
+    }
+    report += totalMismatches ? "多线程解码输出存在不一致，请反馈" : "各线程数的解码输出均与单线程一致";
+    return report;
+}
+
+
 // HEIC ONLY, AVIF not support
 // https://github.com/strukturag/libheif
 // vcpkg install libheif:x64-windows-static
 // vcpkg install libheif[hevc]:x64-windows-static
-cv::Mat ImageDatabase::loadHeic(wstring_view path, const vector<uint8_t>& buf) {
+cv::Mat ImageDatabase::loadHeic(wstring_view path, span<const uint8_t> buf) {
     if (buf.empty())
         return {};
 
@@ -448,9 +668,18 @@ cv::Mat ImageDatabase::loadHeic(wstring_view path, const vector<uint8_t>& buf) {
         return {};
     }
 
+    // 解码可能在 libheif 的后台线程回调取消检查，故传入取消标志本身
+    heif_decoding_options* options = heif_decoding_options_alloc();
+    options->progress_user_data = (void*)loadCancelFlag();
+    options->cancel_decoding = [](void* userData) -> int {
+        auto cancelFlag = (const std::atomic<bool>*)userData;
+        return cancelFlag && cancelFlag->load(std::memory_order_relaxed);
+        };
+
     // decode the image and convert colorspace to RGB, saved as 24bit interleaved
     heif_image* img = nullptr;
-    err = heif_decode_image(handle, &img, heif_colorspace_RGB, heif_chroma_interleaved_RGBA, nullptr);
+    err = heif_decode_image(handle, &img, heif_colorspace_RGB, heif_chroma_interleaved_RGBA, options);
+    heif_decoding_options_free(options);
     if (err.code) {
         jarkUtils::log("Error: {}", jarkUtils::wstringToUtf8(path));
         jarkUtils::log("heif_decode_image error: {}", err.message);
@@ -478,10 +707,40 @@ cv::Mat ImageDatabase::loadHeic(wstring_view path, const vector<uint8_t>& buf) {
 }
 
 
+// HEIC 主图的缩略图项（通常长边 320px 左右），解码很快，libheif 会应用与主图相同的旋转/镜像
+static cv::Mat loadHeicThumbnail(span<const uint8_t> buf) {
+    heif_context* ctx = heif_context_alloc();
+    heif_image_handle* handle = nullptr;
+    heif_image_handle* thumbHandle = nullptr;
+    heif_image* img = nullptr;
+    heif_item_id thumbId = 0;
+
+    cv::Mat matImg;
+    if (heif_context_read_from_memory_without_copy(ctx, buf.data(), buf.size(), nullptr).code == heif_error_Ok &&
+        heif_context_get_primary_image_handle(ctx, &handle).code == heif_error_Ok &&
+        heif_image_handle_get_list_of_thumbnail_IDs(handle, &thumbId, 1) == 1 &&
+        heif_image_handle_get_thumbnail(handle, thumbId, &thumbHandle).code == heif_error_Ok &&
+        heif_decode_image(thumbHandle, &img, heif_colorspace_RGB, heif_chroma_interleaved_RGBA, nullptr).code == heif_error_Ok) {
+        int stride = 0;
+        const uint8_t* data = heif_image_get_plane_readonly(img, heif_channel_interleaved, &stride);
+        const int width = heif_image_get_width(img, heif_channel_interleaved);
+        const int height = heif_image_get_height(img, heif_channel_interleaved);
+        if (data && width > 0 && height > 0)
+            cv::cvtColor(cv::Mat(height, width, CV_8UC4, (uint8_t*)data, stride), matImg, cv::COLOR_RGBA2BGRA);
+    }
+
+    if (img) heif_image_release(img);
+    if (thumbHandle) heif_image_handle_release(thumbHandle);
+    if (handle) heif_image_handle_release(handle);
+    heif_context_free(ctx);
+    return matImg;
+}
+
+
 // vcpkg install libavif[core,aom,dav1d]:x64-windows-static
 // https://github.com/AOMediaCodec/libavif/issues/1451#issuecomment-1606903425
 // TODO 部分图像仍不能正常解码
-cv::Mat ImageDatabase::loadAvif(wstring_view path, const vector<uint8_t>& buf) {
+cv::Mat ImageDatabase::loadAvif(wstring_view path, span<const uint8_t> buf) {
     avifImage* image = avifImageCreateEmpty();
     if (image == nullptr) {
         jarkUtils::log("avifImageCreateEmpty failure: {}", jarkUtils::wstringToUtf8(path));
@@ -497,6 +756,13 @@ cv::Mat ImageDatabase::loadAvif(wstring_view path, const vector<uint8_t>& buf) {
 
     decoder->strictFlags = AVIF_STRICT_DISABLED;  // 严格模式下，老旧的不标准格式会解码失败
 
+    // libavif 没有取消回调，只能在解码前后的各阶段之间检查
+    if (isLoadCancelled()) {
+        avifImageDestroy(image);
+        avifDecoderDestroy(decoder);
+        return {};
+    }
+
     avifResult result = avifDecoderReadMemory(decoder, image, buf.data(), buf.size());
     if (result != AVIF_RESULT_OK) {
         jarkUtils::log("avifDecoderReadMemory failure: {} {}", jarkUtils::wstringToUtf8(path), avifResultToString(result));
@@ -505,6 +771,12 @@ cv::Mat ImageDatabase::loadAvif(wstring_view path, const vector<uint8_t>& buf) {
         return {};
     }
 
+    if (isLoadCancelled()) {
+        avifImageDestroy(image);
+        avifDecoderDestroy(decoder);
+        return {};
+    }
+
     avifRGBImage rgb;
     avifRGBImageSetDefaults(&rgb, image);
     result = avifRGBImageAllocatePixels(&rgb);
@@ -562,7 +834,18 @@ cv::Mat ImageDatabase::loadAvif(wstring_view path, const vector<uint8_t>& buf) {
 }
 
 
-cv::Mat ImageDatabase::loadRaw(wstring_view path, const vector<uint8_t>& buf) {
+// LibRaw 的 flip 转为 EXIF 方向
+static int rawFlipToOrientation(int flip) {
+    switch (flip) {
+    case 3: return 3;
+    case 5: return 8;
+    case 6: return 6;
+    default: return 1;
+    }
+}
+
+
+cv::Mat ImageDatabase::loadRaw(wstring_view path, span<const uint8_t> buf, double scale) {
     if (buf.empty()) {
         jarkUtils::log("Buf is empty: {}", jarkUtils::wstringToUtf8(path));
         return {};
@@ -570,6 +853,16 @@ cv::Mat ImageDatabase::loadRaw(wstring_view path, const vector<uint8_t>& buf) {
 
     auto rawProcessor = std::make_unique<LibRaw>();
 
+    // 只需一半以下分辨率时，每个 2x2 拜耳单元直接合成一个像素，跳过去马赛克插值
+    if (scale <= 0.5)
+        rawProcessor->imgdata.params.half_size = 1;
+
+    // 返回非0则 LibRaw 以 LIBRAW_CANCELLED_BY_CALLBACK 中止处理
+    rawProcessor->set_progress_handler([](void* data, LibRaw_progress, int, int) -> int {
+        auto cancelFlag = (const std::atomic<bool>*)data;
+        return cancelFlag && cancelFlag->load(std::memory_order_relaxed);
+        }, (void*)loadCancelFlag());
+
     int ret = rawProcessor->open_buffer(buf.data(), buf.size());
     if (ret != LIBRAW_SUCCESS) {
         jarkUtils::log("Cannot open RAW file: {} {}", jarkUtils::wstringToUtf8(path), libraw_strerror(ret));
@@ -605,6 +898,71 @@ cv::Mat ImageDatabase::loadRaw(wstring_view path, const vector<uint8_t>& buf) {
 }
 
 
+// 绝大部分相机在 RAW 中内嵌了全尺寸或接近屏幕尺寸的 JPEG 预览，取出解码只需 JPEG 的耗时
+// 预览不够大或宽高比与原图不一致（裁切/黑边）时返回 ImageFormat::None，由调用方解码原图
+ImageAsset ImageDatabase::loadRawPreview(wstring_view path, span<const uint8_t> buf) {
+    auto rawProcessor = std::make_unique<LibRaw>();
+    if (rawProcessor->open_buffer(buf.data(), buf.size()) != LIBRAW_SUCCESS)
+        return { ImageFormat::None };
+
+    const auto& sizes = rawProcessor->imgdata.sizes;
+    const auto& thumbnail = rawProcessor->imgdata.thumbnail;
+    if (sizes.width == 0 || sizes.height == 0 || thumbnail.tlength == 0)
+        return { ImageFormat::None };
+
+    const bool isTransposed = sizes.flip & 4;
+    const cv::Size fullSize(isTransposed ? sizes.height : sizes.width, isTransposed ? sizes.width : sizes.height);
+    const auto screenSize = getScreenSize();
+    const double previewScale = std::min({ (double)screenSize.width / fullSize.width, (double)screenSize.height / fullSize.height, 1.0 });
+    const double targetLongSide = std::max(fullSize.width, fullSize.height) * previewScale;
+
+    // 元数据中的预览尺寸明显不足时不必解码
+    const int thumbLongSide = std::max<int>(thumbnail.twidth, thumbnail.theight);
+    if (thumbLongSide > 0 && thumbLongSide < targetLongSide * RAW_PREVIEW_MIN_COVERAGE)
+        return { ImageFormat::None };
+
+    if (rawProcessor->unpack_thumb() != LIBRAW_SUCCESS)
+        return { ImageFormat::None };
+
+    int ret = LIBRAW_SUCCESS;
+    libraw_processed_image_t* thumb = rawProcessor->dcraw_make_mem_thumb(&ret);
+    if (thumb == nullptr) {
+        jarkUtils::log("Cannot make RAW thumbnail: {} {}", jarkUtils::wstringToUtf8(path), libraw_strerror(ret));
+        return { ImageFormat::None };
+    }
+
+    cv::Mat img;
+    if (thumb->type == LIBRAW_IMAGE_JPEG) {
+        // 全尺寸的内嵌 JPEG 同样可缩小解码
+        const double thumbScale = thumbLongSide > 0 ? targetLongSide / thumbLongSide : 1.0;
+        img = loadMat(path, { thumb->data, thumb->data_size }, thumbScale);
+    }
+    else if (thumb->type == LIBRAW_IMAGE_BITMAP && thumb->bits == 8 && (thumb->colors == 3 || thumb->colors == 1)) {
+        cv::Mat bitmap(thumb->height, thumb->width, thumb->colors == 3 ? CV_8UC3 : CV_8UC1, thumb->data);
+        cv::cvtColor(bitmap, img, thumb->colors == 3 ? cv::COLOR_RGB2BGR : cv::COLOR_GRAY2BGR);
+    }
+    LibRaw::dcraw_clear_mem(thumb);
+
+    if (img.empty())
+        return { ImageFormat::None };
+
+    // 预览保持传感器方向，宽高比需与传感器有效区域一致
+    const double thumbAspect = (double)img.cols / img.rows;
+    const double rawAspect = (double)sizes.width / sizes.height;
+    if (std::abs(thumbAspect - rawAspect) > rawAspect * 0.02 ||
+        std::max(img.cols, img.rows) < targetLongSide * RAW_PREVIEW_MIN_COVERAGE)
+        return { ImageFormat::None };
+
+    Metrics::addCounter("raw.embeddedPreview");
+
+    auto imageAsset = makeScaledAsset(img, { previewScale, fullSize },
+        ExifParse::getSimpleInfo(path, fullSize.width, fullSize.height, buf.data(), buf.size()), rawFlipToOrientation(sizes.flip));
+    imageAsset.metadata = ExifParse::parse(path, buf.data(), buf.size());
+    imageAsset.isEmbeddedPreview = true;
+    return imageAsset;
+}
+
+
 cv::Mat ImageDatabase::readDibFromMemory(const uint8_t* data, size_t size) {
     // 确保有足够的数据用于DIB头
     if (size < sizeof(DibHeader)) {
@@ -759,7 +1117,7 @@ cv::Mat ImageDatabase::readDibFromMemory(const uint8_t* data, size_t size) {
 
 
 // https://github.com/corkami/pics/blob/master/binary/ico_bmp.png
-std::tuple<cv::Mat, string> ImageDatabase::loadICO(wstring_view path, const vector<uint8_t>& buf) {
+std::tuple<cv::Mat, string> ImageDatabase::loadICO(wstring_view path, span<const uint8_t> buf) {
     if (buf.size() < 6) {
         jarkUtils::log("Invalid ICO file: {}", jarkUtils::wstringToUtf8(path));
         return { cv::Mat(),"" };
@@ -862,7 +1220,7 @@ std::tuple<cv::Mat, string> ImageDatabase::loadICO(wstring_view path, const vect
 
 
 // https://github.com/MolecularMatters/psd_sdk
-cv::Mat ImageDatabase::loadPSD(wstring_view path, const vector<uint8_t>& buf) {
+cv::Mat ImageDatabase::loadPSD(wstring_view path, span<const uint8_t> buf) {
     const int32_t CHANNEL_NOT_FOUND = UINT_MAX;
 
     cv::Mat img;
@@ -1090,7 +1448,7 @@ cv::Mat ImageDatabase::loadPSD(wstring_view path, const vector<uint8_t>& buf) {
 }
 
 
-cv::Mat ImageDatabase::loadTGA_HDR(wstring_view path, const vector<uint8_t>& buf) {
+cv::Mat ImageDatabase::loadTGA_HDR(wstring_view path, span<const uint8_t> buf) {
     int width, height, channels;
 
     // 使用stb_image从内存缓冲区加载图像
@@ -1120,7 +1478,7 @@ cv::Mat ImageDatabase::loadTGA_HDR(wstring_view path, const vector<uint8_t>& buf
 }
 
 
-cv::Mat ImageDatabase::loadSVG(wstring_view path, const vector<uint8_t>& buf) {
+cv::Mat ImageDatabase::loadSVG(wstring_view path, span<const uint8_t> buf) {
     const int maxEdge = 4000;
     static bool isInitFont = false;
 
@@ -1178,7 +1536,7 @@ cv::Mat ImageDatabase::loadSVG(wstring_view path, const vector<uint8_t>& buf) {
 }
 
 
-cv::Mat ImageDatabase::loadJXR(wstring_view path, const vector<uint8_t>& buf) {
+cv::Mat ImageDatabase::loadJXR(wstring_view path, span<const uint8_t> buf) {
     HRESULT hr = CoInitialize(NULL);
     if (FAILED(hr)) {
         std::cerr << "Failed to initialize COM library." << std::endl;
@@ -1302,12 +1660,47 @@ cv::Mat ImageDatabase::loadJXR(wstring_view path, const vector<uint8_t>& buf) {
     return mat;
 }
 
+// stb_image 的 GIF 解码器可逐帧输出合成后的完整画布，OpenCV 只能一次解码全部帧
+class GifAnimationSource : public AnimationSource {
+public:
+    explicit GifAnimationSource(std::shared_ptr<const vector<uint8_t>> data) : data(std::move(data)) {
+        stbi__start_mem(&context, this->data->data(), (int)this->data->size());
+    }
+
+    ~GifAnimationSource() override {
+        STBI_FREE(gif.out);
+        STBI_FREE(gif.history);
+        STBI_FREE(gif.background);
+    }
+
+    bool next(cv::Mat& frame, int& durationMs) override {
+        int comp = 0;
+        auto pixels = stbi__gif_load_next(&context, &gif, &comp, 4, prevCanvas[1].empty() ? nullptr : prevCanvas[1].ptr());
+        if (pixels == nullptr || pixels == (stbi_uc*)&context) // 出错，或已到末尾
+            return false;
+
+        // 处置方式为“恢复到前一状态”时，stb_image 需要两帧之前的画布
+        prevCanvas[1] = std::move(prevCanvas[0]);
+        prevCanvas[0] = cv::Mat(gif.h, gif.w, CV_8UC4, pixels).clone();
+        cv::cvtColor(prevCanvas[0], frame, cv::COLOR_RGBA2BGRA);
+        durationMs = gif.delay > 0 ? gif.delay : 16;
+        return true;
+    }
+
+private:
+    std::shared_ptr<const vector<uint8_t>> data;
+    stbi__context context{};
+    stbi__gif gif{};
+    cv::Mat prevCanvas[2]; // 前一帧和两帧之前的 RGBA 画布
+};
+
 // 已支持 gif apng png webp 动图
-ImageAsset ImageDatabase::loadAnimation(wstring_view path, const vector<uint8_t>& buf) {
+ImageAsset ImageDatabase::loadAnimation(wstring_view path, span<const uint8_t> buf) {
     cv::Animation animation;
     ImageAsset imageAsset;
 
-    bool success = cv::imdecodeanimation(buf, animation);
+    bool success = buf.size() <= INT_MAX &&
+        cv::imdecodeanimation(cv::Mat(1, (int)buf.size(), CV_8UC1, (uint8_t*)buf.data()), animation);
 
     if (!success || animation.frames.empty()) {
         imageAsset.primaryFrame = getErrorTipsMat();
@@ -1329,10 +1722,71 @@ ImageAsset ImageDatabase::loadAnimation(wstring_view path, const vector<uint8_t>
 }
 
 
-cv::Mat ImageDatabase::loadMat(wstring_view path, const vector<uint8_t>& buf) {
+// 全部帧解码后预计超过 ANIMATION_STREAM_MIN_BYTES 的动画只解码第 0 帧，其余帧由 AnimationStream 在后台按播放位置解码
+// 只支持能逐帧解码且可预先得到帧数的格式：GIF(stb_image)、JXL、WP2  APNG/WebP 动图 OpenCV 只能一次解码全部帧，BPG 文件头中没有帧数
+ImageAsset ImageDatabase::loadAnimationStream(span<const uint8_t> buf, const DecoderEntry& entry) {
+    using SourceMaker = std::unique_ptr<AnimationSource>(*)(std::shared_ptr<const vector<uint8_t>>);
+    SourceMaker sourceMaker = nullptr;
+    switch (entry.decoder) {
+    case Decoder::OpenCVAnimation:
+        if (buf.size() >= 4 && memcmp(buf.data(), "GIF8", 4) == 0)
+            sourceMaker = [](std::shared_ptr<const vector<uint8_t>> data) -> std::unique_ptr<AnimationSource> { return std::make_unique<GifAnimationSource>(std::move(data)); };
+        break;
+    case Decoder::Jxl:
+        sourceMaker = [](std::shared_ptr<const vector<uint8_t>> data) -> std::unique_ptr<AnimationSource> { return std::make_unique<JxlAnimationSource>(std::move(data)); };
+        break;
+    case Decoder::Wp2:
+        sourceMaker = [](std::shared_ptr<const vector<uint8_t>> data) -> std::unique_ptr<AnimationSource> { return std::make_unique<Wp2AnimationSource>(std::move(data)); };
+        break;
+    default:
+        break;
+    }
+    if (!sourceMaker)
+        return { ImageFormat::None };
+
+    const auto probeInfo = probe(buf, entry);
+    if (probeInfo.frameCount < 2 || probeInfo.pixels() * 4 < ANIMATION_STREAM_MIN_BYTES)
+        return { ImageFormat::None };
+
+    // 复制一份压缩数据供后台解码，不保持文件映射，避免长时间占用文件
+    auto data = std::make_shared<const vector<uint8_t>>(buf.begin(), buf.end());
+    AnimationStream::SourceFactory makeSource = [data, sourceMaker] { return sourceMaker(data); };
+
+    auto source = makeSource();
+    cv::Mat firstFrame;
+    int firstDuration = 0;
+    if (!source->next(firstFrame, firstDuration) || firstFrame.empty())
+        return { ImageFormat::None };
+
+    Metrics::addCounter("animation.stream");
+    ImageAsset imageAsset{ ImageFormat::Animated };
+    imageAsset.animationStream = std::make_shared<AnimationStream>(std::move(makeSource), std::move(source),
+        probeInfo.frameCount, std::move(firstFrame), firstDuration);
+    return imageAsset;
+}
+
+
+cv::Mat ImageDatabase::loadMat(wstring_view path, span<const uint8_t> buf, double scale) {
+    if (buf.size() > INT_MAX) {
+        jarkUtils::log("cvMat file too large: {} {} bytes", jarkUtils::wstringToUtf8(path), buf.size());
+        return {};
+    }
+
+    // JPEG 可由 libjpeg-turbo 在 IDCT 阶段按 1/2 1/4 1/8 缩小解码，REDUCED 模式固定输出 BGR，EXIF 方向仍由调用方处理
+    int flags = cv::IMREAD_UNCHANGED;
+    if (scale <= 0.5 && buf.size() >= 3 && memcmp(buf.data(), "\xFF\xD8\xFF", 3) == 0) {
+        if (scale <= 0.125)
+            flags = cv::IMREAD_REDUCED_COLOR_8;
+        else if (scale <= 0.25)
+            flags = cv::IMREAD_REDUCED_COLOR_4;
+        else
+            flags = cv::IMREAD_REDUCED_COLOR_2;
+        flags |= cv::IMREAD_IGNORE_ORIENTATION;
+    }
+
     cv::Mat img;
     try {
-        img = cv::imdecode(buf, cv::IMREAD_UNCHANGED);
+        img = cv::imdecode(cv::Mat(1, (int)buf.size(), CV_8UC1, (uint8_t*)buf.data()), flags);
     }
     catch (cv::Exception e) {
         jarkUtils::log("cvMat cannot decode: {} [{}]", jarkUtils::wstringToUtf8(path), e.what());
@@ -1373,7 +1827,7 @@ cv::Mat ImageDatabase::loadMat(wstring_view path, const vector<uint8_t>& buf) {
 
 
 // 辅助函数，用于从 PFM 头信息中提取尺寸和比例因子
-static bool parsePFMHeader(const vector<uint8_t>& buf, int& width, int& height, float& scaleFactor, bool& isColor, size_t& dataOffset) {
+static bool parsePFMHeader(span<const uint8_t> buf, int& width, int& height, float& scaleFactor, bool& isColor, size_t& dataOffset) {
     string header(reinterpret_cast<const char*>(buf.data()), 2);
 
     // 判断是否是RGB（PF）或灰度（Pf）
@@ -1427,7 +1881,7 @@ static bool parsePFMHeader(const vector<uint8_t>& buf, int& width, int& height,
 }
 
 
-cv::Mat ImageDatabase::loadPFM(wstring_view path, const vector<uint8_t>& buf) {
+cv::Mat ImageDatabase::loadPFM(wstring_view path, span<const uint8_t> buf) {
     int width, height;
     float scaleFactor;
     bool isColor;
@@ -1461,7 +1915,7 @@ cv::Mat ImageDatabase::loadPFM(wstring_view path, const vector<uint8_t>& buf) {
 }
 
 
-cv::Mat ImageDatabase::loadQOI(wstring_view path, const vector<uint8_t>& buf) {
+cv::Mat ImageDatabase::loadQOI(wstring_view path, span<const uint8_t> buf) {
     cv::Mat mat;
     qoi_desc desc;
     auto pixels = qoi_decode(buf.data(), (int)buf.size(), &desc, 0);
@@ -1485,12 +1939,12 @@ cv::Mat ImageDatabase::loadQOI(wstring_view path, const vector<uint8_t>& buf) {
 }
 
 
-static std::tuple<std::vector<uint8_t>, std::vector<uint8_t>, std::string> unzipLivp(const std::vector<uint8_t>& livpFileBuff) {
+static std::tuple<std::vector<uint8_t>, std::vector<uint8_t>, std::string> unzipLivp(span<const uint8_t> livpFileBuff) {
     zlib_filefunc_def memory_filefunc;
     memset(&memory_filefunc, 0, sizeof(zlib_filefunc_def));
 
     struct membuf {
-        const std::vector<uint8_t>& buffer;
+        span<const uint8_t> buffer;
         size_t position;
     } mem = { livpFileBuff, 0 };
 
@@ -1624,39 +2078,107 @@ static std::tuple<std::vector<uint8_t>, std::vector<uint8_t>, std::string> unzip
 }
 
 
-void ImageDatabase::handleExifOrientation(int orientation, cv::Mat& img) {
-    if (img.empty())
-        return;
+cv::Mat ImageDatabase::applyOrientation(const cv::Mat& img, int orientation) {
+    if (img.empty() || orientation <= 1 || orientation > 8)
+        return img;
 
+    // 输出到新的 Mat，不改动缓存中共享的像素
+    cv::Mat ret;
     switch (orientation) {
     case 2: // 水平翻转
-        cv::flip(img, img, 1);
+        cv::flip(img, ret, 1);
         break;
     case 3: // 旋转180度
-        cv::rotate(img, img, cv::ROTATE_180);
+        cv::rotate(img, ret, cv::ROTATE_180);
         break;
     case 4: // 垂直翻转
-        cv::flip(img, img, 0);
+        cv::flip(img, ret, 0);
         break;
-    case 5: // 顺时针旋转90度后垂直翻转
-        cv::rotate(img, img, cv::ROTATE_90_CLOCKWISE);
-        cv::flip(img, img, 0);
+    case 5: // 沿主对角线翻转（转置）
+        cv::transpose(img, ret);
         break;
     case 6: // 顺时针旋转90度
-        cv::rotate(img, img, cv::ROTATE_90_CLOCKWISE);
+        cv::rotate(img, ret, cv::ROTATE_90_CLOCKWISE);
         break;
-    case 7: // 顺时针旋转90度后水平翻转
-        cv::rotate(img, img, cv::ROTATE_90_CLOCKWISE);
-        cv::flip(img, img, 1);
+    case 7: // 沿副对角线翻转
+        cv::transpose(img, ret);
+        cv::flip(ret, ret, -1);
         break;
     case 8: // 逆时针旋转90度
-        cv::rotate(img, img, cv::ROTATE_90_COUNTERCLOCKWISE);
+        cv::rotate(img, ret, cv::ROTATE_90_COUNTERCLOCKWISE);
         break;
     }
+    return ret;
+}
+
+// 逐帧解码实况照片的视频  帧时长取自预先解析的时间戳，超出预计帧数的帧取解码器给出的样本时长，仍未知则沿用上一帧
+class VideoAnimationSource : public AnimationSource {
+public:
+    VideoAnimationSource(std::shared_ptr<const vector<uint8_t>> data, std::shared_ptr<const vector<int>> durations)
+        : data(std::move(data)), durations(std::move(durations)) {
+        isOpened = decoder.Open(this->data->data(), this->data->size());
+        lastDurationMs = this->durations->empty() ? 1 : this->durations->back();
+    }
+
+    bool next(cv::Mat& frame, int& durationMs) override {
+        LONGLONG sampleDuration = 0;
+        if (!isOpened || !decoder.ReadFrame(frame, nullptr, &sampleDuration))
+            return false;
+        if (frameIdx < durations->size())
+            lastDurationMs = (*durations)[frameIdx];
+        else if (sampleDuration > 0)
+            lastDurationMs = std::max((int)((sampleDuration + 5000) / 10000), 1);
+        durationMs = lastDurationMs;
+        frameIdx++;
+        return true;
+    }
+
+private:
+    std::shared_ptr<const vector<uint8_t>> data;
+    std::shared_ptr<const vector<int>> durations;
+    VideoDecoder decoder;
+    bool isOpened = false;
+    size_t frameIdx = 0;
+    int lastDurationMs;
+};
+
+
+// 容器无法由 Mp4Demuxer 解析时（如非 ISO BMFF 封装），经 Media Foundation 读取压缩样本的时间戳得到同样的信息，不解码
+static bool scanVideoTrack(const vector<uint8_t>& videoData, Mp4VideoTrack& track) {
+    VideoSampleInfo info;
+    if (!VideoDecoder::ScanSamples(videoData.data(), videoData.size(), info) || info.timeStamps.size() > Mp4Demuxer::MAX_SAMPLES)
+        return false;
+
+    track = {};
+    track.width = (int)info.width;
+    track.height = (int)info.height;
+    track.rotation = (int)info.rotation;
+    track.timescale = 10'000'000; // 100ns
+    track.decodeTimes.assign(info.timeStamps.begin(), info.timeStamps.end()); // 已按显示顺序，无需 compositionOffsets
+    track.lastDelta = (uint32_t)std::clamp<LONGLONG>(info.lastDuration, 0, UINT32_MAX);
+    return true;
+}
+
+
+// 实况照片的视频只保留压缩数据，开始播放时才逐帧解码
+static void attachLiveVideo(ImageAsset& imageAsset, std::shared_ptr<const vector<uint8_t>> videoData) {
+    Mp4VideoTrack track;
+    if (!Mp4Demuxer::parseVideoTrack(*videoData, track) && !scanVideoTrack(*videoData, track))
+        return;
+
+    auto durations = std::make_shared<const vector<int>>(track.frameDurationsMs());
+    AnimationStream::SourceFactory makeSource = [videoData, durations]() -> std::unique_ptr<AnimationSource> {
+        return std::make_unique<VideoAnimationSource>(videoData, durations);
+        };
+
+    Metrics::addCounter("livePhoto.lazyVideo");
+    imageAsset.format = ImageFormat::Animated;
+    imageAsset.animationStream = std::make_shared<AnimationStream>(std::move(makeSource), track.sampleCount(), track.displaySize(), CV_8UC3);
 }
 
+
 // 苹果实况照片
-ImageAsset ImageDatabase::loadLivp(wstring_view path, const vector<uint8_t>& fileBuf) {
+ImageAsset ImageDatabase::loadLivp(wstring_view path, span<const uint8_t> fileBuf) {
     auto [imageFileData, videoFileData, imageExt] = unzipLivp(fileBuf);
     if (imageFileData.empty()) {
         auto exifInfo = ExifParse::getSimpleInfo(path, 0, 0, fileBuf.data(), fileBuf.size());
@@ -1671,297 +2193,1542 @@ ImageAsset ImageDatabase::loadLivp(wstring_view path, const vector<uint8_t>& fil
         img = loadMat(path, imageFileData);
     }
 
-    auto exifTmp = ExifParse::getExif(path, imageFileData.data(), imageFileData.size());
-    if (imageExt == "jpg" || imageExt == "jpeg") { //heic 已经在解码过程应用了裁剪/旋转/镜像等操作
-        const size_t idx = exifTmp.find("\n方向: ");
-        if (idx != string::npos) {
-            handleExifOrientation(exifTmp[idx + 9] - '0', img);
-        }
-    }
-    auto exifInfo = ExifParse::getSimpleInfo(path, img.cols, img.rows, fileBuf.data(), fileBuf.size()) + exifTmp;
+    auto metadata = ExifParse::parse(path, imageFileData.data(), imageFileData.size());
+    int orientation = 1;
+    if (metadata && (imageExt == "jpg" || imageExt == "jpeg")) //heic 已经在解码过程应用了裁剪/旋转/镜像等操作
+        orientation = metadata->orientation;
+    const auto displaySize = orientedSize(img.size(), orientation);
+    auto exifInfo = ExifParse::getSimpleInfo(path, displaySize.width, displaySize.height, fileBuf.data(), fileBuf.size());
 
+    ImageAsset imageAsset{ ImageFormat::Still, img, {}, {}, exifInfo, metadata };
+    imageAsset.orientation = orientation;
     if (videoFileData.empty()) {
-        return { ImageFormat::Still, img, {}, {}, exifInfo };
+        return imageAsset;
     }
 
-    auto frames = VideoDecoder::DecodeVideoFrames(videoFileData.data(), videoFileData.size());
+    attachLiveVideo(imageAsset, std::make_shared<const vector<uint8_t>>(std::move(videoFileData)));
+    return imageAsset;
+}
 
-    if (frames.empty()) {
-        return { ImageFormat::Still, img, {}, {}, exifInfo };
+// Android 实况照片 jpg/jpeg/heic/heif
+ImageAsset ImageDatabase::loadMotionPhoto(wstring_view path, span<const uint8_t> fileBuf, bool isJPG = false, DecodeHint hint = {}) {
+    // 先解析 EXIF 判断是否为实况照片，实况照片的静态图与视频一同显示，不缩小解码
+    auto metadata = ExifParse::parse(path, fileBuf.data(), fileBuf.size());
+    const size_t videoSize = metadata ? metadata->videoSize : 0;
+    const bool hasVideo = videoSize > 0 && videoSize < fileBuf.size();
+    if (hasVideo)
+        hint = {};
+
+    auto img = isJPG ? loadMat(path, fileBuf, hint.scale) : loadHeic(path, fileBuf);
+    if (img.empty()) {
+        auto exifInfo = ExifParse::getSimpleInfo(path, 0, 0, fileBuf.data(), fileBuf.size());
+        return { ImageFormat::Still, getErrorTipsMat(), {}, {}, exifInfo };
     }
 
-    return { ImageFormat::Animated, img, frames, std::vector<int>(frames.size(), 33),  exifInfo };
-}
-
-// 从xmp获取视频数据大小  https://developer.android.com/media/platform/motion-photo-format?hl=zh-cn
-// 旧标准（MicroVideo）    Xmp.GCamera.MicroVideoOffset: xxxx
-// 新标准（MotionPhoto）   Xmp.Container.Directory[xxx]/Item:Length: xxxx
-static size_t getVideoSize(string_view exifStr) {
-    constexpr std::string_view targetKey1 = "Xmp.GCamera.MicroVideoOffset: ";
-    constexpr size_t targetKey1Len = targetKey1.length();
+    const int orientation = (isJPG && metadata) ? metadata->orientation : 1;
 
-    size_t valueStart = 0;
-    size_t pos = exifStr.find(targetKey1);
-    if (pos != std::string::npos) {
-        valueStart = pos + targetKey1Len;
-    }
-    else {
-        pos = exifStr.find("Item:Semantic: MotionPhoto");
-        if (pos == std::string::npos) {
-            return 0;
-        }
-        constexpr std::string_view targetKey2 = "Item:Length: ";
-        constexpr size_t targetKey2Len = targetKey2.length();
-        pos = exifStr.find(targetKey2, pos);
-        if (pos == std::string::npos) {
-            return 0;
-        }
-        valueStart = pos + targetKey2Len;
+    if (hint.isScaled()) {
+        auto imageAsset = makeScaledAsset(img, hint, ExifParse::getSimpleInfo(path, hint.fullSize.width, hint.fullSize.height,
+            fileBuf.data(), fileBuf.size()), orientation);
+        imageAsset.metadata = metadata;
+        return imageAsset;
     }
 
-    size_t valueEnd = valueStart;
-    while ('0' <= exifStr[valueEnd] && exifStr[valueEnd] <= '9') valueEnd++;
-
-    if (valueEnd <= valueStart || valueEnd >= exifStr.length()) {
-        return 0;
+    const auto displaySize = orientedSize(img.size(), orientation);
+    auto exifInfo = ExifParse::getSimpleInfo(path, displaySize.width, displaySize.height, fileBuf.data(), fileBuf.size());
+    ImageAsset imageAsset{ ImageFormat::Still, img, {}, {}, exifInfo, metadata };
+    imageAsset.orientation = orientation;
+    if (!hasVideo) {
+        return imageAsset;
     }
 
-    std::string_view valueStr(exifStr.data() + valueStart, valueEnd - valueStart);
+    // 复制视频部分，不保持文件映射
+    const auto videoBuf = fileBuf.last(videoSize);
+    attachLiveVideo(imageAsset, std::make_shared<const vector<uint8_t>>(videoBuf.begin(), videoBuf.end()));
+    return imageAsset;
+}
 
-    int value = 0;
-    try {
-        value = std::stoi(std::string(valueStr));
-    }
-    catch (const std::exception&) {
-        return 0;
+size_t ImageDatabase::getMemoryBudget() {
+    constexpr size_t GB = 1024ULL * 1024 * 1024;
+
+    switch (GlobalVar::settingParameter.cacheMemoryMode) {
+    case 1: return 1 * GB;
+    case 2: return 2 * GB;
+    case 3: return 4 * GB;
     }
-    return value;
+
+    // 自动: 物理内存的 1/4，限定在 512MB ~ 4GB
+    MEMORYSTATUSEX memStatus{ .dwLength = sizeof(MEMORYSTATUSEX) };
+    if (!GlobalMemoryStatusEx(&memStatus))
+        return 1 * GB;
+    return std::clamp<size_t>(memStatus.ullTotalPhys / 4, GB / 2, 4 * GB);
 }
 
-// Android 实况照片 jpg/jpeg/heic/heif
-ImageAsset ImageDatabase::loadMotionPhoto(wstring_view path, const vector<uint8_t>& fileBuf, bool isJPG = false) {
-    auto img = isJPG ? loadMat(path, fileBuf) : loadHeic(path, fileBuf);
-    if (img.empty()) {
-        auto exifInfo = ExifParse::getSimpleInfo(path, 0, 0, fileBuf.data(), fileBuf.size());
-        return { ImageFormat::Still, getErrorTipsMat(), {}, {}, exifInfo };
+
+size_t ImageDatabase::getPreloadThreads() {
+    switch (GlobalVar::settingParameter.preloadThreadsMode) {
+    case 1: return 1;
+    case 2: return 2;
+    case 3: return 4;
+    case 4: return 8;
     }
 
-    auto exifInfo = ExifParse::getSimpleInfo(path, img.cols, img.rows, fileBuf.data(), fileBuf.size()) +
-        ExifParse::getExif(path, fileBuf.data(), fileBuf.size());
+    // 自动: 逻辑核心数的一半，限定在 2 ~ 4  部分解码器内部自身也是多线程，且并发解码会成倍增加峰值内存
+    return std::clamp<size_t>(std::thread::hardware_concurrency() / 2, 2, 4);
+}
 
-    if (isJPG) {
-        const size_t idx = exifInfo.find("\n方向: ");
-        if (idx != string::npos) {
-            handleExifOrientation(exifInfo[idx + 9] - '0', img);
-        }
-    }
 
-    auto videoSize = getVideoSize(exifInfo);
-    if (videoSize == 0 || videoSize >= fileBuf.size()) {
-        return { ImageFormat::Still, img, {}, {}, exifInfo };
-    }
+size_t ImageDatabase::valueBytes(const ImageAsset& imageAsset) const {
+    size_t bytes = imageAsset.primaryFrame.total() * imageAsset.primaryFrame.elemSize();
+    bytes += imageAsset.previewFrame.total() * imageAsset.previewFrame.elemSize();
+    for (const auto& frame : imageAsset.frames)
+        bytes += frame.total() * frame.elemSize();
+    if (imageAsset.animationStream)
+        bytes += imageAsset.animationStream->bytes();
+    if (imageAsset.frameStore)
+        bytes += imageAsset.frameStore->bytes();
+    return bytes + imageAsset.exifInfo.capacity();
+}
 
-    auto frames = VideoDecoder::DecodeVideoFrames(fileBuf.data() + fileBuf.size() - videoSize, videoSize);
-    if (frames.empty()) {
-        return { ImageFormat::Still, img, {}, {}, exifInfo };
-    }
 
-    return { ImageFormat::Animated, img, frames, std::vector<int>(frames.size(), 33),  exifInfo };
+std::shared_ptr<ImageAsset> ImageDatabase::shrinkValue(const ImageAsset& imageAsset) {
+    if (imageAsset.primaryFrame.empty() || imageAsset.previewFrame.empty())
+        return nullptr;
+
+    auto previewAsset = std::make_shared<ImageAsset>(imageAsset); // cv::Mat 为引用计数，不复制像素
+    previewAsset->primaryFrame.release();
+    return previewAsset;
 }
 
-ImageAsset ImageDatabase::loader(const wstring& path) {
-    FunctionTimeCount FunctionTimeCount(__func__);
-    jarkUtils::log("loading: {}", jarkUtils::wstringToUtf8(path));
 
-    if (path.length() < 4) {
-        jarkUtils::log("path.length() < 4: {}", jarkUtils::wstringToUtf8(path));
-        return { ImageFormat::Still, getErrorTipsMat(), {}, {}, "" };
-    }
+// 远大于屏幕的静态图额外生成适应屏幕尺寸的预览，适应窗口浏览时从预览绘制
+void ImageDatabase::createPreview(ImageAsset& imageAsset) {
+    const cv::Mat& img = imageAsset.primaryFrame;
+    if (imageAsset.format != ImageFormat::Still || !imageAsset.frames.empty() || img.empty())
+        return;
 
-    auto f = _wfopen(path.data(), L"rb");
-    if (f == nullptr) {
-        jarkUtils::log("path canot open: {}", jarkUtils::wstringToUtf8(path));
-        return { ImageFormat::Still, getErrorTipsMat(), {}, {}, "" };
-    }
+    const auto screenSize = getScreenSize();
+    const auto displaySize = orientedSize(img.size(), imageAsset.orientation);
+    const double scale = std::min((double)screenSize.width / displaySize.width, (double)screenSize.height / displaySize.height);
+    if (scale * PREVIEW_MIN_RATIO > 1.0)
+        return;
 
-    fseek(f, 0, SEEK_END);
-    auto fileSize = ftell(f);
+    const cv::Size previewSize(std::max((int)std::round(img.cols * scale), 1), std::max((int)std::round(img.rows * scale), 1));
+    cv::resize(img, imageAsset.previewFrame, previewSize, 0, 0, cv::INTER_AREA);
+    imageAsset.fullSize = img.size();
+}
 
-    if (fileSize < 16) {
-        fclose(f);
-        jarkUtils::log("path fileSize < 16: {}", jarkUtils::wstringToUtf8(path));
-        return { ImageFormat::Still, getErrorTipsMat(), {}, {}, "" };
-    }
 
-    fseek(f, 0, SEEK_SET);
-    vector<uint8_t> fileBuf(fileSize, 0);
-    fread(fileBuf.data(), 1, fileSize, f);
-    fclose(f);
+// 相邻帧大多只有局部变化的动画，压缩存储可节省一个数量级的内存  实况照片的视频帧整帧变化，不压缩
+void ImageDatabase::compactFrames(ImageAsset& imageAsset) {
+    if (imageAsset.format != ImageFormat::Animated || imageAsset.frames.size() < 2)
+        return;
 
-    auto dotPos = path.rfind(L'.');
-    auto ext = wstring((dotPos != std::wstring::npos && dotPos < path.size() - 1) ?
-        path.substr(dotPos + 1) : path);
-    for (auto& c : ext)	c = std::tolower(c);
+    uint64_t rawBytes = 0;
+    for (const auto& frame : imageAsset.frames)
+        rawBytes += frame.total() * frame.elemSize();
+    if (rawBytes < FRAME_STORE_MIN_BYTES)
+        return;
 
-    // 动态图
-    if (opencvAnimationExt.contains(ext)) {
-        auto imageAsset = loadAnimation(path, fileBuf);
+    auto frameStore = FrameStore::create(imageAsset.frames);
+    if (!frameStore)
+        return;
 
-        if (imageAsset.format == ImageFormat::None) {
-            imageAsset.format = ImageFormat::Still;
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, 0, 0, fileBuf.data(), fileBuf.size());
-            return imageAsset;
-        }
-        else if (imageAsset.format == ImageFormat::Still) {
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, imageAsset.primaryFrame.cols, imageAsset.primaryFrame.rows,
-                fileBuf.data(), fileBuf.size())
-                + ExifParse::getExif(path, fileBuf.data(), fileBuf.size());
-            return imageAsset;
-        }
+    jarkUtils::log("frame store: {} frames {}MB -> {}MB", imageAsset.frames.size(), rawBytes >> 20, frameStore->bytes() >> 20);
+    Metrics::addCounter("animation.compact");
+    imageAsset.frameStore = std::move(frameStore);
+    imageAsset.frames.clear();
+    imageAsset.frames.shrink_to_fit();
+}
 
-        // 以下情况是动图
-        if (ext == L"gif") {
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, imageAsset.frames[0].cols, imageAsset.frames[0].rows, fileBuf.data(), fileBuf.size());
-        }
-        else {
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, imageAsset.frames[0].cols, imageAsset.frames[0].rows, fileBuf.data(), fileBuf.size())
-                + ExifParse::getExif(path, fileBuf.data(), fileBuf.size());
-        }
-        return imageAsset;
-    }
-    else if (ext == L"bpg") { //静态或动画
-        auto imageAsset = loadBPG(path, fileBuf);
 
-        if (imageAsset.format == ImageFormat::None) {
-            imageAsset.format = ImageFormat::Still;
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, 0, 0, fileBuf.data(), fileBuf.size());
-        }
-        else if (imageAsset.format == ImageFormat::Still) {
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, imageAsset.primaryFrame.cols, imageAsset.primaryFrame.rows,
-                fileBuf.data(), fileBuf.size())
-                + ExifParse::getExif(path, fileBuf.data(), fileBuf.size());
-        }
-        else {
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, imageAsset.frames[0].cols, imageAsset.frames[0].rows, fileBuf.data(), fileBuf.size())
-                + ExifParse::getExif(path, fileBuf.data(), fileBuf.size());
-        }
-        return imageAsset;
-    }
-    else if (ext == L"jxl") { //静态或动画
-        auto imageAsset = loadJXL(path, fileBuf);
+cv::Size ImageDatabase::getScreenSize() {
+    return { std::max(GetSystemMetrics(SM_CXSCREEN), 800), std::max(GetSystemMetrics(SM_CYSCREEN), 600) };
+}
 
-        if (imageAsset.format == ImageFormat::None) {
-            imageAsset.format = ImageFormat::Still;
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, 0, 0, fileBuf.data(), fileBuf.size());
-        }
-        else if (imageAsset.format == ImageFormat::Still) {
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, imageAsset.primaryFrame.cols, imageAsset.primaryFrame.rows,
-                fileBuf.data(), fileBuf.size())
-                + ExifParse::getExif(path, fileBuf.data(), fileBuf.size());
+
+// 缩小解码得到的图像按原图尺寸缩放至与 createPreview 相同的预览尺寸，作为只有预览的静态图
+ImageAsset ImageDatabase::makeScaledAsset(cv::Mat img, const DecodeHint& hint, string exifInfo, int orientation) {
+    ImageAsset imageAsset{ ImageFormat::Still, {}, {}, {}, std::move(exifInfo) };
+    const cv::Size fullSize = orientedSize(hint.fullSize, orientation); // 显示尺寸换回像素的存储尺寸
+    const cv::Size previewSize(std::max((int)std::round(fullSize.width * hint.scale), 1),
+        std::max((int)std::round(fullSize.height * hint.scale), 1));
+    if (img.cols > previewSize.width && img.rows > previewSize.height)
+        cv::resize(img, imageAsset.previewFrame, previewSize, 0, 0, cv::INTER_AREA);
+    else
+        imageAsset.previewFrame = img;
+    imageAsset.fullSize = fullSize;
+    imageAsset.orientation = orientation;
+    return imageAsset;
+}
+
+
+// 只在预读线程中且不需要原图时才发布临时值，不涉及文件内容，可先于 probe 判断
+bool ImageDatabase::isProvisionalAllowed() {
+    return loadCancelFlag() && !isReloadRequest();
+}
+
+
+bool ImageDatabase::isWorthProvisional(const wstring& path, double pixels) {
+    if (!isProvisionalAllowed())
+        return false;
+    const auto stat = getDecodeStat(path);
+    return stat.avgMs * pixels / stat.avgPixels >= PROVISIONAL_MIN_MS;
+}
+
+
+// 缩略图按原图宽高比居中裁去黑边（EXIF 缩略图多为 4:3 加黑边）并复制，大于屏幕时缩小，作为只有预览的临时值
+// displaySize 为原图显示尺寸，缩略图与原图像素同为存储方向，显示时按 orientation 变换
+ImageAsset ImageDatabase::makeProvisionalAsset(const cv::Mat& thumb, cv::Size displaySize, string exifInfo, int orientation) {
+    const cv::Size fullSize = orientedSize(displaySize, orientation);
+    if (thumb.empty() || fullSize.width <= 0 || fullSize.height <= 0)
+        return { ImageFormat::None };
+
+    // 横竖不一致说明缩略图与原图方向不同，不可用
+    if ((thumb.cols >= thumb.rows) != (fullSize.width >= fullSize.height))
+        return { ImageFormat::None };
+
+    const double fullAspect = (double)fullSize.width / fullSize.height;
+    const double thumbAspect = (double)thumb.cols / thumb.rows;
+    cv::Rect roi(0, 0, thumb.cols, thumb.rows);
+    if (thumbAspect > fullAspect * 1.02) {
+        roi.width = std::max((int)std::round(thumb.rows * fullAspect), 1);
+        roi.x = (thumb.cols - roi.width) / 2;
+    }
+    else if (thumbAspect < fullAspect / 1.02) {
+        roi.height = std::max((int)std::round(thumb.cols / fullAspect), 1);
+        roi.y = (thumb.rows - roi.height) / 2;
+    }
+
+    const auto screenSize = getScreenSize();
+    const double scale = std::min({ (double)screenSize.width / displaySize.width, (double)screenSize.height / displaySize.height, 1.0 });
+    const cv::Size previewSize(std::max((int)std::round(fullSize.width * scale), 1), std::max((int)std::round(fullSize.height * scale), 1));
+
+    ImageAsset imageAsset{ ImageFormat::Still, {}, {}, {}, std::move(exifInfo) };
+    if (roi.width > previewSize.width && roi.height > previewSize.height)
+        cv::resize(thumb(roi), imageAsset.previewFrame, previewSize, 0, 0, cv::INTER_AREA);
+    else
+        imageAsset.previewFrame = thumb(roi).clone();
+    imageAsset.fullSize = fullSize;
+    imageAsset.orientation = orientation;
+    imageAsset.isProvisional = true;
+    return imageAsset;
+}
+
+
+std::shared_ptr<ImageAsset> ImageDatabase::onWaitFailed(const wstring& path, LRUWaitStatus status, const std::string& errorMsg) {
+    const bool isTimeout = status == LRUWaitStatus::Timeout;
+    jarkUtils::log("{}: {} {}", isTimeout ? "load timeout" : "load failed", jarkUtils::wstringToUtf8(path), errorMsg);
+
+    return std::make_shared<ImageAsset>(ImageAsset{ ImageFormat::Still, getErrorTipsMat(), {}, {},
+        isTimeout ? string("加载超时") : std::format("解码失败: {}", errorMsg) });
+}
+
+
+bool ImageDatabase::isValueValid(const wstring& path, const ImageAsset& imageAsset) {
+    if (!imageAsset.fileIdentity.isValid()) // 主页/格式不支持提示等非文件内容
+        return true;
+
+    FileIdentity curIdentity;
+    if (!jarkUtils::getFileIdentity(path, curIdentity)) // 文件已被删除或暂时无法访问，继续显示已缓存的内容
+        return true;
+
+    if (curIdentity == imageAsset.fileIdentity)
+        return true;
+
+    jarkUtils::log("file changed, reload: {}", jarkUtils::wstringToUtf8(path));
+    return false;
+}
+
+
+using namespace std::string_view_literals;
+
+const vector<ImageDatabase::DecoderEntry> ImageDatabase::decoderTable{
+    { Decoder::OpenCV,
+        { L"jp2", L"bmp", L"dib", L"pbm", L"pgm", L"ppm", L"pxm", L"pnm", L"sr", L"ras", L"exr", L"tiff", L"tif", L"pic" },
+        {
+            { 0, "BM"sv },
+            { 0, "\0\0\0\x0CjP  \r\n\x87\n"sv }, { 0, "\xFF\x4F\xFF\x51"sv }, // JPEG 2000
+            { 0, "P1"sv }, { 0, "P2"sv }, { 0, "P3"sv }, { 0, "P4"sv }, { 0, "P5"sv }, { 0, "P6"sv }, { 0, "P7"sv },
+            { 0, "\x59\xA6\x6A\x95"sv }, // Sun raster
+            { 0, "\x76\x2F\x31\x01"sv }, // OpenEXR
+            { 0, "II*\0"sv }, { 0, "MM\0*"sv }, // TIFF
+        },
+        CapExif },
+    { Decoder::OpenCVAnimation,
+        { L"png", L"apng", L"gif", L"webp" },
+        { { 0, "\x89PNG"sv }, { 0, "GIF87a"sv }, { 0, "GIF89a"sv }, { 0, "RIFF"sv, 8, "WEBP"sv } },
+        CapExif },
+    { Decoder::MotionPhoto,
+        { L"jpg", L"jpeg", L"jpe", L"jfif" },
+        { { 0, "\xFF\xD8\xFF"sv } },
+        CapExif },
+    { Decoder::HeifMotionPhoto,
+        { L"heic", L"heif" },
+        {
+            { 4, "ftypheic"sv }, { 4, "ftypheix"sv }, { 4, "ftyphevc"sv }, { 4, "ftyphevx"sv },
+            { 4, "ftypheim"sv }, { 4, "ftypheis"sv }, { 4, "ftypmif1"sv }, { 4, "ftypmsf1"sv },
+        },
+        CapExif | CapOrientation | CapSlowDecode },
+    { Decoder::Livp,
+        { L"livp" },
+        { { 0, "PK\x03\x04"sv } },
+        CapExif | CapOrientation },
+    { Decoder::Avif,
+        { L"avif", L"avifs" },
+        { { 4, "ftypavif"sv }, { 4, "ftypavis"sv }, { 4, "ftypmif1"sv }, { 4, "ftypmsf1"sv } },
+        CapExif | CapSlowDecode },
+    { Decoder::Jxl,
+        { L"jxl" },
+        { { 0, "\xFF\x0A"sv }, { 0, "\0\0\0\x0CJXL \r\n\x87\n"sv } },
+        CapExif | CapSlowDecode },
+    { Decoder::Jxr,
+        { L"jxr" },
+        { { 0, "II\xBC\x01"sv } },
+        CapExif | CapSlowDecode },
+    { Decoder::Wp2,
+        { L"wp2" },
+        { { 0, "\xF4\xFF\x6F"sv } },
+        CapExif | CapSlowDecode },
+    { Decoder::Bpg,
+        { L"bpg" },
+        { { 0, "BPG\xFB"sv } },
+        CapExif | CapSlowDecode },
+    { Decoder::TgaHdr,
+        { L"hdr" },
+        { { 0, "#?RADIANCE"sv }, { 0, "#?RGBE"sv } },
+        0 },
+    { Decoder::TgaHdr,
+        { L"tga" }, // TGA 没有文件头特征，只能按扩展名
+        {},
+        0 },
+    { Decoder::Svg,
+        { L"svg" },
+        {},
+        0 },
+    { Decoder::Qoi,
+        { L"qoi" },
+        { { 0, "qoif"sv } },
+        0 },
+    { Decoder::Ico,
+        { L"ico", L"icon" },
+        { { 0, "\0\0\x01\0"sv } },
+        0 },
+    { Decoder::Psd,
+        { L"psd" },
+        { { 0, "8BPS"sv } },
+        CapExif | CapSlowDecode },
+    { Decoder::Pfm,
+        { L"pfm" },
+        { { 0, "PF\n"sv }, { 0, "Pf\n"sv } },
+        0 },
+    { Decoder::Raw,
+        {
+            L"crw", L"cr2", L"cr3", // Canon
+            L"arw", L"srf", L"sr2", // Sony
+            L"raw", L"dng", // Leica
+            L"nef", // Nikon
+            L"pef", // Pentax
+            L"orf", // Olympus
+            L"rw2", // Panasonic
+            L"raf", // Fujifilm
+            L"kdc", // Kodak
+            L"x3f", // Sigma
+            L"mrw", // Minolta
+            L"3fr", // Hasselblad
+            L"ari", // ARRIRAW
+            L"bay", // Casio
+            L"cap", // Phase One
+            L"dcr", // Kodak
+            L"dcs", // Kodak
+            L"drf", // DNG+
+            L"eip", // Enhanced Image Package, Phase One
+            L"erf", // Epson
+            L"fff", // Imacon/Hasselblad
+            L"gpr", // GoPro
+            L"iiq", // Phase One
+            L"k25", // Kodak
+            L"mdc", // Minolta
+            L"mef", // Mamiya
+            L"mos", // Leaf
+            L"nrw", // Nikon
+            L"ptx", // Pentax
+            L"r3d", // Red Digital Cinema
+            L"rwl", // Leica
+            L"rwz", // Leica
+            L"srw", // Samsung
+        },
+        {
+            { 0, "II*\0"sv }, { 0, "MM\0*"sv }, // 基于 TIFF 的 DNG/CR2/NEF/ARW ...
+            { 0, "IIRO"sv }, { 0, "IIRS"sv }, { 0, "IIU\0"sv }, // Olympus / Panasonic
+            { 0, "II\x1A\0\0\0HEAPCCDR"sv }, // Canon CRW
+            { 4, "ftypcrx "sv }, // Canon CR3
+            { 0, "FUJIFILMCCD-RAW"sv },
+            { 0, "FOVb"sv }, // Sigma X3F
+            { 0, "\0MRM"sv }, // Minolta MRW
+        },
+        CapExif | CapOrientation | CapSlowDecode },
+};
+
+
+static unordered_set<wstring_view> collectExt(bool isRaw) {
+    unordered_set<wstring_view> exts;
+    for (const auto& entry : ImageDatabase::decoderTable) {
+        if ((entry.decoder == ImageDatabase::Decoder::Raw) == isRaw)
+            exts.insert(entry.exts.begin(), entry.exts.end());
+    }
+    return exts;
+}
+
+const unordered_set<wstring_view> ImageDatabase::supportExt = collectExt(false);
+const unordered_set<wstring_view> ImageDatabase::supportRaw = collectExt(true);
+
+
+static bool matchSignature(const ImageDatabase::DecoderEntry& entry, span<const uint8_t> buf) {
+    auto matchAt = [&](uint32_t offset, string_view magic) {
+        return offset + magic.size() <= buf.size() && memcmp(buf.data() + offset, magic.data(), magic.size()) == 0;
+        };
+    return std::ranges::any_of(entry.signatures, [&](const ImageDatabase::MagicSignature& signature) {
+        return matchAt(signature.offset, signature.magic) &&
+            (signature.magic2.empty() || matchAt(signature.offset2, signature.magic2));
+        });
+}
+
+
+const ImageDatabase::DecoderEntry* ImageDatabase::findDecoderByExt(wstring_view ext) {
+    for (const auto& entry : decoderTable) {
+        if (std::ranges::find(entry.exts, ext) != entry.exts.end())
+            return &entry;
+    }
+    return nullptr;
+}
+
+
+static bool isTiffBasedRaw(span<const uint8_t> buf);
+
+const ImageDatabase::DecoderEntry& ImageDatabase::sniffDecoder(span<const uint8_t> buf, wstring_view ext) {
+    const DecoderEntry* extEntry = findDecoderByExt(ext);
+    if (extEntry && (extEntry->signatures.empty() || matchSignature(*extEntry, buf)))
+        return *extEntry;
+
+    // 基于 TIFF 的 RAW 与普通 TIFF 的文件头特征相同，而表中 OpenCV 在 RAW 之前，需先解析 IFD0 区分
+    if (isTiffBasedRaw(buf)) {
+        jarkUtils::log(L"file content does not match extension .{}, decoder: TIFF based RAW", ext);
+        return *findDecoderByExt(L"dng");
+    }
+
+    for (const auto& entry : decoderTable) {
+        if (matchSignature(entry, buf)) {
+            jarkUtils::log(L"file content does not match extension .{}, decoder: {}", ext, (int)entry.decoder);
+            return entry;
         }
-        else {
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, imageAsset.frames[0].cols, imageAsset.frames[0].rows, fileBuf.data(), fileBuf.size())
-                + ExifParse::getExif(path, fileBuf.data(), fileBuf.size());
+    }
+
+    return extEntry ? *extEntry : decoderTable.front();
+}
+
+
+static wstring getLowerExt(const wstring& path) {
+    auto dotPos = path.rfind(L'.');
+    auto ext = wstring((dotPos != std::wstring::npos && dotPos < path.size() - 1) ?
+        path.substr(dotPos + 1) : path);
+    for (auto& c : ext)	c = std::tolower(c);
+    return ext;
+}
+
+
+void ImageDatabase::onLoadFinished(const wstring& path, const ImageAsset& imageAsset, double elapsedMs) {
+    const double bytes = (double)valueBytes(imageAsset);
+    const double shrunkBytes = imageAsset.previewFrame.empty() ? bytes :
+        bytes - (double)imageAsset.primaryFrame.total() * imageAsset.primaryFrame.elemSize();
+
+    double pixels = 0;
+    if (imageAsset.format == ImageFormat::Animated) { // 延迟解码的视频尚无帧，尺寸取自容器
+        const auto frameSize = imageAsset.animationStream ? imageAsset.animationStream->frameSize() : imageAsset.frameAt(0).size();
+        pixels = (double)frameSize.area() * imageAsset.frameCount();
+    }
+    else
+        pixels = imageAsset.previewFrame.empty() ? (double)imageAsset.primaryFrame.total() : (double)imageAsset.fullSize.area();
+    pixels = std::max(pixels, 1.0);
+
+    std::lock_guard<std::mutex> lock(decodeStatMutex);
+    auto& stat = decodeStatMap[getLowerExt(path)];
+    if (stat.count == 0) {
+        stat.avgMs = elapsedMs;
+        stat.avgBytes = bytes;
+        stat.avgShrunkBytes = shrunkBytes;
+        stat.avgPixels = pixels;
+    }
+    else { // 指数滑动平均，偏向最近的图像
+        stat.avgMs = stat.avgMs * 0.7 + elapsedMs * 0.3;
+        stat.avgBytes = stat.avgBytes * 0.7 + bytes * 0.3;
+        stat.avgShrunkBytes = stat.avgShrunkBytes * 0.7 + shrunkBytes * 0.3;
+        stat.avgPixels = stat.avgPixels * 0.7 + pixels * 0.3;
+    }
+    stat.count++;
+}
+
+
+ImageDatabase::DecodeStat ImageDatabase::getDecodeStat(const wstring& path) {
+    std::lock_guard<std::mutex> lock(decodeStatMutex);
+    auto it = decodeStatMap.find(getLowerExt(path));
+    return it == decodeStatMap.end() ? DecodeStat{} : it->second;
+}
+
+
+void ImageDatabase::updateMetrics(const wstring& curPath) {
+    const auto lruStats = stats();
+    Metrics::setGauge("cache.hits", (int64_t)lruStats.hits);
+    Metrics::setGauge("cache.misses", (int64_t)lruStats.misses);
+    Metrics::setGauge("cache.evictions", (int64_t)lruStats.evictions);
+    Metrics::setGauge("cache.shrinks", (int64_t)lruStats.shrinks);
+    Metrics::setGauge("cache.entries", (int64_t)size());
+    Metrics::setGauge("cache.residentBytes", (int64_t)memoryUsage());
+    Metrics::setGauge("cache.currentImageBytes", curPath.empty() ? 0 : (int64_t)entryBytes(curPath));
+    Metrics::setGauge("cache.budgetBytes", memoryBudget() == SIZE_MAX ? -1 : (int64_t)memoryBudget());
+    Metrics::setGauge("preload.queueDepth", (int64_t)lruStats.queueDepth);
+    Metrics::setGauge("preload.running", (int64_t)lruStats.running);
+    Metrics::setGauge("preload.threads", (int64_t)preloadThreads());
+}
+
+
+int ImageDatabase::getPrefetchCount(const wstring& curPath, const vector<wstring>& aheadPaths, double switchIntervalMs) {
+    const double budget = (double)memoryBudget();
+    const double threads = (double)std::max<size_t>(preloadThreads(), 1);
+    const int maxCount = std::min<int>(PREFETCH_MAX, (int)capacity() - 2); // 留出当前图和反方向一张
+
+    double bytesSum = (double)entryBytes(curPath);
+    double decodeMsSum = 0;
+    int count = 0;
+    vector<wstring> unprobedPaths;
+    for (const auto& path : aheadPaths) {
+        if (count >= maxCount)
+            break;
+
+        // 下一张保留原图，更远的图在内存紧张时可缩减为预览
+        auto stat = getDecodeStat(path);
+        double bytes = count == 0 ? stat.avgBytes : stat.avgShrunkBytes;
+        double decodeMs = stat.avgMs;
+
+        // 文件头能给出尺寸时，按像素数缩放该格式的平均值  尚未读取的按格式平均值估算，并在后台读取供下次使用
+        ImageProbe probeInfo;
+        if (!tryGetCachedProbe(path, probeInfo))
+            unprobedPaths.push_back(path);
+        else if (probeInfo.isValid()) {
+            const double ratio = probeInfo.pixels() / stat.avgPixels;
+            bytes = count == 0 ? stat.avgBytes * ratio : std::min(stat.avgBytes * ratio, stat.avgShrunkBytes);
+            decodeMs = stat.avgMs * ratio;
         }
-        return imageAsset;
+
+        bytesSum += bytes;
+        if (count > 0 && bytesSum > budget)
+            break;
+
+        decodeMsSum += decodeMs;
+        count++;
+
+        // 多线程并发解码，窗口内的图都能在切到之前解码完成，无需更深
+        if (decodeMsSum / threads <= switchIntervalMs * count)
+            break;
     }
-    else if (ext == L"wp2") { // webp2 静态或动画
-        auto imageAsset = loadWP2(path, fileBuf);
-        if (imageAsset.format == ImageFormat::None) {
-            imageAsset.format = ImageFormat::Still;
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, 0, 0, fileBuf.data(), fileBuf.size());
+
+    // 窗口外紧接着的几张也提前读取，窗口加深时可直接使用
+    for (size_t i = count; i < aheadPaths.size() && i < (size_t)count + 2; i++) {
+        ImageProbe probeInfo;
+        if (!tryGetCachedProbe(aheadPaths[i], probeInfo))
+            unprobedPaths.push_back(aheadPaths[i]);
+    }
+    requestProbes(unprobedPaths);
+    return std::max(count, 1);
+}
+
+
+ImageAsset ImageDatabase::loader(const wstring& path) {
+    auto ext = getLowerExt(path);
+    Metrics::LoadScope loadScope(ext);
+
+    // 先于读取文件记录文件身份，解码期间文件若被改写，下次访问时仍能发现
+    FileIdentity fileIdentity;
+    jarkUtils::getFileIdentity(path, fileIdentity);
+
+    // 文件以内存映射打开，解码器直接读取映射内存，解码结束前保持映射
+    // 磁盘缓存命中时只访问了文件头所在的页，映射不会读入整个文件
+    MappedFile file;
+    {
+        Metrics::StageTimer stageTimer(Metrics::Stage::Read);
+        if (path.length() >= 4 && !file.open(path))
+            jarkUtils::log("path canot open: {}", jarkUtils::wstringToUtf8(path));
+    }
+
+    // 解码器按文件内容识别（扩展名可能与内容不符），是否使用磁盘缓存也以实际解码器为准
+    const DecoderEntry* decoderEntry = file.size() >= 16 ? &sniffDecoder(file.bytes(), ext) : nullptr;
+    const bool isUseDiskCache = DiskCache::isEnabled() && decoderEntry && (decoderEntry->caps & CapSlowDecode);
+
+    ImageAsset imageAsset;
+    bool isDiskCacheHit = false;
+    if (isUseDiskCache) {
+        Metrics::StageTimer stageTimer(Metrics::Stage::DiskCache);
+        isDiskCacheHit = diskCache.read(path, fileIdentity, imageAsset);
+        Metrics::addCounter(isDiskCacheHit ? "diskCache.hits" : "diskCache.misses");
+    }
+
+    if (isDiskCacheHit) {
+        jarkUtils::log("disk cache hit: {}", jarkUtils::wstringToUtf8(path));
+    }
+    else {
+        // reload 说明需要原图（放大、复制、打印或源文件已变），其余情况可缩小解码
+        imageAsset = decodeFile(path, file, decoderEntry, isReloadRequest());
+        imageAsset.fileIdentity = fileIdentity;
+
+        // 映射文件允许其他程序同时写入，解码后再次比对文件身份：解码期间文件被改写，结果可能不完整
+        // 仍记录解码前的身份，下次访问时 isValueValid 发现不一致即重新加载
+        FileIdentity afterIdentity;
+        const bool isChangedDuringDecode = jarkUtils::getFileIdentity(path, afterIdentity) && afterIdentity != fileIdentity;
+        if (isChangedDuringDecode) {
+            jarkUtils::log("file changed while decoding: {}", jarkUtils::wstringToUtf8(path));
+            Metrics::addCounter("load.fileChanged");
         }
-        else if (imageAsset.format == ImageFormat::Still) {
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, imageAsset.primaryFrame.cols, imageAsset.primaryFrame.rows,
-                fileBuf.data(), fileBuf.size())
-                + ExifParse::getExif(path, fileBuf.data(), fileBuf.size());
+
+        // 解码失败、缩小解码、解码期间文件被改写或已被取消（结果会被丢弃）的不写入磁盘缓存
+        if (isUseDiskCache && !isLoadCancelled() && !isChangedDuringDecode && imageAsset.format != ImageFormat::None &&
+            !imageAsset.isPreviewOnly() && !isErrorTipsMat(imageAsset.primaryFrame))
+            diskCache.write(path, imageAsset);
+    }
+
+    if (!isLoadCancelled()) {
+        createPreview(imageAsset);
+        compactFrames(imageAsset);
+    }
+
+    if (isLoadCancelled()) {
+        loadScope.discard();
+        Metrics::addCounter("load.cancelled");
+    }
+
+    return imageAsset;
+}
+
+
+ImageProbe ImageDatabase::getCachedProbe(const wstring& path) {
+    {
+        std::lock_guard<std::mutex> lock(probeCacheMutex);
+        if (auto it = probeCache.find(path); it != probeCache.end())
+            return it->second;
+    }
+
+    auto probeInfo = probe(path);
+
+    std::lock_guard<std::mutex> lock(probeCacheMutex);
+    if (probeCache.size() >= PROBE_CACHE_MAX)
+        probeCache.clear();
+    probeCache[path] = probeInfo;
+    return probeInfo;
+}
+
+
+bool ImageDatabase::tryGetCachedProbe(const wstring& path, ImageProbe& probeInfo) {
+    std::lock_guard<std::mutex> lock(probeCacheMutex);
+    auto it = probeCache.find(path);
+    if (it == probeCache.end())
+        return false;
+    probeInfo = it->second;
+    return true;
+}
+
+
+void ImageDatabase::requestProbes(const vector<wstring>& paths) {
+    for (const auto& path : paths) {
+        {
+            std::lock_guard<std::mutex> lock(probeCacheMutex);
+            if (probeCache.contains(path) || !probePending.insert(path).second)
+                continue;
         }
-        else {
-            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, imageAsset.frames[0].cols, imageAsset.frames[0].rows, fileBuf.data(), fileBuf.size())
-                + ExifParse::getExif(path, fileBuf.data(), fileBuf.size());
+        runOnPreloadThread([this, path] {
+            getCachedProbe(path);
+            std::lock_guard<std::mutex> lock(probeCacheMutex);
+            probePending.erase(path);
+            });
+    }
+}
+
+
+static uint32_t readBE16(const uint8_t* p) { return ((uint32_t)p[0] << 8) | p[1]; }
+static uint32_t readBE32(const uint8_t* p) { return (readBE16(p) << 16) | readBE16(p + 2); }
+static uint32_t readLE16(const uint8_t* p) { return p[0] | ((uint32_t)p[1] << 8); }
+static uint32_t readLE24(const uint8_t* p) { return readLE16(p) | ((uint32_t)p[2] << 16); }
+static uint32_t readLE32(const uint8_t* p) { return readLE16(p) | (readLE16(p + 2) << 16); }
+
+
+struct TiffIfd0 {
+    uint32_t width = 0;
+    uint32_t height = 0;
+    int bitsPerSample = 0;
+    int orientation = 1;
+
+    // 用于区分基于 TIFF 的 RAW 与普通 TIFF
+    bool hasMake = false;           // Make(271)
+    bool hasDngVersion = false;     // DNGVersion(50706)
+    bool hasSubIfds = false;        // SubIFDs(330)
+    uint32_t newSubfileType = 0;    // NewSubfileType(254)  1 表示 IFD0 只是缩略图
+    uint32_t compression = 1;       // Compression(259)
+};
+
+// 解析 TIFF 的 IFD0，TIFF 文件及 JPEG/PNG/WebP/AVIF 内嵌的 EXIF 均为此结构
+static bool parseTiffIfd0(span<const uint8_t> buf, TiffIfd0& ifd0) {
+    if (buf.size() < 8)
+        return false;
+
+    bool isLE;
+    if (memcmp(buf.data(), "II*\0", 4) == 0)
+        isLE = true;
+    else if (memcmp(buf.data(), "MM\0*", 4) == 0)
+        isLE = false;
+    else
+        return false;
+
+    auto u16 = [&](size_t offset) { return isLE ? readLE16(buf.data() + offset) : readBE16(buf.data() + offset); };
+    auto u32 = [&](size_t offset) { return isLE ? readLE32(buf.data() + offset) : readBE32(buf.data() + offset); };
+
+    const size_t ifdOffset = u32(4);
+    if (ifdOffset + 2 > buf.size())
+        return false;
+
+    const uint32_t entryCount = u16(ifdOffset);
+    for (uint32_t i = 0; i < entryCount; i++) {
+        const size_t entry = ifdOffset + 2 + (size_t)i * 12;
+        if (entry + 12 > buf.size())
+            break;
+
+        // 只关心 SHORT(3)/LONG(4) 类型，单个值存于条目内
+        const uint32_t tag = u16(entry);
+        const uint32_t type = u16(entry + 2);
+        const uint32_t count = u32(entry + 4);
+        const uint32_t value = type == 3 ? u16(entry + 8) : u32(entry + 8);
+        switch (tag) {
+        case 256: ifd0.width = value; break;
+        case 257: ifd0.height = value; break;
+        case 258: // 多通道时值为指向数组的偏移
+            if (type == 3 && count > 2) {
+                if ((size_t)u32(entry + 8) + 2 <= buf.size())
+                    ifd0.bitsPerSample = u16(u32(entry + 8));
+            }
+            else {
+                ifd0.bitsPerSample = value;
+            }
+            break;
+        case 274: ifd0.orientation = (value >= 1 && value <= 8) ? value : 1; break;
+        case 254: ifd0.newSubfileType = value; break;
+        case 259: ifd0.compression = value; break;
+        case 271: ifd0.hasMake = true; break;
+        case 330: ifd0.hasSubIfds = true; break;
+        case 50706: ifd0.hasDngVersion = true; break;
         }
-        return imageAsset;
     }
+    return true;
+}
 
-    // 实况照片 包含一张图片和一段简短视频
-    if (ext == L"livp") {
-        return loadLivp(path, fileBuf);
+
+// 基于 TIFF 的 RAW（DNG/CR2/NEF/ARW/PEF ...）与普通 TIFF 文件头相同，按 IFD0 的内容区分：
+// CR2 在 TIFF 头后带 "CR" 标记，DNG 有 DNGVersion 标签，其余由相机写入 Make，且原始数据在子 IFD 中（IFD0 只是缩略图）或使用厂商私有压缩
+// 相机导出的普通 TIFF 同样带 Make，但 IFD0 即为完整图像且没有子 IFD
+static bool isTiffBasedRaw(span<const uint8_t> buf) {
+    TiffIfd0 ifd0;
+    if (!parseTiffIfd0(buf, ifd0))
+        return false;
+    if (buf.size() >= 10 && memcmp(buf.data() + 8, "CR", 2) == 0)
+        return true;
+    if (ifd0.hasDngVersion)
+        return true;
+
+    // Sony ARW(32767) Nikon NEF(32769/32770/34713) Samsung SRW(32769/32770) Pentax PEF(65535) Kodak DCR(65000)
+    static constexpr uint32_t vendorCompressions[] = { 32767, 32769, 32770, 34713, 65000, 65535 };
+    return ifd0.hasMake && (ifd0.hasSubIfds || ifd0.newSubfileType == 1 ||
+        std::ranges::find(vendorCompressions, ifd0.compression) != std::end(vendorCompressions));
+}
+
+
+// EXIF 数据可能带有 "Exif\0\0" 前缀或几个字节的偏移头，找到 TIFF 头后读取方向
+static int parseExifOrientation(span<const uint8_t> exif) {
+    for (size_t i = 0; i + 4 <= exif.size() && i < 16; i++) {
+        if (memcmp(exif.data() + i, "II*\0", 4) == 0 || memcmp(exif.data() + i, "MM\0*", 4) == 0) {
+            TiffIfd0 ifd0;
+            return parseTiffIfd0(exif.subspan(i), ifd0) ? ifd0.orientation : 1;
+        }
     }
-    else if (ext == L"jpg" || ext == L"jpeg") {
-        return loadMotionPhoto(path, fileBuf, true);
+    return 1;
+}
+
+
+static bool probeJPEG(span<const uint8_t> buf, ImageProbe& info) {
+    size_t pos = 2;
+    while (pos + 4 <= buf.size()) {
+        if (buf[pos] != 0xFF)
+            return false;
+
+        const uint8_t marker = buf[pos + 1];
+        if (marker == 0xFF) { // 填充字节
+            pos++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) { // 无长度的标记
+            pos += 2;
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA) // 已到扫描数据仍没有 SOF
+            return false;
+
+        const size_t len = readBE16(buf.data() + pos + 2);
+        if (len < 2 || pos + 2 + len > buf.size())
+            return false;
+        const auto segment = buf.subspan(pos + 4, len - 2);
+
+        // APP1 EXIF 总在 SOF 之前
+        if (marker == 0xE1 && segment.size() > 6 && memcmp(segment.data(), "Exif\0\0", 6) == 0)
+            info.orientation = parseExifOrientation(segment);
+
+        // SOF0~SOF15，排除 DHT(C4) JPG(C8) DAC(CC)
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            if (segment.size() < 5)
+                return false;
+            info.bitDepth = segment[0];
+            info.height = readBE16(segment.data() + 1);
+            info.width = readBE16(segment.data() + 3);
+            info.frameCount = 1;
+            return true;
+        }
+        pos += 2 + len;
     }
-    else if (ext == L"heic" || ext == L"heif") {
-        return loadMotionPhoto(path, fileBuf);
+    return false;
+}
+
+
+// JPEG 中 APP1 EXIF 段的 TIFF 结构（去掉 "Exif\0\0" 前缀）
+static span<const uint8_t> findJpegExifTiff(span<const uint8_t> buf) {
+    size_t pos = 2;
+    while (pos + 4 <= buf.size()) {
+        if (buf[pos] != 0xFF)
+            return {};
+
+        const uint8_t marker = buf[pos + 1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD8)) {
+            pos += 2;
+            continue;
+        }
+        if (marker == 0xD9 || marker == 0xDA)
+            return {};
+
+        const size_t len = readBE16(buf.data() + pos + 2);
+        if (len < 2 || pos + 2 + len > buf.size())
+            return {};
+        if (marker == 0xE1 && len - 2 > 6 && memcmp(buf.data() + pos + 4, "Exif\0\0", 6) == 0)
+            return buf.subspan(pos + 10, len - 8);
+        pos += 2 + len;
     }
+    return {};
+}
 
-    //以下是静态图
-    cv::Mat img;
-    string exifInfo;
 
-    if (ext == L"avif" || ext == L"avifs") {
-        img = loadAvif(path, fileBuf);
+// EXIF 的 IFD1 以 JPEGInterchangeFormat(513)/JPEGInterchangeFormatLength(514) 指向内嵌的 JPEG 缩略图（通常 160x120）
+// tiff 为 JPEG 的 EXIF 段或 TIFF 文件本身，偏移均相对 TIFF 头
+static span<const uint8_t> findTiffJpegThumbnail(span<const uint8_t> tiff) {
+    if (tiff.size() < 8)
+        return {};
+
+    bool isLE;
+    if (memcmp(tiff.data(), "II*\0", 4) == 0)
+        isLE = true;
+    else if (memcmp(tiff.data(), "MM\0*", 4) == 0)
+        isLE = false;
+    else
+        return {};
+
+    auto u16 = [&](size_t offset) { return isLE ? readLE16(tiff.data() + offset) : readBE16(tiff.data() + offset); };
+    auto u32 = [&](size_t offset) { return isLE ? readLE32(tiff.data() + offset) : readBE32(tiff.data() + offset); };
+
+    const size_t ifd0Offset = u32(4);
+    if (ifd0Offset + 2 > tiff.size())
+        return {};
+    const size_t nextIfdPos = ifd0Offset + 2 + (size_t)u16(ifd0Offset) * 12;
+    if (nextIfdPos + 4 > tiff.size())
+        return {};
+    const size_t ifd1Offset = u32(nextIfdPos);
+    if (ifd1Offset == 0 || ifd1Offset + 2 > tiff.size())
+        return {};
+
+    size_t thumbOffset = 0, thumbLength = 0;
+    const uint32_t entryCount = u16(ifd1Offset);
+    for (uint32_t i = 0; i < entryCount; i++) {
+        const size_t entry = ifd1Offset + 2 + (size_t)i * 12;
+        if (entry + 12 > tiff.size())
+            break;
+        const uint32_t tag = u16(entry);
+        if (tag == 513)
+            thumbOffset = u32(entry + 8);
+        else if (tag == 514)
+            thumbLength = u32(entry + 8);
     }
-    else if (ext == L"jxr") {
-        img = loadJXR(path, fileBuf);
+
+    if (thumbOffset == 0 || thumbLength < 4 || thumbOffset + thumbLength > tiff.size())
+        return {};
+    auto jpeg = tiff.subspan(thumbOffset, thumbLength);
+    if (jpeg[0] != 0xFF || jpeg[1] != 0xD8)
+        return {};
+    return jpeg;
+}
+
+
+// JPEG/TIFF 取 EXIF 内嵌的缩略图，HEIC 取缩略图项，JXL 在 loadJXL 中发布 DC 预览
+bool ImageDatabase::hasEmbeddedThumbnail(const DecoderEntry& entry) {
+    return entry.decoder == Decoder::MotionPhoto || entry.decoder == Decoder::HeifMotionPhoto || entry.decoder == Decoder::OpenCV;
+}
+
+
+// probeInfo 由 decodeFile 传入，与计算缩小解码比例共用同一次 probe
+void ImageDatabase::publishThumbnail(const wstring& path, span<const uint8_t> fileBuf, const DecoderEntry& entry, const ImageProbe& probeInfo) {
+    if (!probeInfo.isValid() || !isWorthProvisional(path, probeInfo.pixels()))
+        return;
+
+    cv::Mat thumb;
+    int orientation = 1;
+    if (entry.decoder == Decoder::HeifMotionPhoto) {
+        thumb = loadHeicThumbnail(fileBuf);
     }
-    else if (ext == L"tga" || ext == L"hdr") {
-        img = loadTGA_HDR(path, fileBuf);
-        exifInfo = ExifParse::getSimpleInfo(path, img.cols, img.rows, fileBuf.data(), fileBuf.size());
+    else {
+        const auto jpeg = findTiffJpegThumbnail(entry.decoder == Decoder::MotionPhoto ? findJpegExifTiff(fileBuf) : fileBuf);
+        if (jpeg.empty())
+            return;
+        thumb = loadMat(path, jpeg);
+        orientation = probeInfo.orientation;
     }
-    else if (ext == L"svg") {
-        img = loadSVG(path, fileBuf);
-        exifInfo = ExifParse::getSimpleInfo(path, img.cols, img.rows, fileBuf.data(), fileBuf.size());
-        if (img.empty()) {
-            img = getErrorTipsMat();
+
+    auto provisionalAsset = makeProvisionalAsset(thumb, { probeInfo.width, probeInfo.height },
+        ExifParse::getSimpleInfo(path, probeInfo.width, probeInfo.height, fileBuf.data(), fileBuf.size()), orientation);
+    if (provisionalAsset.format == ImageFormat::None)
+        return;
+
+    Metrics::addCounter("load.provisional");
+    publishProvisional(path, std::move(provisionalAsset));
+}
+
+
+static bool probePNG(span<const uint8_t> buf, ImageProbe& info) {
+    if (buf.size() < 33 || memcmp(buf.data() + 12, "IHDR", 4) != 0)
+        return false;
+
+    info.width = (int)readBE32(buf.data() + 16);
+    info.height = (int)readBE32(buf.data() + 20);
+    info.bitDepth = buf[24];
+    info.frameCount = 1;
+
+    // APNG 的 acTL 位于 IDAT 之前，遇到 IDAT 即可停止
+    size_t pos = 8;
+    while (pos + 12 <= buf.size()) {
+        const size_t len = readBE32(buf.data() + pos);
+        const uint8_t* type = buf.data() + pos + 4;
+        if (memcmp(type, "IDAT", 4) == 0)
+            break;
+        if (memcmp(type, "acTL", 4) == 0 && len >= 4)
+            info.frameCount = (int)readBE32(buf.data() + pos + 8);
+        else if (memcmp(type, "eXIf", 4) == 0 && pos + 8 + len <= buf.size())
+            info.orientation = parseExifOrientation(buf.subspan(pos + 8, len));
+        pos += 12 + len;
+    }
+    return true;
+}
+
+
+static bool probeGIF(span<const uint8_t> buf, ImageProbe& info) {
+    if (buf.size() < 13)
+        return false;
+
+    info.width = (int)readLE16(buf.data() + 6);
+    info.height = (int)readLE16(buf.data() + 8);
+    info.bitDepth = 8;
+
+    size_t pos = 13;
+    if (buf[10] & 0x80) // 全局调色板
+        pos += 3ULL << ((buf[10] & 7) + 1);
+
+    auto skipSubBlocks = [&] {
+        while (pos < buf.size()) {
+            const uint8_t blockSize = buf[pos++];
+            if (blockSize == 0)
+                return true;
+            pos += blockSize;
+        }
+        return false;
+        };
+
+    // 只跳过各数据块统计图像块数量，不解压 LZW
+    int frames = 0;
+    while (pos < buf.size()) {
+        const uint8_t blockType = buf[pos++];
+        if (blockType == 0x21) { // 扩展块
+            pos++;
+            if (!skipSubBlocks())
+                break;
+        }
+        else if (blockType == 0x2C) { // 图像块
+            if (pos + 9 > buf.size())
+                break;
+            const uint8_t flags = buf[pos + 8];
+            pos += 9;
+            if (flags & 0x80) // 局部调色板
+                pos += 3ULL << ((flags & 7) + 1);
+            pos++; // LZW 最小码长
+            frames++;
+            if (!skipSubBlocks())
+                break;
+        }
+        else { // 0x3B 结束或数据损坏
+            break;
         }
     }
-    else if (ext == L"qoi") {
-        img = loadQOI(path, fileBuf);
-        exifInfo = ExifParse::getSimpleInfo(path, img.cols, img.rows, fileBuf.data(), fileBuf.size());
-        if (img.empty()) {
-            img = getErrorTipsMat();
+    info.frameCount = std::max(frames, 1);
+    return true;
+}
+
+
+static bool probeWebP(span<const uint8_t> buf, ImageProbe& info) {
+    if (buf.size() < 30)
+        return false;
+
+    const uint8_t* p = buf.data();
+    info.bitDepth = 8;
+    info.frameCount = 1;
+
+    if (memcmp(p + 12, "VP8 ", 4) == 0) { // 有损
+        if (p[23] != 0x9D || p[24] != 0x01 || p[25] != 0x2A)
+            return false;
+        info.width = (int)(readLE16(p + 26) & 0x3FFF);
+        info.height = (int)(readLE16(p + 28) & 0x3FFF);
+        return true;
+    }
+
+    if (memcmp(p + 12, "VP8L", 4) == 0) { // 无损
+        if (p[20] != 0x2F)
+            return false;
+        const uint32_t bits = readLE32(p + 21);
+        info.width = (int)(bits & 0x3FFF) + 1;
+        info.height = (int)((bits >> 14) & 0x3FFF) + 1;
+        return true;
+    }
+
+    if (memcmp(p + 12, "VP8X", 4) == 0) { // 扩展格式
+        const uint8_t flags = p[20];
+        info.width = (int)readLE24(p + 24) + 1;
+        info.height = (int)readLE24(p + 27) + 1; // 画布尺寸为 24 位，最后一字节位于 p[29]
+
+        // 动画(0x02)需统计 ANMF 块，含 EXIF(0x08)则读取方向
+        if (flags & 0x0A) {
+            int frames = 0;
+            size_t pos = 30;
+            while (pos + 8 <= buf.size()) {
+                const size_t len = readLE32(p + pos + 4);
+                if (memcmp(p + pos, "ANMF", 4) == 0)
+                    frames++;
+                else if (memcmp(p + pos, "EXIF", 4) == 0 && pos + 8 + len <= buf.size())
+                    info.orientation = parseExifOrientation(buf.subspan(pos + 8, len));
+                pos += 8 + len + (len & 1);
+            }
+            if (flags & 0x02)
+                info.frameCount = std::max(frames, 1);
         }
+        return true;
     }
-    else if (ext == L"ico" || ext == L"icon") {
-        std::tie(img, exifInfo) = loadICO(path, fileBuf);
+    return false;
+}
+
+
+static bool probeWP2(span<const uint8_t> buf, ImageProbe& info) {
+    WP2::BitstreamFeatures features;
+    if (features.Read(buf.data(), buf.size()) != WP2_STATUS_OK)
+        return false;
+
+    // 宽高已计入方向，与解码输出一致
+    info.width = (int)features.width;
+    info.height = (int)features.height;
+    info.frameCount = 1;
+    if (features.is_animation) {
+        size_t frames = 0; // 只解析各帧的帧头，出错时为已解析到的帧数
+        const auto status = WP2::GetNumFrames(buf.data(), buf.size(), &frames);
+        if (status != WP2_STATUS_OK)
+            jarkUtils::log("WP2 GetNumFrames: {}", statusExplain(status));
+        info.frameCount = std::max((int)frames, 1);
     }
-    else if (ext == L"psd") {
-        img = loadPSD(path, fileBuf);
-        if (img.empty())
-            img = getErrorTipsMat();
+    return true;
+}
+
+
+static bool probeBPG(span<const uint8_t> buf, ImageProbe& info) {
+    if (buf.size() < 8)
+        return false;
+
+    info.bitDepth = (buf[4] & 0x0F) + 8;
+    const bool isAnimated = buf[5] & 0x01;
+
+    // ue7 变长整数：每字节低 7 位有效，最高位为 1 表示后续还有字节
+    size_t pos = 6;
+    auto readUE7 = [&](int& value) {
+        uint32_t ret = 0;
+        for (int i = 0; i < 5 && pos < buf.size(); i++) {
+            const uint8_t byte = buf[pos++];
+            ret = (ret << 7) | (byte & 0x7F);
+            if (!(byte & 0x80)) {
+                value = (int)ret;
+                return true;
+            }
+        }
+        return false;
+        };
+    if (!readUE7(info.width) || !readUE7(info.height))
+        return false;
+
+    info.frameCount = isAnimated ? 0 : 1; // 动画帧数需解析全部 NAL，不统计
+    return true;
+}
+
+
+static bool probeHEIF(span<const uint8_t> buf, ImageProbe& info) {
+    // 只解析容器的各个 box，不解码 HEVC 码流
+    heif_context* ctx = heif_context_alloc();
+    auto err = heif_context_read_from_memory_without_copy(ctx, buf.data(), buf.size(), nullptr);
+    if (err.code) {
+        heif_context_free(ctx);
+        return false;
     }
-    else if (ext == L"pfm") {
-        img = loadPFM(path, fileBuf);
-        if (img.empty()) {
-            img = getErrorTipsMat();
-            exifInfo = ExifParse::getSimpleInfo(path, 0, 0, fileBuf.data(), fileBuf.size());
+
+    heif_image_handle* handle = nullptr;
+    err = heif_context_get_primary_image_handle(ctx, &handle);
+    if (err.code) {
+        heif_context_free(ctx);
+        return false;
+    }
+
+    // libheif 已按 irot/imir 变换，宽高即为显示尺寸
+    info.width = heif_image_handle_get_width(handle);
+    info.height = heif_image_handle_get_height(handle);
+    info.bitDepth = heif_image_handle_get_luma_bits_per_pixel(handle);
+    info.frameCount = 1;
+
+    heif_image_handle_release(handle);
+    heif_context_free(ctx);
+    return true;
+}
+
+
+static bool probeAVIF(span<const uint8_t> buf, ImageProbe& info) {
+    avifDecoder* decoder = avifDecoderCreate();
+    if (decoder == nullptr)
+        return false;
+
+    decoder->strictFlags = AVIF_STRICT_DISABLED;
+
+    // avifDecoderParse 只解析容器和序列头，不解码 AV1 数据
+    bool ret = false;
+    if (avifDecoderSetIOMemory(decoder, buf.data(), buf.size()) == AVIF_RESULT_OK &&
+        avifDecoderParse(decoder) == AVIF_RESULT_OK) {
+        info.width = (int)decoder->image->width;
+        info.height = (int)decoder->image->height;
+        info.bitDepth = (int)decoder->image->depth;
+        info.frameCount = decoder->imageCount;
+        if (decoder->image->exif.size)
+            info.orientation = parseExifOrientation({ decoder->image->exif.data, decoder->image->exif.size });
+        ret = true;
+    }
+    avifDecoderDestroy(decoder);
+    return ret;
+}
+
+
+static bool probeJXL(span<const uint8_t> buf, ImageProbe& info) {
+    auto dec = JxlDecoderMake(nullptr);
+
+    // 未订阅 JXL_DEC_FULL_IMAGE，解码器遇到帧时只解析帧头并跳过像素数据
+    if (JXL_DEC_SUCCESS != JxlDecoderSubscribeEvents(dec.get(), JXL_DEC_BASIC_INFO | JXL_DEC_FRAME))
+        return false;
+
+    JxlDecoderSetInput(dec.get(), buf.data(), buf.size());
+    JxlDecoderCloseInput(dec.get());
+
+    JxlBasicInfo basicInfo{};
+    bool hasBasicInfo = false;
+    int frames = 0;
+    for (;;) {
+        const auto status = JxlDecoderProcessInput(dec.get());
+        if (status == JXL_DEC_BASIC_INFO) {
+            if (JXL_DEC_SUCCESS != JxlDecoderGetBasicInfo(dec.get(), &basicInfo))
+                return false;
+            hasBasicInfo = true;
+            if (!basicInfo.have_animation) // 静态图无需遍历帧
+                break;
         }
-        else {
-            exifInfo = ExifParse::getSimpleInfo(path, img.cols, img.rows, fileBuf.data(), fileBuf.size());
+        else if (status == JXL_DEC_FRAME) {
+            frames++;
+        }
+        else { // JXL_DEC_SUCCESS 或出错
+            break;
         }
     }
-    else if (supportRaw.contains(ext)) {
-        img = loadRaw(path, fileBuf);
-        if (img.empty())
-            img = getErrorTipsMat();
+    if (!hasBasicInfo)
+        return false;
+
+    // 解码器默认按方向输出，5~8 宽高互换
+    const bool isTransposed = basicInfo.orientation >= JXL_ORIENT_TRANSPOSE;
+    info.width = (int)(isTransposed ? basicInfo.ysize : basicInfo.xsize);
+    info.height = (int)(isTransposed ? basicInfo.xsize : basicInfo.ysize);
+    info.bitDepth = (int)basicInfo.bits_per_sample;
+    info.frameCount = basicInfo.have_animation ? std::max(frames, 1) : 1;
+    info.orientation = (int)basicInfo.orientation;
+    return true;
+}
+
+
+static bool probeRaw(span<const uint8_t> buf, ImageProbe& info) {
+    // open_buffer 只识别机型并解析元数据，不 unpack
+    auto rawProcessor = std::make_unique<LibRaw>();
+    if (rawProcessor->open_buffer(buf.data(), buf.size()) != LIBRAW_SUCCESS)
+        return false;
+
+    // LibRaw 输出时按 flip 旋转，flip 的第 3 位表示宽高互换
+    const auto& sizes = rawProcessor->imgdata.sizes;
+    const bool isTransposed = sizes.flip & 4;
+    info.width = isTransposed ? sizes.height : sizes.width;
+    info.height = isTransposed ? sizes.width : sizes.height;
+    info.frameCount = 1;
+
+    for (auto maximum = rawProcessor->imgdata.color.maximum; maximum; maximum >>= 1)
+        info.bitDepth++;
+
+    info.orientation = rawFlipToOrientation(sizes.flip);
+    return true;
+}
+
+
+static bool probeICO(span<const uint8_t> buf, ImageProbe& info) {
+    const uint32_t count = readLE16(buf.data() + 4);
+    if (count == 0 || count > 255 || 6 + count * 16ULL > buf.size())
+        return false;
+
+    // 与 loadICO 一致，各尺寸的图标横向拼接显示
+    for (uint32_t i = 0; i < count; i++) {
+        const uint8_t* entry = buf.data() + 6 + i * 16;
+        info.width += entry[0] == 0 ? 256 : entry[0];
+        info.height = std::max<int>(info.height, entry[1] == 0 ? 256 : entry[1]);
+        info.bitDepth = std::max<int>(info.bitDepth, (int)readLE16(entry + 6));
     }
+    info.bitDepth = std::min(info.bitDepth, 8);
+    info.frameCount = 1;
+    return true;
+}
 
-    if (img.empty())
+
+ImageProbe ImageDatabase::probe(span<const uint8_t> buf, const DecoderEntry& entry) {
+    ImageProbe info;
+    if (buf.size() < 16)
+        return info;
+
+    const uint8_t* p = buf.data();
+    bool ret = false;
+    bool isRotatedByViewer = false; // 解码后按 EXIF 方向显示
+    switch (entry.decoder) {
+    case Decoder::MotionPhoto:
+        ret = probeJPEG(buf, info);
+        isRotatedByViewer = true;
+        break;
+
+    case Decoder::OpenCVAnimation:
+        if (memcmp(p, "\x89PNG", 4) == 0)
+            ret = probePNG(buf, info);
+        else if (memcmp(p, "GIF8", 4) == 0)
+            ret = probeGIF(buf, info);
+        else
+            ret = probeWebP(buf, info);
+        break;
+
+    case Decoder::OpenCV:
+        if (memcmp(p, "BM", 2) == 0 && buf.size() >= 30) {
+            info.width = (int)readLE32(p + 18);
+            info.height = std::abs((int)readLE32(p + 22)); // 负数表示自上而下存储
+            info.bitDepth = std::min<int>((int)readLE16(p + 28), 8);
+            info.frameCount = 1;
+            ret = true;
+        }
+        else if (TiffIfd0 ifd0; parseTiffIfd0(buf, ifd0)) {
+            info.width = (int)ifd0.width;
+            info.height = (int)ifd0.height;
+            info.bitDepth = ifd0.bitsPerSample;
+            info.frameCount = 1;
+            info.orientation = ifd0.orientation;
+            ret = true;
+            isRotatedByViewer = true;
+        }
+        break;
+
+    case Decoder::HeifMotionPhoto:
+        ret = probeHEIF(buf, info);
+        break;
+
+    case Decoder::Avif:
+        ret = probeAVIF(buf, info);
+        isRotatedByViewer = true;
+        break;
+
+    case Decoder::Jxl:
+        ret = probeJXL(buf, info);
+        break;
+
+    case Decoder::Bpg:
+        ret = probeBPG(buf, info);
+        break;
+
+    case Decoder::Wp2:
+        ret = probeWP2(buf, info);
+        break;
+
+    case Decoder::Raw:
+        ret = probeRaw(buf, info);
+        break;
+
+    case Decoder::Qoi:
+        info.width = (int)readBE32(p + 4);
+        info.height = (int)readBE32(p + 8);
+        info.bitDepth = 8;
+        info.frameCount = 1;
+        ret = true;
+        break;
+
+    case Decoder::Psd:
+        if (buf.size() >= 26) {
+            info.height = (int)readBE32(p + 14);
+            info.width = (int)readBE32(p + 18);
+            info.bitDepth = (int)readBE16(p + 22);
+            info.frameCount = 1;
+            ret = true;
+        }
+        break;
+
+    case Decoder::Ico:
+        ret = probeICO(buf, info);
+        break;
+
+    case Decoder::TgaHdr:
+        if (memcmp(p, "#?", 2) != 0 && buf.size() >= 18) { // TGA，HDR 的文件头为文本，不解析
+            info.width = (int)readLE16(p + 12);
+            info.height = (int)readLE16(p + 14);
+            info.bitDepth = 8;
+            info.frameCount = 1;
+            ret = true;
+        }
+        break;
+
+    case Decoder::Pfm: {
+        float scaleFactor;
+        bool isColor;
+        size_t dataOffset;
+        ret = parsePFMHeader(buf, info.width, info.height, scaleFactor, isColor, dataOffset);
+        info.bitDepth = 32;
+        info.frameCount = 1;
+    }break;
+
+    default:
+        break;
+    }
+
+    if (!ret || !info.isValid())
+        return {};
+
+    if (isRotatedByViewer && info.orientation >= 5)
+        std::swap(info.width, info.height);
+    return info;
+}
+
+
+ImageProbe ImageDatabase::probe(const wstring& path) {
+    // 映射文件只会读入文件头所在的页，大部分格式不会触及像素数据
+    MappedFile file;
+    if (!file.open(path))
+        return {};
+
+    const auto fileBuf = file.bytes();
+    if (fileBuf.size() < 16)
+        return {};
+
+    return probe(fileBuf, sniffDecoder(fileBuf, getLowerExt(path)));
+}
+
+
+// file 由 loader 打开，sniffedEntry 是 loader 按文件内容识别出的解码器，文件不足 16 字节时为空
+ImageAsset ImageDatabase::decodeFile(const wstring& path, const MappedFile& file, const DecoderEntry* sniffedEntry, bool isFullResolution) {
+    FunctionTimeCount FunctionTimeCount(__func__);
+    jarkUtils::log("loading: {}", jarkUtils::wstringToUtf8(path));
+
+    if (path.length() < 4) {
+        jarkUtils::log("path.length() < 4: {}", jarkUtils::wstringToUtf8(path));
+        return { ImageFormat::Still, getErrorTipsMat(), {}, {}, "" };
+    }
+
+    // 打开失败时 loader 已记录日志，此处 size 为 0
+    if (file.size() < 16 || !sniffedEntry) {
+        jarkUtils::log("path fileSize < 16: {}", jarkUtils::wstringToUtf8(path));
+        return { ImageFormat::Still, getErrorTipsMat(), {}, {}, "" };
+    }
+    const span<const uint8_t> fileBuf = file.bytes();
+    const auto& decoderEntry = *sniffedEntry;
+
+    // 远大于屏幕的 JPEG/RAW 只解码到适应屏幕所需的分辨率（与 createPreview 的条件一致），放大超过预览时再 reload 原图
+    // JXL/AVIF/HEIC 的解码库没有缩小输出，仍完整解码后生成预览
+    // 解码较慢的大图先发布内嵌缩略图作为临时显示，完整结果就绪后替换
+    // 每次加载最多 probe 一次，结果在发布缩略图与计算缩小解码比例间共用
+    ImageProbe probeInfo;
+    bool isProbed = false;
+    auto getProbe = [&]() -> const ImageProbe& {
+        if (!isProbed) {
+            probeInfo = probe(fileBuf, decoderEntry);
+            isProbed = true;
+        }
+        return probeInfo;
+        };
+
+    if (!isFullResolution && hasEmbeddedThumbnail(decoderEntry) && isProvisionalAllowed())
+        publishThumbnail(path, fileBuf, decoderEntry, getProbe());
+
+    DecodeHint hint;
+    auto updateDecodeHint = [&] {
+        if (isFullResolution)
+            return;
+        if (const auto& probeInfo = getProbe(); probeInfo.isValid()) {
+            const auto screenSize = getScreenSize();
+            const double scale = std::min((double)screenSize.width / probeInfo.width, (double)screenSize.height / probeInfo.height);
+            if (scale * PREVIEW_MIN_RATIO <= 1.0)
+                hint = { scale, { probeInfo.width, probeInfo.height } };
+        }
+        };
+
+    // 静态或动画
+    ImageAsset imageAsset;
+    bool isMultiFrame = true;
+    switch (decoderEntry.decoder) {
+    case Decoder::OpenCVAnimation:
+        imageAsset = loadAnimationStream(fileBuf, decoderEntry);
+        if (imageAsset.format == ImageFormat::None)
+            imageAsset = loadAnimation(path, fileBuf);
+        break;
+    case Decoder::Bpg:
+        imageAsset = loadBPG(path, fileBuf);
+        break;
+    case Decoder::Jxl:
+        imageAsset = loadAnimationStream(fileBuf, decoderEntry);
+        if (imageAsset.format == ImageFormat::None)
+            imageAsset = loadJXL(path, fileBuf);
+        break;
+    case Decoder::Wp2: // webp2
+        imageAsset = loadAnimationStream(fileBuf, decoderEntry);
+        if (imageAsset.format == ImageFormat::None)
+            imageAsset = loadWP2(path, fileBuf);
+        break;
+
+    // 实况照片 包含一张图片和一段简短视频
+    case Decoder::Livp:
+        return loadLivp(path, fileBuf);
+    case Decoder::MotionPhoto:
+        updateDecodeHint();
+        return loadMotionPhoto(path, fileBuf, true, hint);
+    case Decoder::HeifMotionPhoto:
+        return loadMotionPhoto(path, fileBuf);
+
+    default:
+        isMultiFrame = false;
+        break;
+    }
+
+    if (isMultiFrame) {
+        if (imageAsset.format == ImageFormat::None) {
+            imageAsset.format = ImageFormat::Still;
+            imageAsset.exifInfo = ExifParse::getSimpleInfo(path, 0, 0, fileBuf.data(), fileBuf.size());
+            return imageAsset;
+        }
+
+        const cv::Mat firstFrame = imageAsset.format == ImageFormat::Still ? imageAsset.primaryFrame : imageAsset.frameAt(0);
+        imageAsset.exifInfo = ExifParse::getSimpleInfo(path, firstFrame.cols, firstFrame.rows, fileBuf.data(), fileBuf.size());
+        if (imageAsset.format == ImageFormat::Still || memcmp(fileBuf.data(), "GIF8", 4) != 0) // GIF 动图没有 EXIF
+            imageAsset.metadata = ExifParse::parse(path, fileBuf.data(), fileBuf.size());
+        return imageAsset;
+    }
+
+    //以下是静态图
+    cv::Mat img;
+    string exifInfo;
+
+    switch (decoderEntry.decoder) {
+    case Decoder::Avif:
+        img = loadAvif(path, fileBuf);
+        break;
+    case Decoder::Jxr:
+        img = loadJXR(path, fileBuf);
+        break;
+    case Decoder::TgaHdr:
+        img = loadTGA_HDR(path, fileBuf);
+        break;
+    case Decoder::Svg:
+        img = loadSVG(path, fileBuf);
+        break;
+    case Decoder::Qoi:
+        img = loadQOI(path, fileBuf);
+        break;
+    case Decoder::Ico:
+        std::tie(img, exifInfo) = loadICO(path, fileBuf);
+        break;
+    case Decoder::Psd:
+        img = loadPSD(path, fileBuf);
+        break;
+    case Decoder::Pfm:
+        img = loadPFM(path, fileBuf);
+        break;
+    case Decoder::Raw:
+        // 优先显示内嵌的 JPEG 预览，原图在放大、复制或后台 reload 时再解码
+        if (!isFullResolution) {
+            if (auto previewAsset = loadRawPreview(path, fileBuf); previewAsset.format != ImageFormat::None)
+                return previewAsset;
+            updateDecodeHint();
+        }
+        img = loadRaw(path, fileBuf, hint.scale);
+        break;
+    default:
         img = loadMat(path, fileBuf);
+        break;
+    }
 
+    std::shared_ptr<ExifMetadata> metadata;
+    int orientation = 1;
     if (exifInfo.empty()) {
-        auto exifTmp = ExifParse::getExif(path, fileBuf.data(), fileBuf.size());
-        if (!supportRaw.contains(ext)) { // RAW 格式已经在解码过程应用了裁剪/旋转/镜像等操作
-            const size_t idx = exifTmp.find("\n方向: ");
-            if (idx != string::npos) {
-                handleExifOrientation(exifTmp[idx + 9] - '0', img);
-            }
+        if (decoderEntry.caps & CapExif) {
+            metadata = ExifParse::parse(path, fileBuf.data(), fileBuf.size());
+            // RAW 等格式已经在解码过程应用了裁剪/旋转/镜像等操作，其余格式的方向在显示时变换
+            if (metadata && !(decoderEntry.caps & CapOrientation) && !img.empty())
+                orientation = metadata->orientation;
         }
-        exifInfo = ExifParse::getSimpleInfo(path, img.cols, img.rows, fileBuf.data(), fileBuf.size()) + exifTmp;
+
+        // 缩小解码时信息中显示原图尺寸
+        const cv::Size infoSize = (hint.isScaled() && !img.empty()) ? hint.fullSize : orientedSize(img.size(), orientation);
+        exifInfo = ExifParse::getSimpleInfo(path, infoSize.width, infoSize.height, fileBuf.data(), fileBuf.size());
     }
 
-    if (img.empty())
+    // 每个文件只尝试一种解码器，失败即显示错误提示
+    if (img.empty()) {
         img = getErrorTipsMat();
+    }
+    else if (hint.isScaled()) {
+        auto imageAsset = makeScaledAsset(img, hint, std::move(exifInfo), orientation);
+        imageAsset.metadata = std::move(metadata);
+        return imageAsset;
+    }
 
-    return { ImageFormat::Still, std::move(img), {}, {}, exifInfo };
+    ImageAsset imageAsset{ ImageFormat::Still, std::move(img), {}, {}, exifInfo, metadata };
+    imageAsset.orientation = orientation;
+    return imageAsset;
 }
\ No newline at end of file
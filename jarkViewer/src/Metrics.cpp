@@ -0,0 +1,179 @@
+#include "Metrics.h"
+#include <fstream>
+
+
+void Metrics::Histogram::add(double ms) {
+    count++;
+    sumMs += ms;
+    maxMs = std::max(maxMs, ms);
+
+    int idx = 0;
+    while (idx < BUCKETS && ms > (double)(1ULL << idx))
+        idx++;
+    buckets[idx]++;
+}
+
+
+Metrics::LoadScope::LoadScope(wstring_view ext) : ext(ext), startTime(std::chrono::steady_clock::now()), parent(tlsScope) {
+    tlsScope = this;
+}
+
+
+Metrics::LoadScope::~LoadScope() {
+    tlsScope = parent;
+    if (isDiscarded)
+        return;
+
+    const double totalMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+    stageMs[(size_t)Stage::Total] = totalMs;
+
+    // 读取了源文件才有解码阶段，磁盘缓存命中时没有
+    if (stageMs[(size_t)Stage::Read] > 0) {
+        double decodeMs = totalMs;
+        for (auto stage : { Stage::Read, Stage::Exif, Stage::DiskCache })
+            decodeMs -= stageMs[(size_t)stage];
+        stageMs[(size_t)Stage::Decode] = std::max(decodeMs, 0.0);
+    }
+    record(*this);
+}
+
+
+Metrics::StageTimer::~StageTimer() {
+    if (tlsScope == nullptr)
+        return;
+    tlsScope->stageMs[(size_t)stage] += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+
+void Metrics::record(const LoadScope& scope) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& formatHistograms = histograms[scope.ext.empty() ? L"unknown" : scope.ext];
+    for (size_t i = 0; i < (size_t)Stage::Count; i++) {
+        if (scope.stageMs[i] > 0)
+            formatHistograms[i].add(scope.stageMs[i]);
+    }
+}
+
+
+void Metrics::addCounter(string_view name, uint64_t delta) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = counters.find(name);
+    if (it == counters.end())
+        counters.emplace(name, delta);
+    else
+        it->second += delta;
+}
+
+
+void Metrics::setGauge(string_view name, int64_t value) {
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = gauges.find(name);
+    if (it == gauges.end())
+        gauges.emplace(name, value);
+    else
+        it->second = value;
+}
+
+
+static string jsonEscape(string_view str) {
+    string ret;
+    ret.reserve(str.size());
+    for (char c : str) {
+        switch (c) {
+        case '"': ret += "\\\""; break;
+        case '\\': ret += "\\\\"; break;
+        case '\n': ret += "\\n"; break;
+        case '\r': ret += "\\r"; break;
+        case '\t': ret += "\\t"; break;
+        default:
+            if ((unsigned char)c < 0x20)
+                ret += std::format("\\u{:04x}", (int)c);
+            else
+                ret += c;
+        }
+    }
+    return ret;
+}
+
+
+string Metrics::toJson() {
+    std::lock_guard<std::mutex> lock(mutex);
+
+    const auto uptimeMs = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - startTime).count();
+    string json = std::format("{{\n  \"version\": 1,\n  \"uptimeMs\": {},\n", uptimeMs);
+
+    json += "  \"bucketUpperMs\": [";
+    for (int i = 0; i < Histogram::BUCKETS; i++)
+        json += std::format("{}{}", i ? ", " : "", 1ULL << i);
+    json += ", null],\n";
+
+    json += "  \"counters\": {";
+    bool isFirst = true;
+    for (const auto& [name, value] : counters) {
+        json += std::format("{}\n    \"{}\": {}", isFirst ? "" : ",", jsonEscape(name), value);
+        isFirst = false;
+    }
+    json += isFirst ? "},\n" : "\n  },\n";
+
+    json += "  \"gauges\": {";
+    isFirst = true;
+    for (const auto& [name, value] : gauges) {
+        json += std::format("{}\n    \"{}\": {}", isFirst ? "" : ",", jsonEscape(name), value);
+        isFirst = false;
+    }
+    json += isFirst ? "},\n" : "\n  },\n";
+
+    json += "  \"formats\": {";
+    isFirst = true;
+    for (const auto& [ext, formatHistograms] : histograms) {
+        json += std::format("{}\n    \"{}\": {{", isFirst ? "" : ",", jsonEscape(jarkUtils::wstringToUtf8(ext)));
+        isFirst = false;
+
+        bool isFirstStage = true;
+        for (size_t i = 0; i < (size_t)Stage::Count; i++) {
+            const auto& histogram = formatHistograms[i];
+            if (histogram.count == 0)
+                continue;
+
+            json += std::format("{}\n      \"{}\": {{ \"count\": {}, \"avgMs\": {:.2f}, \"maxMs\": {:.2f}, \"buckets\": [",
+                isFirstStage ? "" : ",", STAGE_NAMES[i], histogram.count, histogram.sumMs / histogram.count, histogram.maxMs);
+            isFirstStage = false;
+            for (size_t b = 0; b < histogram.buckets.size(); b++)
+                json += std::format("{}{}", b ? ", " : "", histogram.buckets[b]);
+            json += "] }";
+        }
+        json += isFirstStage ? "}" : "\n    }";
+    }
+    json += isFirst ? "}\n}\n" : "\n  }\n}\n";
+
+    return json;
+}
+
+
+bool Metrics::dumpJson(const wstring& path) {
+    auto json = toJson();
+
+    std::error_code ec;
+    auto dir = std::filesystem::path(path).parent_path();
+    if (!dir.empty())
+        std::filesystem::create_directories(dir, ec);
+
+    std::ofstream file(std::filesystem::path(path), std::ios::binary);
+    if (!file.is_open()) {
+        jarkUtils::log("Metrics dump failed: {}", jarkUtils::wstringToUtf8(path));
+        return false;
+    }
+    file.write(json.data(), json.size());
+    return file.good();
+}
+
+
+wstring Metrics::defaultDumpPath() {
+    wchar_t localAppDataPath[MAX_PATH];
+    if (FAILED(SHGetFolderPathW(NULL, CSIDL_LOCAL_APPDATA, NULL, 0, localAppDataPath)))
+        return L"metrics.json";
+
+    auto now = std::chrono::current_zone()->to_local(std::chrono::system_clock::now());
+    auto fileName = std::format(L"metrics_{:%Y%m%d_%H%M%S}.json", std::chrono::floor<std::chrono::seconds>(now));
+    return (std::filesystem::path(localAppDataPath) / L"jarkViewer" / L"metrics" / fileName).wstring();
+}
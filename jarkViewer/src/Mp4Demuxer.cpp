@@ -0,0 +1,183 @@
+#include "Mp4Demuxer.h"
+
+
+namespace {
+    uint16_t readU16(const uint8_t* p) {
+        return (uint16_t)((p[0] << 8) | p[1]);
+    }
+
+    uint32_t readU32(const uint8_t* p) {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    uint64_t readU64(const uint8_t* p) {
+        return ((uint64_t)readU32(p) << 32) | readU32(p + 4);
+    }
+
+    // 遍历 buf 中的各个 box，回调参数为 box 类型和去掉头部的内容  回调返回 false 时停止遍历
+    template<typename Callback>
+    bool forEachBox(span<const uint8_t> buf, Callback&& callback) {
+        size_t pos = 0;
+        while (buf.size() - pos >= 8) {
+            uint64_t size = readU32(&buf[pos]);
+            const uint32_t type = readU32(&buf[pos + 4]);
+            size_t headerSize = 8;
+            if (size == 1) { // 64 位长度
+                if (buf.size() - pos < 16)
+                    return false;
+                size = readU64(&buf[pos + 8]);
+                headerSize = 16;
+            }
+            else if (size == 0) { // 延伸到末尾
+                size = buf.size() - pos;
+            }
+            if (size < headerSize || size > buf.size() - pos)
+                return false;
+
+            if (!callback(type, buf.subspan(pos + headerSize, (size_t)size - headerSize)))
+                return true;
+            pos += (size_t)size;
+        }
+        return true;
+    }
+
+    // 第一个指定类型的子 box 的内容，不存在时为空
+    span<const uint8_t> findBox(span<const uint8_t> buf, uint32_t type) {
+        span<const uint8_t> result;
+        forEachBox(buf, [&](uint32_t boxType, span<const uint8_t> payload) {
+            if (boxType != type)
+                return true;
+            result = payload;
+            return false;
+            });
+        return result;
+    }
+
+    // tkhd 矩阵 {a b u; c d v; x y w} 中 a b c d 为 16.16 定点数，只识别 90° 倍数的旋转
+    int parseRotation(span<const uint8_t> tkhd) {
+        if (tkhd.empty())
+            return 0;
+        const size_t matrixOffset = tkhd[0] == 1 ? 4 + 8 + 8 + 4 + 4 + 8 + 8 + 8 : 4 + 4 + 4 + 4 + 4 + 4 + 8 + 8;
+        if (tkhd.size() < matrixOffset + 36)
+            return 0;
+
+        const auto a = (int32_t)readU32(&tkhd[matrixOffset]);
+        const auto b = (int32_t)readU32(&tkhd[matrixOffset + 4]);
+        const auto c = (int32_t)readU32(&tkhd[matrixOffset + 12]);
+        const auto d = (int32_t)readU32(&tkhd[matrixOffset + 16]);
+        constexpr int32_t one = 0x10000;
+        if (a == 0 && b == one && c == -one && d == 0)
+            return 90;
+        if (a == -one && b == 0 && c == 0 && d == -one)
+            return 180;
+        if (a == 0 && b == -one && c == one && d == 0)
+            return 270;
+        return 0;
+    }
+
+    bool parseSampleTable(span<const uint8_t> stbl, Mp4VideoTrack& track) {
+        // stsd: 第一个视觉样本描述，其中含编码尺寸
+        const auto stsd = findBox(stbl, Mp4Demuxer::fourcc("stsd"));
+        if (stsd.size() < 8 + 8 + 32 || readU32(&stsd[4]) == 0)
+            return false;
+        const auto entry = stsd.subspan(8);
+        track.codec = readU32(&entry[4]);
+        track.width = readU16(&entry[8 + 24]);
+        track.height = readU16(&entry[8 + 26]);
+
+        // stts: 解码时间增量，按游程编码
+        const auto stts = findBox(stbl, Mp4Demuxer::fourcc("stts"));
+        if (stts.size() < 8)
+            return false;
+        const uint32_t sttsEntries = readU32(&stts[4]);
+        if (stts.size() < 8 + (uint64_t)sttsEntries * 8)
+            return false;
+
+        int64_t decodeTime = 0;
+        for (uint32_t i = 0; i < sttsEntries; i++) {
+            const uint32_t count = readU32(&stts[8 + i * 8]);
+            const uint32_t delta = readU32(&stts[12 + i * 8]);
+            if (track.decodeTimes.size() + count > Mp4Demuxer::MAX_SAMPLES)
+                return false;
+            for (uint32_t j = 0; j < count; j++) {
+                track.decodeTimes.push_back(decodeTime);
+                decodeTime += delta;
+            }
+            if (count)
+                track.lastDelta = delta;
+        }
+
+        // ctts: 有 B 帧时显示顺序与解码顺序不同，version 0 的偏移按有符号数处理，常见封装都如此写入
+        const auto ctts = findBox(stbl, Mp4Demuxer::fourcc("ctts"));
+        if (ctts.size() >= 8) {
+            const uint32_t cttsEntries = readU32(&ctts[4]);
+            if (ctts.size() < 8 + (uint64_t)cttsEntries * 8)
+                return false;
+            for (uint32_t i = 0; i < cttsEntries && track.compositionOffsets.size() < track.decodeTimes.size(); i++) {
+                const uint32_t count = std::min<uint64_t>(readU32(&ctts[8 + i * 8]), track.decodeTimes.size() - track.compositionOffsets.size());
+                const auto offset = (int32_t)readU32(&ctts[12 + i * 8]);
+                track.compositionOffsets.insert(track.compositionOffsets.end(), count, offset);
+            }
+            track.compositionOffsets.resize(track.decodeTimes.size(), track.compositionOffsets.empty() ? 0 : track.compositionOffsets.back());
+        }
+        return !track.decodeTimes.empty();
+    }
+
+    bool parseTrak(span<const uint8_t> trak, Mp4VideoTrack& track) {
+        const auto mdia = findBox(trak, Mp4Demuxer::fourcc("mdia"));
+        const auto hdlr = findBox(mdia, Mp4Demuxer::fourcc("hdlr"));
+        if (hdlr.size() < 12 || readU32(&hdlr[8]) != Mp4Demuxer::fourcc("vide"))
+            return false;
+
+        const auto mdhd = findBox(mdia, Mp4Demuxer::fourcc("mdhd"));
+        const size_t timescaleOffset = (!mdhd.empty() && mdhd[0] == 1) ? 4 + 8 + 8 : 4 + 4 + 4;
+        if (mdhd.size() < timescaleOffset + 4)
+            return false;
+        track.timescale = readU32(&mdhd[timescaleOffset]);
+        if (track.timescale == 0)
+            return false;
+
+        track.rotation = parseRotation(findBox(trak, Mp4Demuxer::fourcc("tkhd")));
+
+        const auto minf = findBox(mdia, Mp4Demuxer::fourcc("minf"));
+        const auto stbl = findBox(minf, Mp4Demuxer::fourcc("stbl"));
+        return parseSampleTable(stbl, track);
+    }
+}
+
+
+vector<int> Mp4VideoTrack::frameDurationsMs() const {
+    const int count = sampleCount();
+    vector<int64_t> presentTimes(count);
+    for (int i = 0; i < count; i++)
+        presentTimes[i] = decodeTimes[i] + (compositionOffsets.empty() ? 0 : compositionOffsets[i]);
+    std::sort(presentTimes.begin(), presentTimes.end());
+
+    vector<int> durations(count);
+    for (int i = 0; i < count; i++) {
+        const int64_t delta = (i + 1 < count) ? presentTimes[i + 1] - presentTimes[i] : lastDelta;
+        durations[i] = std::max((int)((delta * 1000 + timescale / 2) / timescale), 1);
+    }
+    return durations;
+}
+
+
+bool Mp4Demuxer::parseVideoTrack(span<const uint8_t> buf, Mp4VideoTrack& track) {
+    const auto moov = findBox(buf, fourcc("moov"));
+    if (moov.empty())
+        return false;
+
+    bool isFound = false;
+    forEachBox(moov, [&](uint32_t type, span<const uint8_t> payload) {
+        if (type != fourcc("trak"))
+            return true;
+        Mp4VideoTrack candidate;
+        if (parseTrak(payload, candidate)) {
+            track = std::move(candidate);
+            isFound = true;
+            return false;
+        }
+        return true;
+        });
+    return isFound;
+}
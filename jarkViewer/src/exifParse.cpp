@@ -1,5 +1,32 @@
 #include "jarkUtils.h"
 #include "exifParse.h"
+#include "Metrics.h"
+#include <thread>
+#include <list>
+
+
+const std::string& ExifMetadata::text() {
+    std::call_once(textOnce, [this] {
+        auto exifStr = ExifParse::exifDataToString(path, exifData);
+        auto xmpStr = ExifParse::xmpDataToString(path, xmpData);
+        auto iptcStr = ExifParse::iptcDataToString(path, iptcData);
+
+        if ((exifStr.length() + xmpStr.length() + iptcStr.length() + prompt.length()) > 0)
+            textCache = "\n\n【按 C 键复制图像全部信息】\n" + exifStr + xmpStr + iptcStr + prompt;
+
+        exifData.clear();
+        xmpData.clear();
+        iptcData.clear();
+        prompt.clear();
+        prompt.shrink_to_fit();
+        });
+    return textCache;
+}
+
+
+string ImageAsset::infoText() const {
+    return metadata ? exifInfo + metadata->text() : exifInfo;
+}
 
 
 std::string ExifParse::getSimpleInfo(wstring_view path, int width, int height, const uint8_t* buf, size_t fileSize) {
@@ -365,29 +392,133 @@ std::string ExifParse::AI_Prompt(wstring_view path, const uint8_t* buf) {
     return "";
 }
 
-std::string ExifParse::getExif(wstring_view path, const uint8_t* buf, size_t fileSize) {
-    static std::mutex mtx;
+void ExifParse::initialize() {
+    static std::once_flag initOnce;
+    std::call_once(initOnce, [] {
+        // 解析时遇到未知的 XMP 命名空间会注册到全局表，传入锁使注册线程安全
+        static std::mutex xmpMutex;
+        Exiv2::XmpParser::initialize([](void* lockData, bool isLock) {
+            auto mutex = (std::mutex*)lockData;
+            if (isLock)
+                mutex->lock();
+            else
+                mutex->unlock();
+            }, &xmpMutex);
+        Exiv2::enableBMFF();
+        });
+}
+
+// 没有该字段或取值不在 1~8 时按 1（不变换）处理，加载流程直接使用结果，无需再检查
+int ExifParse::getOrientation(const Exiv2::ExifData& exifData) {
+    auto it = exifData.findKey(Exiv2::ExifKey("Exif.Image.Orientation"));
+    if (it == exifData.end() || it->count() == 0)
+        return 1;
+    const auto orientation = it->toInt64();
+    return (1 <= orientation && orientation <= 8) ? (int)orientation : 1;
+}
+
+
+// 从xmp获取视频数据大小  https://developer.android.com/media/platform/motion-photo-format?hl=zh-cn
+// 旧标准（MicroVideo）    Xmp.GCamera.MicroVideoOffset: xxxx
+// 新标准（MotionPhoto）   Xmp.Container.Directory[xxx]/Item:Semantic: MotionPhoto 之后的 Item:Length: xxxx
+size_t ExifParse::getVideoSize(const Exiv2::XmpData& xmpData) {
+    auto toSize = [](const Exiv2::Xmpdatum& datum) -> size_t {
+        const auto value = datum.count() ? datum.toInt64() : 0;
+        return value > 0 ? (size_t)value : 0;
+        };
+
+    auto it = xmpData.findKey(Exiv2::XmpKey("Xmp.GCamera.MicroVideoOffset"));
+    if (it != xmpData.end())
+        return toSize(*it);
+
+    bool isMotionPhotoItem = false;
+    for (const auto& datum : xmpData) {
+        const auto key = datum.key();
+        if (!isMotionPhotoItem)
+            isMotionPhotoItem = key.ends_with("Item:Semantic") && datum.toString() == "MotionPhoto";
+        else if (key.ends_with("Item:Length"))
+            return toSize(datum);
+    }
+    return 0;
+}
 
-    std::lock_guard<std::mutex> lock(mtx);
+
+// 每次调用的 Image/ExifData 等均为局部对象，全局状态只有 initialize 中初始化的部分，无需加锁
+std::shared_ptr<ExifMetadata> ExifParse::parse(wstring_view path, const uint8_t* buf, size_t fileSize) {
+    Metrics::StageTimer stageTimer(Metrics::Stage::Exif);
+    initialize();
 
     try {
         auto image = Exiv2::ImageFactory::open(buf, fileSize);
         image->readMetadata();
 
-        auto exifStr = exifDataToString(path, image->exifData());
-        auto xmpStr = xmpDataToString(path, image->xmpData());
-        auto iptcStr = iptcDataToString(path, image->iptcData());
-        string prompt = AI_Prompt(path, buf);
-
-        if ((exifStr.length() + xmpStr.length() + iptcStr.length() + prompt.length()) > 0)
-            return  "\n\n【按 C 键复制图像全部信息】\n" + exifStr + xmpStr + iptcStr + prompt;
-        else
-            return "";
+        auto metadata = std::make_shared<ExifMetadata>();
+        metadata->path = path;
+        metadata->exifData = std::move(image->exifData());
+        metadata->xmpData = std::move(image->xmpData());
+        metadata->iptcData = std::move(image->iptcData());
+        metadata->prompt = AI_Prompt(path, buf);
+        metadata->orientation = getOrientation(metadata->exifData);
+        metadata->videoSize = getVideoSize(metadata->xmpData);
+        return metadata;
     }
     catch (Exiv2::Error& e) {
         jarkUtils::log("Caught Exiv2 exception {}\n{}", jarkUtils::wstringToUtf8(path), e.what());
-        return "";
+        return nullptr;
     }
-    return "";
+}
+
+std::string ExifParse::benchmark(wstring_view dirPath) {
+    initialize();
+
+    // 预先读入内存，只统计解析耗时
+    std::list<MappedFile> files;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator(dirPath, ec)) {
+        if (files.size() >= 500)
+            break;
+        if (!entry.is_regular_file(ec))
+            continue;
+        if (!files.emplace_back().open(entry.path().wstring()) || files.back().size() < 16)
+            files.pop_back();
+    }
+    if (files.empty())
+        return std::format("文件夹中没有可读取的文件: {}", jarkUtils::wstringToUtf8(dirPath));
+
+    vector<span<const uint8_t>> buffers;
+    for (const auto& file : files)
+        buffers.push_back(file.bytes());
+
+    // 每个线程数下总共解析 rounds 遍，各线程按下标交错分配
+    const int rounds = std::max(1, 2000 / (int)buffers.size());
+    const size_t totalTasks = buffers.size() * rounds;
+    const int maxThreads = (int)std::max(std::thread::hardware_concurrency(), 1u);
+
+    string report = std::format("EXIF 解析吞吐量  文件数: {}  每轮解析: {} 次\n", buffers.size(), totalTasks);
+    double singleThreadRate = 0;
+    for (int threadCount = 1; ; threadCount = std::min(threadCount * 2, maxThreads)) {
+        const auto startTime = std::chrono::steady_clock::now();
+        vector<std::thread> threads;
+        for (int t = 0; t < threadCount; t++) {
+            threads.emplace_back([&, t] {
+                for (size_t i = t; i < totalTasks; i += threadCount) {
+                    const auto& buf = buffers[i % buffers.size()];
+                    parse(L"", buf.data(), buf.size());
+                }
+                });
+        }
+        for (auto& thread : threads)
+            thread.join();
+
+        const double elapsedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+        const double rate = totalTasks * 1000.0 / std::max(elapsedMs, 1e-3);
+        if (threadCount == 1)
+            singleThreadRate = rate;
+        report += std::format("{:>3} 线程: {:>10.1f} 次/秒  {:.2f}x\n", threadCount, rate, rate / singleThreadRate);
+
+        if (threadCount == maxThreads)
+            break;
+    }
+    return report;
 }
 
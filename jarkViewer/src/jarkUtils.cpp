@@ -2,6 +2,13 @@
 
 #include "jarkUtils.h"
 
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
 
 std::string jarkUtils::bin2Hex(const void* bytes, const size_t len) {
     auto charList = "0123456789ABCDEF";
@@ -114,6 +121,148 @@ std::string jarkUtils::size2Str(const size_t fileSize) {
     return std::format("{:.1f} GiB", fileSize / (1024.0 * 1024 * 1024));
 }
 
+bool jarkUtils::getFileIdentity(wstring_view path, FileIdentity& identity) {
+    HANDLE hFile = CreateFileW(wstring(path).c_str(), FILE_READ_ATTRIBUTES,
+        FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    BY_HANDLE_FILE_INFORMATION info;
+    bool ret = GetFileInformationByHandle(hFile, &info);
+    CloseHandle(hFile);
+    if (!ret)
+        return false;
+
+    identity.size = ((uint64_t)info.nFileSizeHigh << 32) | info.nFileSizeLow;
+    identity.mtime = ((uint64_t)info.ftLastWriteTime.dwHighDateTime << 32) | info.ftLastWriteTime.dwLowDateTime;
+    identity.fileId = ((uint64_t)info.nFileIndexHigh << 32) | info.nFileIndexLow;
+    identity.volume = info.dwVolumeSerialNumber;
+    return true;
+}
+
+bool MappedFile::open(wstring_view path) {
+    close();
+
+#ifdef _WIN32
+    // 共享写入，映射期间其他程序（如正在导出的软件）仍可写入该文件
+    // 存在映射视图时文件不能被截断（ERROR_USER_MAPPED_FILE），访问映射内存不会越过文件末尾
+    // 内容仍可能在解码期间被改写，加载结束后由调用者再次比对文件身份（见 ImageDatabase::loader）
+    hFile = CreateFileW(wstring(path).c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+        nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (hFile == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER size{};
+    if (!GetFileSizeEx(hFile, &size) || size.QuadPart <= 0) {
+        close();
+        return false;
+    }
+    fileSize = (uint64_t)size.QuadPart;
+
+    hMapping = CreateFileMappingW(hFile, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (hMapping)
+        fileData = (const uint8_t*)MapViewOfFile(hMapping, FILE_MAP_READ, 0, 0, 0);
+    if (fileData) {
+        // 映射前文件可能已被截断，映射后大小不再减小，以此时的大小为准
+        if (GetFileSizeEx(hFile, &size) && (uint64_t)size.QuadPart < fileSize)
+            fileSize = (uint64_t)size.QuadPart;
+        if (fileSize > 0)
+            return true;
+        close();
+        return false;
+    }
+
+    jarkUtils::log("MapViewOfFile failed: {} error {}", jarkUtils::wstringToUtf8(path), GetLastError());
+    if (hMapping) {
+        CloseHandle(hMapping);
+        hMapping = nullptr;
+    }
+    fallbackBuf.resize((size_t)fileSize);
+
+    // 读入内存，ReadFile 单次最多读取 4GB
+    size_t offset = 0;
+    while (offset < fallbackBuf.size()) {
+        DWORD toRead = (DWORD)std::min<size_t>(fallbackBuf.size() - offset, 1ULL << 30);
+        DWORD readBytes = 0;
+        if (!ReadFile(hFile, fallbackBuf.data() + offset, toRead, &readBytes, nullptr) || readBytes == 0)
+            break;
+        offset += readBytes;
+    }
+    CloseHandle(hFile);
+    hFile = INVALID_HANDLE_VALUE;
+
+    if (offset == 0) {
+        close();
+        return false;
+    }
+    fallbackBuf.resize(offset);
+    fileData = fallbackBuf.data();
+    fileSize = offset;
+    return true;
+#else
+    fd = ::open(jarkUtils::wstringToUtf8(path).c_str(), O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st {};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close();
+        return false;
+    }
+    fileSize = (uint64_t)st.st_size;
+
+    void* ptr = mmap(nullptr, (size_t)fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (ptr != MAP_FAILED) {
+        madvise(ptr, (size_t)fileSize, MADV_SEQUENTIAL);
+        fileData = (const uint8_t*)ptr;
+        return true;
+    }
+
+    fallbackBuf.resize((size_t)fileSize);
+    size_t offset = 0;
+    while (offset < fallbackBuf.size()) {
+        auto readBytes = ::read(fd, fallbackBuf.data() + offset, fallbackBuf.size() - offset);
+        if (readBytes <= 0)
+            break;
+        offset += (size_t)readBytes;
+    }
+    ::close(fd);
+    fd = -1;
+
+    if (offset == 0) {
+        close();
+        return false;
+    }
+    fallbackBuf.resize(offset);
+    fileData = fallbackBuf.data();
+    fileSize = offset;
+    return true;
+#endif
+}
+
+void MappedFile::close() {
+#ifdef _WIN32
+    if (fileData && fallbackBuf.empty())
+        UnmapViewOfFile(fileData);
+    if (hMapping)
+        CloseHandle(hMapping);
+    if (hFile != INVALID_HANDLE_VALUE)
+        CloseHandle(hFile);
+    hMapping = nullptr;
+    hFile = INVALID_HANDLE_VALUE;
+#else
+    if (fileData && fallbackBuf.empty())
+        munmap((void*)fileData, (size_t)fileSize);
+    if (fd >= 0)
+        ::close(fd);
+    fd = -1;
+#endif
+    fileData = nullptr;
+    fileSize = 0;
+    fallbackBuf.clear();
+    fallbackBuf.shrink_to_fit();
+}
+
 std::string jarkUtils::timeStamp2Str(time_t timeStamp) {
     timeStamp += 8ULL * 3600; // UTC+8
     std::tm* ptm = std::gmtime(&timeStamp);
@@ -73,6 +73,12 @@ struct CurImageParameter {
     int height = 0;
     int rotation = 0; // 旋转： 0正常， 1逆90度， 2：180度， 3顺90度
 
+    // 实况照片的显示状态只记录在此，不修改缓存中共享的 ImageAsset
+    // Waiting: 视频首帧尚未解码，先显示静态图  Playing: 播放视频  Still: 视频已播放完或解码失败，显示静态图
+    enum class LiveState { None, Waiting, Playing, Still };
+    LiveState liveState = LiveState::None;
+    std::weak_ptr<ImageAsset> liveAsset; // liveState 所属的实况照片，换图后重新开始
+
     CurImageParameter() {
         Init();
     }
@@ -88,16 +94,38 @@ struct CurImageParameter {
         isAnimationPause = false;
 
         if (imageAssetPtr) {
-            curFrameIdxMax = imageAssetPtr->format == ImageFormat::Animated ? (int)imageAssetPtr->frames.size() - 1 : 1;
+            // 新打开的实况照片先显示静态图，视频首帧在 pollLiveVideo 中不等待地获取
+            const bool isLivePhoto = imageAssetPtr->format == ImageFormat::Animated && !imageAssetPtr->primaryFrame.empty();
+            if (!isLivePhoto) {
+                liveState = LiveState::None;
+                liveAsset.reset();
+            }
+            else if (liveAsset.lock() != imageAssetPtr) {
+                liveState = LiveState::Waiting;
+                liveAsset = imageAssetPtr;
+            }
 
-            if (imageAssetPtr->format == ImageFormat::Animated) {
-                width = imageAssetPtr->frames[0].cols;
-                height = imageAssetPtr->frames[0].rows;
+            curFrameIdxMax = format() == ImageFormat::Animated ? imageAssetPtr->frameCount() - 1 : 1;
+
+            if (format() == ImageFormat::Animated) {
+                // 流式解码的帧尺寸预先已知，不为取尺寸等待解码
+                const auto frameSize = imageAssetPtr->animationStream ?
+                    imageAssetPtr->animationStream->frameSize() : imageAssetPtr->frameAt(0).size();
+                width = frameSize.width;
+                height = frameSize.height;
             }
-            else {
+            else if (imageAssetPtr->previewFrame.empty()) {
                 width = imageAssetPtr->primaryFrame.cols;
                 height = imageAssetPtr->primaryFrame.rows;
             }
+            else { // 原图可能已被缓存释放，按原图尺寸计算缩放
+                width = imageAssetPtr->fullSize.width;
+                height = imageAssetPtr->fullSize.height;
+            }
+
+            // 静态图按 EXIF 方向显示，方向 5~8 时宽高互换
+            if (format() != ImageFormat::Animated && imageAssetPtr->orientation >= 5)
+                std::swap(width, height);
 
             //适应显示窗口宽高的缩放比例
             int64_t zoomFitWindow = std::min(winWidth * ZOOM_BASE / width, winHeight * ZOOM_BASE / height);
@@ -125,6 +153,57 @@ struct CurImageParameter {
         }
     }
 
+    // 当前的显示方式，实况照片显示静态图时为 Still
+    ImageFormat format() const {
+        if (!imageAssetPtr)
+            return ImageFormat::None;
+        if (liveState == LiveState::Waiting || liveState == LiveState::Still)
+            return ImageFormat::Still;
+        return imageAssetPtr->format;
+    }
+
+    // 实况照片重新播放视频（首帧就绪后开始）
+    void replayLiveVideo() {
+        liveState = LiveState::Waiting;
+    }
+
+    // 每次刷新时调用，不等待解码：视频首帧就绪则开始播放，解码失败则保持静态图  显示方式改变时返回 true
+    bool pollLiveVideo() {
+        if (liveState != LiveState::Waiting)
+            return false;
+
+        auto status = AnimationStream::FrameStatus::Ready;
+        if (imageAssetPtr->animationStream) {
+            cv::Mat firstFrame;
+            status = imageAssetPtr->animationStream->tryGetFrame(0, firstFrame);
+        }
+        else if (imageAssetPtr->frameCount() == 0) {
+            status = AnimationStream::FrameStatus::Failed;
+        }
+
+        if (status == AnimationStream::FrameStatus::Pending)
+            return false;
+        liveState = status == AnimationStream::FrameStatus::Ready ? LiveState::Playing : LiveState::Still;
+        return true;
+    }
+
+    // 静态图用于绘制的源图：显示尺寸不超过预览时从预览绘制，原图已被缓存释放时只能用预览
+    const cv::Mat& stillFrame() const {
+        const auto& imageAsset = *imageAssetPtr;
+        if (imageAsset.previewFrame.empty())
+            return imageAsset.primaryFrame;
+        if (imageAsset.primaryFrame.empty() ||
+            zoomCur * imageAsset.fullSize.width <= imageAsset.previewFrame.cols * ZOOM_BASE)
+            return imageAsset.previewFrame;
+        return imageAsset.primaryFrame;
+    }
+
+    // 只剩预览且目标缩放超过预览分辨率，需要重新加载原图  临时缩略图等待加载完成即可
+    bool isNeedFullResolution() const {
+        return imageAssetPtr && imageAssetPtr->isPreviewOnly() && !imageAssetPtr->isProvisional &&
+            zoomTarget * imageAssetPtr->fullSize.width > imageAssetPtr->previewFrame.cols * ZOOM_BASE;
+    }
+
     void updateZoomList(int winWidth = 0, int winHeight = 0) {
         if (winHeight == 0 || winWidth == 0 || imageAssetPtr == nullptr)
             return;
@@ -208,6 +287,12 @@ public:
     int curFileIdx = -1;         // 文件在路径列表的索引
     vector<wstring> imgFileList; // 工作目录下所有图像文件路径
 
+    // 预读窗口：沿浏览方向预读若干张，反方向预读一张
+    int browseDirection = 1;                             // 1: 向后浏览  -1: 向前浏览
+    double switchIntervalMs = 1000.0;                    // 近期切图间隔（滑动平均）
+    std::chrono::steady_clock::time_point lastSwitchTimestamp;
+    bool isLoadingFullResolution = false;                // 当前图只剩预览，正在后台重新加载原图
+
     TextDrawer textDrawer;                 // 给Mat绘制文字
     cv::Mat mainCanvas;          // 窗口内容画布
     D2D1_SIZE_U bitmapSize = D2D1::SizeU(600, 400);
@@ -256,6 +341,12 @@ public:
         curFileIdx = -1;
         imgFileList.clear();
         imgDB.clear();
+        imgDB.setMemoryBudget(ImageDatabase::getMemoryBudget());
+        imgDB.setPreloadThreads(ImageDatabase::getPreloadThreads());
+
+        browseDirection = 1;
+        switchIntervalMs = 1000.0;
+        lastSwitchTimestamp = {};
 
         fs::path fullPath = fs::absolute(filePath);
         wstring openFileName = fullPath.filename().wstring();
@@ -306,14 +397,67 @@ public:
             }
         }
 
-        curPar.imageAssetPtr = imgDB.getSafePtr(imgFileList[curFileIdx], imgFileList[(curFileIdx + 1) % imgFileList.size()]);
+        curPar.imageAssetPtr = loadCurImage(1);
         curPar.Init(winWidth, winHeight);
     }
 
+    // 获取当前图像，同时按浏览方向和速度请求预读窗口内的图像  direction: 1 向后  -1 向前
+    std::shared_ptr<ImageAsset> loadCurImage(int direction) {
+        const int fileCount = (int)imgFileList.size();
+        auto pathAt = [&](int offset) -> const wstring& {
+            return imgFileList[((curFileIdx + offset) % fileCount + fileCount) % fileCount];
+            };
+
+        auto now = std::chrono::steady_clock::now();
+        if (direction == browseDirection && lastSwitchTimestamp.time_since_epoch().count()) {
+            double intervalMs = std::chrono::duration<double, std::milli>(now - lastSwitchTimestamp).count();
+            switchIntervalMs = switchIntervalMs * 0.5 + std::min(intervalMs, 2000.0) * 0.5;
+        }
+        else { // 换向或首次打开，按慢速浏览处理
+            switchIntervalMs = 1000.0;
+        }
+        browseDirection = direction;
+        lastSwitchTimestamp = now;
+        isLoadingFullResolution = false;
+
+        vector<wstring> aheadPaths;
+        for (int i = 1; i <= ImageDatabase::PREFETCH_MAX && i < fileCount; i++)
+            aheadPaths.push_back(pathAt(i * direction));
+        const int prefetchCount = imgDB.getPrefetchCount(pathAt(0), aheadPaths, switchIntervalMs);
+
+        vector<std::pair<wstring, LRUPriority>> requests;
+        for (int i = 0; i < prefetchCount && i < (int)aheadPaths.size(); i++)
+            requests.emplace_back(aheadPaths[i], i == 0 ? LRUPriority::Next : LRUPriority::Speculative);
+        requests.emplace_back(pathAt(-direction), LRUPriority::Previous);
+
+        return imgDB.getSafePtr(pathAt(0), std::move(requests));
+    }
+
+    // 导出运行统计，缓存状态在导出时采样
+    bool dumpMetrics(const wstring& path) {
+        imgDB.updateMetrics(0 <= curFileIdx && curFileIdx < (int)imgFileList.size() ? imgFileList[curFileIdx] : wstring());
+        return Metrics::dumpJson(path);
+    }
+
+    // 复制/打印/保存需要完整分辨率：当前图若只剩预览则重新加载原图并等待，失败时退而使用预览
+    // 静态图的像素保持存储方向，导出前按 EXIF 方向变换
+    cv::Mat getFullResolutionFrame() {
+        if (curPar.format() == ImageFormat::Animated)
+            return curPar.imageAssetPtr->frameAt(curPar.curFrameIdx);
+
+        if (curPar.imageAssetPtr->isPreviewOnly()) {
+            auto fullAsset = imgDB.getReloadedPtr(imgFileList[curFileIdx]);
+            if (!fullAsset || fullAsset->primaryFrame.empty())
+                return ImageDatabase::applyOrientation(curPar.imageAssetPtr->previewFrame, curPar.imageAssetPtr->orientation);
+            curPar.imageAssetPtr = fullAsset;
+        }
+        return ImageDatabase::applyOrientation(curPar.imageAssetPtr->primaryFrame, curPar.imageAssetPtr->orientation);
+    }
+
     inline void handleAnimationControl(int x, int y) {
         // 按钮ID  0:上一帧  1:暂停/继续  2:下一帧  3:保存该帧
         int buttonIdx = (abs(winWidth / 2 - x) > 100 ? -1 : (x + 100 - winWidth / 2) / 50);
-        if (curPar.imageAssetPtr->format == ImageFormat::Animated && buttonIdx >= 0) {
+        if (curPar.format() == ImageFormat::Animated && buttonIdx >= 0) {
             if (curPar.isAnimationPause) {
                 switch (buttonIdx)
                 {
@@ -337,10 +481,10 @@ public:
                         break;
 
                     cv::Mat img;
-                    if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-                        img = curPar.imageAssetPtr->primaryFrame;
+                    if (curPar.format() == ImageFormat::None || curPar.format() == ImageFormat::Still)
+                        img = ImageDatabase::applyOrientation(curPar.imageAssetPtr->primaryFrame, curPar.imageAssetPtr->orientation);
                     else
-                        img = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
+                        img = curPar.imageAssetPtr->frameAt(curPar.curFrameIdx);
 
                     std::vector<uchar> buffer;
                     if (cv::imencode(isJPG ? ".jpg" : ".png", img, buffer)) {
@@ -521,7 +665,7 @@ public:
                 break;
 
             case CursorPos::centerTop:
-                if (curPar.imageAssetPtr->format == ImageFormat::Animated) {
+                if (curPar.format() == ImageFormat::Animated) {
                     extraUIFlag = ShowExtraUI::animationBar;
                     operateQueue.push({ ActionENUM::normalFresh });
                 }
@@ -601,8 +745,7 @@ public:
             }break;
 
             case 'S': { // Ctrl + S  动图或实况图视频 批量保存每一帧到png图片
-                auto& frames = curPar.imageAssetPtr->frames;
-                if (frames.empty())
+                if (curPar.imageAssetPtr->frameCount() == 0)
                     break;
 
                 if (IDYES == MessageBoxW(
@@ -612,20 +755,28 @@ public:
                     MB_YESNO | MB_ICONQUESTION
                 )) {
                     std::thread saveThread([](std::wstring filePath, std::shared_ptr<ImageAsset> imageAssetPtr) {
-                        auto& frames = imageAssetPtr->frames;
                         auto dotIdx = filePath.find_last_of(L".");
                         if (dotIdx == string::npos)
                             dotIdx = filePath.size();
 
-                        for (int i = 0; i < frames.size(); i++) {
+                        auto saveFrame = [&](int i, const cv::Mat& frame) {
                             std::vector<uchar> buffer;
-                            if (cv::imencode(".png", frames[i], buffer)) {
+                            if (cv::imencode(".png", frame, buffer)) {
                                 std::ofstream file(std::format(L"{}_{:04d}.png", filePath.substr(0, dotIdx), i + 1), std::ios::binary);
                                 if (file.is_open()) {
                                     file.write(reinterpret_cast<const char*>(buffer.data()), buffer.size());
                                     file.close();
                                 }
                             }
+                            return true;
+                            };
+
+                        if (imageAssetPtr->animationStream) { // 流式解码的动画用独立的解码源逐帧导出，不打断播放
+                            imageAssetPtr->animationStream->forEachFrame(saveFrame);
+                        }
+                        else {
+                            for (int i = 0; i < imageAssetPtr->frameCount(); i++)
+                                saveFrame(i, imageAssetPtr->frameAt(i));
                         }
                         }, imgFileList[curFileIdx], curPar.imageAssetPtr);
 
@@ -635,13 +786,7 @@ public:
             }break;
 
             case 'C': { // Ctrl + C  复制到剪贴板
-                cv::Mat srcImg;
-                if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-                    srcImg = curPar.imageAssetPtr->primaryFrame;
-                else
-                    srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
-
-                jarkUtils::copyImageToClipboard(srcImg);
+                jarkUtils::copyImageToClipboard(getFullResolutionFrame());
                 ctrlIsPressing = false;
             }break;
 
@@ -654,6 +799,15 @@ public:
                 operateQueue.push({ ActionENUM::requestExit });
                 ctrlIsPressing = false;
             }break;
+
+            case 'M': { // Ctrl + M 导出运行统计
+                auto path = Metrics::defaultDumpPath();
+                if (dumpMetrics(path))
+                    MessageBoxW(m_hWnd, (L"运行统计已导出到:\n" + path).c_str(), L"运行统计", MB_OK);
+                else
+                    MessageBoxW(m_hWnd, (L"运行统计导出失败:\n" + path).c_str(), L"运行统计", MB_ICONERROR);
+                ctrlIsPressing = false; // 上面弹出窗口导致收不到CTRL键释放的消息
+            }break;
             }
         }
         else {
@@ -661,7 +815,7 @@ public:
             {
 
             case 'J': { // 上一帧
-                if (curPar.imageAssetPtr->format == ImageFormat::Animated && curPar.isAnimationPause) {
+                if (curPar.format() == ImageFormat::Animated && curPar.isAnimationPause) {
                     curPar.curFrameIdx--;
                     if (curPar.curFrameIdx < 0)
                         curPar.curFrameIdx = curPar.curFrameIdxMax;
@@ -670,14 +824,14 @@ public:
             }break;
 
             case 'K': { // 动图 暂停/继续
-                if (curPar.imageAssetPtr->format == ImageFormat::Animated) {
+                if (curPar.format() == ImageFormat::Animated) {
                     curPar.isAnimationPause = !curPar.isAnimationPause;
                     operateQueue.push({ ActionENUM::normalFresh });
                 }
             }break;
 
             case 'L': { // 下一帧
-                if (curPar.imageAssetPtr->format == ImageFormat::Animated && curPar.isAnimationPause) {
+                if (curPar.format() == ImageFormat::Animated && curPar.isAnimationPause) {
                     curPar.curFrameIdx++;
                     if (curPar.curFrameIdx > curPar.curFrameIdxMax)
                         curPar.curFrameIdx = 0;
@@ -690,7 +844,7 @@ public:
             }break;
 
             case 'C': { // 复制图像信息到剪贴板
-                jarkUtils::copyToClipboard(jarkUtils::utf8ToWstring(curPar.imageAssetPtr->exifInfo));
+                jarkUtils::copyToClipboard(jarkUtils::utf8ToWstring(curPar.imageAssetPtr->infoText()));
             }break;
 
             case 'F':
@@ -769,12 +923,12 @@ public:
             }break;
 
             case VK_SPACE: {
-                if (curPar.imageAssetPtr->format == ImageFormat::Still && !curPar.imageAssetPtr->frames.empty()) {
-                    curPar.imageAssetPtr->format = ImageFormat::Animated;
+                if (curPar.format() == ImageFormat::Still && curPar.imageAssetPtr->frameCount() > 0) {
+                    curPar.replayLiveVideo();
                     curPar.Init(winWidth, winHeight);
                     operateQueue.push({ ActionENUM::normalFresh });
                 }
-                else if (curPar.imageAssetPtr->format == ImageFormat::Animated) {
+                else if (curPar.format() == ImageFormat::Animated) {
                     curPar.isAnimationPause = !curPar.isAnimationPause;
                     operateQueue.push({ ActionENUM::normalFresh });
                 }
@@ -848,7 +1002,7 @@ public:
 
     uint32_t getSrcPx1(const cv::Mat& srcImg, int srcX, int srcY) const {
         uchar srcPx = srcImg.at<uchar>(srcY, srcX);
-        if (curPar.zoomCur < curPar.ZOOM_BASE && srcY > 0 && srcX > 0) { // 简单临近像素平均
+        if (isLowZoom && srcY > 0 && srcX > 0) { // 简单临近像素平均
             const uchar px0 = srcImg.at<uchar>(srcY - 1, srcX - 1);
             const uchar px1 = srcImg.at<uchar>(srcY - 1, srcX);
             const uchar px2 = srcImg.at<uchar>(srcY, srcX - 1);
@@ -901,15 +1055,61 @@ public:
             ((bgPx[0] * (255 - alpha) + srcPx[0] * alpha + 255) >> 8);
     }
 
+    // 画面坐标（已旋转的显示坐标）到源图像素坐标的映射  px = x0 + xdx * srcX + xdy * srcY，py 同理，系数只有 -1/0/1
+    struct PixelMapping {
+        int x0, xdx, xdy;
+        int y0, ydx, ydy;
+    };
+
+    // 组合 EXIF 方向与手动旋转，源图像素保持存储方向不做复制
+    static PixelMapping makePixelMapping(int storedW, int storedH, int orientation, int rotation) {
+        const auto orientedSize = ImageDatabase::orientedSize({ storedW, storedH }, orientation);
+
+        auto mapPoint = [&](int x, int y) -> cv::Point {
+            int u, v; // 应用 EXIF 方向后、手动旋转前的坐标
+            switch (rotation) {
+            case 0: u = x; v = y; break;
+            case 1: u = orientedSize.width - 1 - y; v = x; break;
+            case 2: u = orientedSize.width - 1 - x; v = orientedSize.height - 1 - y; break;
+            default: u = y; v = orientedSize.height - 1 - x; break;
+            }
+
+            switch (orientation) {
+            case 2: return { storedW - 1 - u, v };
+            case 3: return { storedW - 1 - u, storedH - 1 - v };
+            case 4: return { u, storedH - 1 - v };
+            case 5: return { v, u };
+            case 6: return { v, storedH - 1 - u };
+            case 7: return { storedW - 1 - v, storedH - 1 - u };
+            case 8: return { storedW - 1 - v, u };
+            default: return { u, v };
+            }
+        };
+
+        // 映射为仿射，由原点和两个单位步长得到系数
+        const auto origin = mapPoint(0, 0);
+        const auto stepX = mapPoint(1, 0) - origin;
+        const auto stepY = mapPoint(0, 1) - origin;
+        return { origin.x, stepX.x, stepY.x, origin.y, stepX.y, stepY.y };
+    }
+
     void drawCanvas(const cv::Mat& srcImg, cv::Mat& canvas) const {
+        // 静态图及其预览按 EXIF 方向取像素，动画帧和提示图不变换
+        int orientation = 1;
+        if (curPar.imageAssetPtr && srcImg.data &&
+            (srcImg.data == curPar.imageAssetPtr->primaryFrame.data || srcImg.data == curPar.imageAssetPtr->previewFrame.data))
+            orientation = curPar.imageAssetPtr->orientation;
+        const auto orientedSize = ImageDatabase::orientedSize(srcImg.size(), orientation);
+        const auto mapping = makePixelMapping(srcImg.cols, srcImg.rows, orientation, curPar.rotation);
+
         int srcH, srcW;
         if (curPar.rotation == 0 || curPar.rotation == 2) {
-            srcH = srcImg.rows;
-            srcW = srcImg.cols;
+            srcH = orientedSize.height;
+            srcW = orientedSize.width;
         }
         else {
-            srcH = srcImg.cols;
-            srcW = srcImg.rows;
+            srcH = orientedSize.width;
+            srcW = orientedSize.height;
         }
 
         const int canvasH = canvas.rows;
@@ -918,6 +1118,12 @@ public:
         if (srcH <= 0 || srcW <= 0)
             return;
 
+        // 源图为缩小的预览时，按预览与原图的比例换算缩放
+        int64_t zoomCur = curPar.zoomCur;
+        if (curPar.imageAssetPtr && !curPar.imageAssetPtr->previewFrame.empty() &&
+            srcImg.data == curPar.imageAssetPtr->previewFrame.data)
+            zoomCur = zoomCur * curPar.imageAssetPtr->fullSize.width / srcImg.cols;
+
         // 源图和画板canvas均100%缩放且居中重合，此时随机取一个点，先只考虑水平方向
         // 该点与画板中心的距离，等于该点与源图中心的距离
         // 即 canvasW / 2 - x = srcW / 2 - srcX
@@ -938,13 +1144,13 @@ public:
         //if (xEnd > canvasW) xEnd = canvasW;
         //if (yEnd > canvasH) yEnd = canvasH;
 
-        const int deltaW = curPar.slideCur.x + (int)((canvasW - srcW * curPar.zoomCur / curPar.ZOOM_BASE) / 2);
-        const int deltaH = curPar.slideCur.y + (int)((canvasH - srcH * curPar.zoomCur / curPar.ZOOM_BASE) / 2);
+        const int deltaW = curPar.slideCur.x + (int)((canvasW - srcW * zoomCur / curPar.ZOOM_BASE) / 2);
+        const int deltaH = curPar.slideCur.y + (int)((canvasH - srcH * zoomCur / curPar.ZOOM_BASE) / 2);
 
         int xStart = deltaW < 0 ? 0 : deltaW;
         int yStart = deltaH < 0 ? 0 : deltaH;
-        int xEnd = (int)(srcW * curPar.zoomCur / curPar.ZOOM_BASE + deltaW);
-        int yEnd = (int)(srcH * curPar.zoomCur / curPar.ZOOM_BASE + deltaH);
+        int xEnd = (int)(srcW * zoomCur / curPar.ZOOM_BASE + deltaW);
+        int yEnd = (int)(srcH * zoomCur / curPar.ZOOM_BASE + deltaH);
         if (xEnd > canvasW) xEnd = canvasW;
         if (yEnd > canvasH) yEnd = canvasH;
 
@@ -984,8 +1190,8 @@ public:
             }
         }
 
-        const float zoomInvert = (float)curPar.ZOOM_BASE / curPar.zoomCur;
-        isLowZoom = curPar.zoomCur < curPar.ZOOM_BASE;
+        const float zoomInvert = (float)curPar.ZOOM_BASE / zoomCur;
+        isLowZoom = zoomCur < curPar.ZOOM_BASE;
 
         switch (srcImg.type()) {
         case CV_8UC4: {
@@ -1000,36 +1206,13 @@ public:
 
                 srcY = std::clamp(srcY, 0, srcH - 1);
 
-                switch (curPar.rotation) {
-                case 0:
-                    for (int x = xStart; x < xEnd; x++) {
-                        int srcX = (x - deltaW) * zoomInvert;
-                        srcX = std::clamp(srcX, 0, srcW - 1);
-                        ptr[x] = getSrcPx4(srcImg, srcX, srcY, x, y);
-                    }
-                    break;
-                case 1:
-                    for (int x = xStart; x < xEnd; x++) {
-                        int srcX = (x - deltaW) * zoomInvert;
-                        srcX = std::clamp(srcX, 0, srcW - 1);
-                        ptr[x] = getSrcPx4(srcImg, srcH - 1 - srcY, srcX, x, y);
-                    }
-                    break;
-                case 2:
-                    for (int x = xStart; x < xEnd; x++) {
-                        int srcX = (x - deltaW) * zoomInvert;
-                        srcX = std::clamp(srcX, 0, srcW - 1);
-                        ptr[x] = getSrcPx4(srcImg, srcW - 1 - srcX, srcH - 1 - srcY, x, y);
-                    }
-                    break;
-                default:
-                    for (int x = xStart; x < xEnd; x++) {
-                        int srcX = (x - deltaW) * zoomInvert;
-                        srcX = std::clamp(srcX, 0, srcW - 1);
-                        ptr[x] = getSrcPx4(srcImg, srcY, srcW - 1 - srcX, x, y);
-                    }
-                    break;
-                }                
+                const int rowX = mapping.x0 + mapping.xdy * srcY;
+                const int rowY = mapping.y0 + mapping.ydy * srcY;
+                for (int x = xStart; x < xEnd; x++) {
+                    int srcX = (x - deltaW) * zoomInvert;
+                    srcX = std::clamp(srcX, 0, srcW - 1);
+                    ptr[x] = getSrcPx4(srcImg, rowX + mapping.xdx * srcX, rowY + mapping.ydx * srcX, x, y);
+                }
 
                 //如果正在拖动/缩放/平移时，则偷懒：每隔一行就直接用上一行数据
                 if (GlobalVar::settingParameter.isOptimizeSlide &&
@@ -1060,35 +1243,12 @@ public:
 
                 srcY = std::clamp(srcY, 0, srcH - 1);
 
-                switch (curPar.rotation) {
-                case 0:
-                    for (int x = xStart; x < xEnd; x++) {
-                        int srcX = (x - deltaW) * zoomInvert;
-                        srcX = std::clamp(srcX, 0, srcW - 1);
-                        ptr[x] = getSrcPx3(srcImg, srcX, srcY);
-                    }
-                    break;
-                case 1:
-                    for (int x = xStart; x < xEnd; x++) {
-                        int srcX = (x - deltaW) * zoomInvert;
-                        srcX = std::clamp(srcX, 0, srcW - 1);
-                        ptr[x] = getSrcPx3(srcImg, srcH - 1 - srcY, srcX);
-                    }
-                    break;
-                case 2:
-                    for (int x = xStart; x < xEnd; x++) {
-                        int srcX = (x - deltaW) * zoomInvert;
-                        srcX = std::clamp(srcX, 0, srcW - 1);
-                        ptr[x] = getSrcPx3(srcImg, srcW - 1 - srcX, srcH - 1 - srcY);
-                    }
-                    break;
-                default:
-                    for (int x = xStart; x < xEnd; x++) {
-                        int srcX = (x - deltaW) * zoomInvert;
-                        srcX = std::clamp(srcX, 0, srcW - 1);
-                        ptr[x] = getSrcPx3(srcImg, srcY, srcW - 1 - srcX);
-                    }
-                    break;
+                const int rowX = mapping.x0 + mapping.xdy * srcY;
+                const int rowY = mapping.y0 + mapping.ydy * srcY;
+                for (int x = xStart; x < xEnd; x++) {
+                    int srcX = (x - deltaW) * zoomInvert;
+                    srcX = std::clamp(srcX, 0, srcW - 1);
+                    ptr[x] = getSrcPx3(srcImg, rowX + mapping.xdx * srcX, rowY + mapping.ydx * srcX);
                 }
 
                 // 如果正在拖动/缩放/平移时，则偷懒：每隔一行就直接用上一行数据
@@ -1113,35 +1273,12 @@ public:
 
                 srcY = std::clamp(srcY, 0, srcH - 1);
 
-                switch (curPar.rotation) {
-                case 0:
-                    for (int x = xStart; x < xEnd; x++) {
-                        int srcX = (x - deltaW) * zoomInvert;
-                        srcX = std::clamp(srcX, 0, srcW - 1);
-                        ptr[x] = getSrcPx1(srcImg, srcX, srcY);
-                    }
-                    break;
-                case 1:
-                    for (int x = xStart; x < xEnd; x++) {
-                        int srcX = (x - deltaW) * zoomInvert;
-                        srcX = std::clamp(srcX, 0, srcW - 1);
-                        ptr[x] = getSrcPx1(srcImg, srcH - 1 - srcY, srcX);
-                    }
-                    break;
-                case 2:
-                    for (int x = xStart; x < xEnd; x++) {
-                        int srcX = (x - deltaW) * zoomInvert;
-                        srcX = std::clamp(srcX, 0, srcW - 1);
-                        ptr[x] = getSrcPx1(srcImg, srcW - 1 - srcX, srcH - 1 - srcY);
-                    }
-                    break;
-                default:
-                    for (int x = xStart; x < xEnd; x++) {
-                        int srcX = (x - deltaW) * zoomInvert;
-                        srcX = std::clamp(srcX, 0, srcW - 1);
-                        ptr[x] = getSrcPx1(srcImg, srcY, srcW - 1 - srcX);
-                    }
-                    break;
+                const int rowX = mapping.x0 + mapping.xdy * srcY;
+                const int rowY = mapping.y0 + mapping.ydy * srcY;
+                for (int x = xStart; x < xEnd; x++) {
+                    int srcX = (x - deltaW) * zoomInvert;
+                    srcX = std::clamp(srcX, 0, srcW - 1);
+                    ptr[x] = getSrcPx1(srcImg, rowX + mapping.xdx * srcX, rowY + mapping.ydx * srcX);
                 }
 
                 // 如果正在拖动/缩放/平移时，则偷懒：每隔一行就直接用上一行数据
@@ -1187,10 +1324,10 @@ public:
             cv::Vec4b(GlobalVar::theme.BG_COLOR, GlobalVar::theme.BG_COLOR, GlobalVar::theme.BG_COLOR));
 
         cv::Mat srcImg;
-        if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-            srcImg = curPar.imageAssetPtr->primaryFrame;
+        if (curPar.format() == ImageFormat::None || curPar.format() == ImageFormat::Still)
+            srcImg = curPar.stillFrame();
         else
-            srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
+            srcImg = curPar.imageAssetPtr->frameAt(curPar.curFrameIdx);
 
         drawCanvas(srcImg, tmpCanvas);
         cv::resize(tmpCanvas, tmpCanvas, cv::Size(tmpCanvas.cols / 2, tmpCanvas.cols / 2));
@@ -1219,10 +1356,10 @@ public:
             cv::Vec4b(GlobalVar::theme.BG_COLOR, GlobalVar::theme.BG_COLOR, GlobalVar::theme.BG_COLOR));
 
         cv::Mat srcImg;
-        if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-            srcImg = curPar.imageAssetPtr->primaryFrame;
+        if (curPar.format() == ImageFormat::None || curPar.format() == ImageFormat::Still)
+            srcImg = curPar.stillFrame();
         else
-            srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
+            srcImg = curPar.imageAssetPtr->frameAt(curPar.curFrameIdx);
 
         drawCanvas(srcImg, tmpCanvas);
         cv::resize(tmpCanvas, tmpCanvas, cv::Size(tmpCanvas.cols / 2, tmpCanvas.cols / 2));
@@ -1292,10 +1429,10 @@ public:
         using namespace std::chrono;
 
         cv::Mat srcImg;
-        if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-            srcImg = curPar.imageAssetPtr->primaryFrame;
+        if (curPar.format() == ImageFormat::None || curPar.format() == ImageFormat::Still)
+            srcImg = curPar.stillFrame();
         else
-            srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
+            srcImg = curPar.imageAssetPtr->frameAt(curPar.curFrameIdx);
 
         auto nextmainCanvas = cv::Mat(mainCanvas.size(), mainCanvas.type());
         drawCanvas(srcImg, nextmainCanvas);
@@ -1334,10 +1471,10 @@ public:
         using namespace std::chrono;
 
         cv::Mat srcImg;
-        if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-            srcImg = curPar.imageAssetPtr->primaryFrame;
+        if (curPar.format() == ImageFormat::None || curPar.format() == ImageFormat::Still)
+            srcImg = curPar.stillFrame();
         else
-            srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
+            srcImg = curPar.imageAssetPtr->frameAt(curPar.curFrameIdx);
 
         auto nextmainCanvas = cv::Mat(mainCanvas.size(), mainCanvas.type());
         drawCanvas(srcImg, nextmainCanvas);
@@ -1376,10 +1513,10 @@ public:
         using namespace std::chrono;
 
         cv::Mat srcImg;
-        if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-            srcImg = curPar.imageAssetPtr->primaryFrame;
+        if (curPar.format() == ImageFormat::None || curPar.format() == ImageFormat::Still)
+            srcImg = curPar.stillFrame();
         else
-            srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
+            srcImg = curPar.imageAssetPtr->frameAt(curPar.curFrameIdx);
 
         auto nextmainCanvas = cv::Mat(mainCanvas.size(), mainCanvas.type());
         drawCanvas(srcImg, nextmainCanvas);
@@ -1418,10 +1555,10 @@ public:
         using namespace std::chrono;
 
         cv::Mat srcImg;
-        if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-            srcImg = curPar.imageAssetPtr->primaryFrame;
+        if (curPar.format() == ImageFormat::None || curPar.format() == ImageFormat::Still)
+            srcImg = curPar.stillFrame();
         else
-            srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
+            srcImg = curPar.imageAssetPtr->frameAt(curPar.curFrameIdx);
 
         auto nextmainCanvas = cv::Mat(mainCanvas.size(), mainCanvas.type());
         drawCanvas(srcImg, nextmainCanvas);
@@ -1467,7 +1604,7 @@ public:
                 (GlobalVar::isSystemDarkMode ? colorWhite : colorBlack) :
                 (GlobalVar::settingParameter.UI_Mode == 1 ? colorBlack : colorWhite);
 
-            textDrawer.putAlignLeft(canvas, rect, curPar.imageAssetPtr->exifInfo.c_str(), color); // 长文本 8ms
+            textDrawer.putAlignLeft(canvas, rect, curPar.imageAssetPtr->infoText().c_str(), color); // 长文本 8ms
         }
     }
 
@@ -1548,12 +1685,75 @@ public:
             operateQueue.push({ ActionENUM::normalFresh });
         }
 
+        if (GlobalVar::isNeedUpdateCacheBudget) {
+            GlobalVar::isNeedUpdateCacheBudget = false;
+            imgDB.setMemoryBudget(ImageDatabase::getMemoryBudget());
+        }
+
+        if (GlobalVar::isNeedUpdatePreloadThreads) {
+            GlobalVar::isNeedUpdatePreloadThreads = false;
+            imgDB.setPreloadThreads(ImageDatabase::getPreloadThreads());
+        }
+
+        // 实况照片的视频首帧就绪（或解码失败）时切换显示方式
+        if (curPar.pollLiveVideo()) {
+            curPar.Init(winWidth, winHeight);
+            operateQueue.push({ ActionENUM::normalFresh });
+        }
+
+        // 当前显示的是加载中先行发布的缩略图，完整结果就绪后替换，尺寸不变时保留当前缩放和位置
+        // 只查询缓存和失败记录，不在界面线程等待加载
+        if (curPar.imageAssetPtr->isProvisional) {
+            const auto& path = imgFileList[curFileIdx];
+            std::string errorMsg;
+            if (imgDB.isProvisional(path)) { // 仍在加载
+            }
+            else if (auto fullAsset = imgDB.tryGetDataPtr(path)) {
+                const auto provisionalSize = curPar.imageAssetPtr->fullSize;
+                const int provisionalOrientation = curPar.imageAssetPtr->orientation;
+                curPar.imageAssetPtr = fullAsset;
+                const auto& imageAsset = *curPar.imageAssetPtr;
+                const auto fullSize = imageAsset.previewFrame.empty() ? imageAsset.primaryFrame.size() : imageAsset.fullSize;
+                if (imageAsset.format != ImageFormat::Still || fullSize != provisionalSize || imageAsset.orientation != provisionalOrientation)
+                    curPar.Init(winWidth, winHeight);
+                operateQueue.push({ ActionENUM::normalFresh });
+            }
+            else if (imgDB.isFailed(path, &errorMsg)) {
+                // 加载失败：继续显示缩略图，信息面板给出失败原因，不再轮询
+                jarkUtils::log("load failed after provisional: {} {}", jarkUtils::wstringToUtf8(path), errorMsg);
+                auto keptAsset = std::make_shared<ImageAsset>(*curPar.imageAssetPtr);
+                keptAsset->isProvisional = false;
+                keptAsset->exifInfo = std::format("解码失败: {}\n{}", errorMsg, keptAsset->exifInfo);
+                curPar.imageAssetPtr = keptAsset;
+                operateQueue.push({ ActionENUM::normalFresh });
+            }
+            else {
+                // 加载被取消（如缓存被清空），临时值已移除，重新排队，就绪后在此替换
+                imgDB.requestPreload(path);
+            }
+        }
+
+        // 只剩预览的大图放大超过预览分辨率时，或设置了 RAW 后台解码时，后台重新加载原图，就绪后替换（保留当前缩放和位置）
+        if (curPar.isNeedFullResolution() ||
+            (GlobalVar::settingParameter.isRawDecodeInBackground && curPar.imageAssetPtr->isEmbeddedPreview)) {
+            const auto& path = imgFileList[curFileIdx];
+            if (!isLoadingFullResolution) {
+                isLoadingFullResolution = true;
+                imgDB.reload(path);
+            }
+            else if (auto fullAsset = imgDB.tryGetDataPtr(path); fullAsset && !fullAsset->primaryFrame.empty()) {
+                curPar.imageAssetPtr = fullAsset;
+                isLoadingFullResolution = false;
+                operateQueue.push({ ActionENUM::normalFresh });
+            }
+        }
+
         auto operateAction = operateQueue.get();
         if (operateAction.action == ActionENUM::none &&
             curPar.zoomCur == curPar.zoomTarget &&
             curPar.slideCur == curPar.slideTarget &&
-            (curPar.imageAssetPtr->format != ImageFormat::Animated || 
-                (curPar.imageAssetPtr->format == ImageFormat::Animated && curPar.isAnimationPause))) {
+            (curPar.format() != ImageFormat::Animated || 
+                (curPar.format() == ImageFormat::Animated && curPar.isAnimationPause))) {
 
             Sleep(1); // Windows机制限制，实际时长最小只能 15.6ms
             return;
@@ -1566,11 +1766,7 @@ public:
             else {
                 Setting::requestExit(); // OpenCV窗口暂时不能同时共存
 
-                cv::Mat srcImg;
-                if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-                    srcImg = curPar.imageAssetPtr->primaryFrame;
-                else
-                    srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
+                cv::Mat srcImg = getFullResolutionFrame();
 
                 std::thread printerThread([](cv::Mat image) {
                     Printer printer(image);
@@ -1630,23 +1826,18 @@ public:
 
             if (GlobalVar::settingParameter.switchImageAnimationMode) {// 开动画时才需要
                 cv::Mat srcImg;
-                if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-                    srcImg = curPar.imageAssetPtr->primaryFrame;
+                if (curPar.format() == ImageFormat::None || curPar.format() == ImageFormat::Still)
+                    srcImg = curPar.stillFrame();
                 else
-                    srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
+                    srcImg = curPar.imageAssetPtr->frameAt(curPar.curFrameIdx);
 
                 drawCanvas(srcImg, mainCanvas); //先更新无额外按钮UI的原图
                 drawExifInfo(mainCanvas);
             }
             
-            // 播放过的实况图，状态会变成静态图，切走前恢复一下
-            if (curPar.imageAssetPtr->format == ImageFormat::Still && !curPar.imageAssetPtr->frames.empty()) {
-                curPar.imageAssetPtr->format = ImageFormat::Animated;
-            }
-
             if (--curFileIdx < 0)
                 curFileIdx = (int)imgFileList.size() - 1;
-            curPar.imageAssetPtr = imgDB.getSafePtr(imgFileList[curFileIdx], imgFileList[(curFileIdx + imgFileList.size() - 1) % imgFileList.size()]);
+            curPar.imageAssetPtr = loadCurImage(-1);
             curPar.Init(winWidth, winHeight);
 
             if (GlobalVar::settingParameter.switchImageAnimationMode == 1)
@@ -1664,23 +1855,18 @@ public:
 
             if (GlobalVar::settingParameter.switchImageAnimationMode) {// 开动画时才需要
                 cv::Mat srcImg;
-                if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-                    srcImg = curPar.imageAssetPtr->primaryFrame;
+                if (curPar.format() == ImageFormat::None || curPar.format() == ImageFormat::Still)
+                    srcImg = curPar.stillFrame();
                 else
-                    srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
+                    srcImg = curPar.imageAssetPtr->frameAt(curPar.curFrameIdx);
 
                 drawCanvas(srcImg, mainCanvas); //先更新无额外按钮UI的原图
                 drawExifInfo(mainCanvas);
             }
 
-            // 播放过的实况图，状态会变成静态图，切走前恢复一下
-            if (curPar.imageAssetPtr->format == ImageFormat::Still && !curPar.imageAssetPtr->frames.empty()) {
-                curPar.imageAssetPtr->format = ImageFormat::Animated;
-            }
-
             if (++curFileIdx >= (int)imgFileList.size())
                 curFileIdx = 0;
-            curPar.imageAssetPtr = imgDB.getSafePtr(imgFileList[curFileIdx], imgFileList[(curFileIdx + 1) % imgFileList.size()]);
+            curPar.imageAssetPtr = loadCurImage(1);
             curPar.Init(winWidth, winHeight);
 
             if (GlobalVar::settingParameter.switchImageAnimationMode == 1)
@@ -1698,22 +1884,17 @@ public:
 
             if (GlobalVar::settingParameter.switchImageAnimationMode) {// 开动画时才需要
                 cv::Mat srcImg;
-                if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-                    srcImg = curPar.imageAssetPtr->primaryFrame;
+                if (curPar.format() == ImageFormat::None || curPar.format() == ImageFormat::Still)
+                    srcImg = curPar.stillFrame();
                 else
-                    srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
+                    srcImg = curPar.imageAssetPtr->frameAt(curPar.curFrameIdx);
 
                 drawCanvas(srcImg, mainCanvas); //先更新无额外按钮UI的原图
                 drawExifInfo(mainCanvas);
             }
 
-            // 播放过的实况图，状态会变成静态图，切走前恢复一下
-            if (curPar.imageAssetPtr->format == ImageFormat::Still && !curPar.imageAssetPtr->frames.empty()) {
-                curPar.imageAssetPtr->format = ImageFormat::Animated;
-            }
-
             curFileIdx = 0;
-            curPar.imageAssetPtr = imgDB.getSafePtr(imgFileList[curFileIdx], imgFileList[(curFileIdx + imgFileList.size() - 1) % imgFileList.size()]);
+            curPar.imageAssetPtr = loadCurImage(1);     // 跳到首张后只能向后浏览
             curPar.Init(winWidth, winHeight);
 
             if (GlobalVar::settingParameter.switchImageAnimationMode == 1)
@@ -1731,22 +1912,17 @@ public:
 
             if (GlobalVar::settingParameter.switchImageAnimationMode) {// 开动画时才需要
                 cv::Mat srcImg;
-                if (curPar.imageAssetPtr->format == ImageFormat::None || curPar.imageAssetPtr->format == ImageFormat::Still)
-                    srcImg = curPar.imageAssetPtr->primaryFrame;
+                if (curPar.format() == ImageFormat::None || curPar.format() == ImageFormat::Still)
+                    srcImg = curPar.stillFrame();
                 else
-                    srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
+                    srcImg = curPar.imageAssetPtr->frameAt(curPar.curFrameIdx);
 
                 drawCanvas(srcImg, mainCanvas); //先更新无额外按钮UI的原图
                 drawExifInfo(mainCanvas);
             }
 
-            // 播放过的实况图，状态会变成静态图，切走前恢复一下
-            if (curPar.imageAssetPtr->format == ImageFormat::Still && !curPar.imageAssetPtr->frames.empty()) {
-                curPar.imageAssetPtr->format = ImageFormat::Animated;
-            }
-
             curFileIdx = (int)imgFileList.size() - 1;
-            curPar.imageAssetPtr = imgDB.getSafePtr(imgFileList[curFileIdx], imgFileList[(curFileIdx + 1) % imgFileList.size()]);
+            curPar.imageAssetPtr = loadCurImage(-1);    // 跳到末张后只能向前浏览
             curPar.Init(winWidth, winHeight);
 
             if (GlobalVar::settingParameter.switchImageAnimationMode == 1)
@@ -1885,20 +2061,19 @@ public:
         }
 
         cv::Mat srcImg;
-        if (curPar.imageAssetPtr->format == ImageFormat::None ||
-            curPar.imageAssetPtr->format == ImageFormat::Still) {
-            srcImg = curPar.imageAssetPtr->primaryFrame;
+        if (curPar.format() == ImageFormat::None ||
+            curPar.format() == ImageFormat::Still) {
+            srcImg = curPar.stillFrame();
         }
         else {
-            srcImg = curPar.imageAssetPtr->frames[curPar.curFrameIdx];
-            curPar.curFrameDelay = curPar.imageAssetPtr->frameDurations[curPar.curFrameIdx];
+            srcImg = curPar.imageAssetPtr->frameAt(curPar.curFrameIdx, &curPar.curFrameDelay);
         }
 
         drawCanvas(srcImg, mainCanvas);
         drawExifInfo(mainCanvas);
         drawExtraUI(mainCanvas);
 
-        if (curPar.imageAssetPtr->format == ImageFormat::Animated && curPar.isAnimationPause) {
+        if (curPar.format() == ImageFormat::Animated && curPar.isAnimationPause) {
             wstring str = std::format(L"逐帧浏览 [{}/{}] {}% ",
                 curPar.curFrameIdx + 1, curPar.curFrameIdxMax + 1,
                 curPar.zoomCur * 100ULL / curPar.ZOOM_BASE)
@@ -1919,7 +2094,7 @@ public:
 
         updateMainCanvas();
 
-        if (curPar.imageAssetPtr->format == ImageFormat::Animated && curPar.isAnimationPause == false) {
+        if (curPar.format() == ImageFormat::Animated && curPar.isAnimationPause == false) {
             if (delayRemain <= 0)
                 delayRemain = curPar.curFrameDelay;
 
@@ -1939,7 +2114,7 @@ public:
 
                     // 动态帧播放完，若有主图，则是当前实况图像
                     if (!curPar.imageAssetPtr->primaryFrame.empty()) {
-                        curPar.imageAssetPtr->format = ImageFormat::Still;
+                        curPar.liveState = CurImageParameter::LiveState::Still;
                         curPar.Init(winWidth, winHeight);
                         operateQueue.push({ ActionENUM::normalFresh });
                     }
@@ -1952,6 +2127,36 @@ public:
 
 void test();
 
+// 执行后显示报告并退出的启动参数，选项以 "=" 结尾的其后为文件夹路径
+struct ReportOption {
+    wstring_view option;
+    const wchar_t* title;
+    string(*run)(wstring_view arg);
+};
+
+static const ReportOption reportOptions[] = {
+    // --bench-exif=<文件夹>  测试元数据解析的多线程吞吐量
+    { L"--bench-exif=", L"EXIF 解析吞吐量", [](wstring_view dirPath) { return ExifParse::benchmark(dirPath); } },
+    // --check-bpg-simd  检查 BPG 解码的 SIMD 函数与 C 版本结果一致
+    { L"--check-bpg-simd", L"BPG SIMD 检查", [](wstring_view) { return ImageDatabase::checkBPGSimd(); } },
+};
+
+// 命令行为上述启动参数之一时执行并显示结果，返回 true 表示应直接退出
+static bool runReportOption(const wstring& cmdLine) {
+    for (const auto& [option, title, run] : reportOptions) {
+        if (!cmdLine.starts_with(option))
+            continue;
+
+        wstring arg = cmdLine.substr(option.size());
+        std::erase(arg, L'\"');
+        auto report = run(arg);
+        jarkUtils::log("{}", report);
+        MessageBoxW(NULL, jarkUtils::utf8ToWstring(report).c_str(), title, MB_OK);
+        return true;
+    }
+    return false;
+}
+
 int WINAPI wWinMain(
     _In_ HINSTANCE hInstance,
     _In_opt_ HINSTANCE hPrevInstance,
@@ -1970,7 +2175,7 @@ int WINAPI wWinMain(
 
     test();
 
-    Exiv2::enableBMFF();
+    ExifParse::initialize();
     ::ImmDisableIME(GetCurrentThreadId()); // 禁用输入法，防止干扰按键操作
 
     ::HeapSetInformation(nullptr, HeapEnableTerminationOnCorruption, nullptr, 0);
@@ -1978,6 +2183,38 @@ int WINAPI wWinMain(
         return 0;
 
     wstring filePath = lpCmdLine;
+
+    if (runReportOption(filePath)) {
+        ::CoUninitialize();
+        return 0;
+    }
+
+    // --dump-metrics[=文件路径]  退出时导出运行统计，未指定路径则导出到默认目录
+    wstring metricsDumpPath;
+    const wstring metricsOption = L"--dump-metrics";
+    if (filePath.starts_with(metricsOption)) {
+        size_t optionEnd = metricsOption.size();
+        if (optionEnd < filePath.size() && filePath[optionEnd] == L'=') {
+            const size_t pathStart = optionEnd + 1;
+            if (pathStart < filePath.size() && filePath[pathStart] == L'\"') {
+                optionEnd = filePath.find(L'\"', pathStart + 1);
+                metricsDumpPath = filePath.substr(pathStart + 1, optionEnd - pathStart - 1);
+                if (optionEnd != wstring::npos)
+                    optionEnd++;
+            }
+            else {
+                optionEnd = filePath.find(L' ', pathStart);
+                metricsDumpPath = filePath.substr(pathStart, optionEnd - pathStart);
+            }
+        }
+        if (metricsDumpPath.empty())
+            metricsDumpPath = Metrics::defaultDumpPath();
+
+        filePath = optionEnd < filePath.size() ? filePath.substr(optionEnd) : L"";
+        while (!filePath.empty() && filePath.front() == L' ')
+            filePath.erase(0, 1);
+    }
+
     if (!filePath.empty() && filePath.front() == '\"') {
         filePath = filePath.substr(1);
     }
@@ -1989,6 +2226,9 @@ int WINAPI wWinMain(
     if (SUCCEEDED(app.InitWindow(hInstance))) {
         app.initOpenFile(filePath);
         app.Run();
+
+        if (!metricsDumpPath.empty())
+            app.dumpMetrics(metricsDumpPath);
     }
     else {
         MessageBoxW(NULL, L"窗口创建失败！", L"错误", MB_ICONERROR);
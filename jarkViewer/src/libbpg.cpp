@@ -24,11 +24,15 @@
 #include <math.h>
 #ifdef EMSCRIPTEN
 #include <emscripten.h>
+#else
+#include <system_error>
+#include <thread>
 #endif
 
 
 #include <libavutil/opt.h>
 #include <libavcodec/avcodec.h>
+#include <libavcodec/hevcdsp.h>
 #include <libavutil/common.h>
 
 
@@ -92,6 +96,7 @@ struct BPGDecoderContext {
     uint8_t keep_extension_data; /* true if the extension data must be
                                     kept during parsing */
     uint8_t decode_animation; /* true if animation decoding is enabled */
+    int thread_count; /* HEVC slice threads, 0 = number of cores */
     BPGExtensionData *first_md;
 
     /* animation */
@@ -323,7 +328,7 @@ static int hevc_decode_init1(DynBuf *pbuf, AVFrame **pframe,
                              AVCodecContext **pc, 
                              const uint8_t *buf, int buf_len,
                              int width, int height, int chroma_format_idc,
-                             int bit_depth)
+                             int bit_depth, int thread_count)
 {
     AVCodec *codec;
     AVCodecContext *c;
@@ -351,6 +356,9 @@ static int hevc_decode_init1(DynBuf *pbuf, AVFrame **pframe,
     /* for testing: use the MD5 or CRC in SEI to check the decoded bit
        stream. */
     c->err_recognition |= AV_EF_CRCCHECK; 
+    /* decode WPP rows in parallel, thread_count 0 picks the core count */
+    c->thread_type = FF_THREAD_SLICE;
+    c->thread_count = thread_count;
     /* open it */
     if (avcodec_open2(c, codec, NULL) < 0) {
         av_frame_free(&frame);
@@ -380,6 +388,34 @@ static int hevc_write_frame(AVCodecContext *avctx,
         return 0;
 }
 
+/* The alpha and color streams have their own decoder contexts and
+   frames, so they are decoded at the same time when possible */
+static int hevc_write_frames(BPGDecoderContext *s, DynBuf *abuf, DynBuf *cbuf)
+{
+    int ret, alpha_ret = -1;
+
+    if (!s->alpha_dec_ctx)
+        return hevc_write_frame(s->dec_ctx, s->frame, cbuf->buf, cbuf->len);
+#ifndef EMSCRIPTEN
+    try {
+        std::thread alpha_thread([&] {
+            alpha_ret = hevc_write_frame(s->alpha_dec_ctx, s->alpha_frame,
+                                         abuf->buf, abuf->len);
+        });
+        ret = hevc_write_frame(s->dec_ctx, s->frame, cbuf->buf, cbuf->len);
+        alpha_thread.join();
+        return (ret < 0 || alpha_ret < 0) ? -1 : 0;
+    } catch (const std::system_error &) {
+        /* no thread available: decode one after the other */
+    }
+#endif
+    alpha_ret = hevc_write_frame(s->alpha_dec_ctx, s->alpha_frame,
+                                 abuf->buf, abuf->len);
+    if (alpha_ret < 0)
+        return -1;
+    return hevc_write_frame(s->dec_ctx, s->frame, cbuf->buf, cbuf->len);
+}
+
 static int hevc_decode_frame_internal(BPGDecoderContext *s,
                                       DynBuf *abuf, DynBuf *cbuf,
                                       const uint8_t *buf, int buf_len1,
@@ -451,14 +487,10 @@ static int hevc_decode_frame_internal(BPGDecoderContext *s,
     if (s->alpha_dec_ctx) {
         if (dyn_buf_resize(abuf, abuf->len + FF_INPUT_BUFFER_PADDING_SIZE) < 0)
             goto fail;
-        ret = hevc_write_frame(s->alpha_dec_ctx, s->alpha_frame, abuf->buf, abuf->len);
-        if (ret < 0)
-            goto fail;
     }
-
     if (dyn_buf_resize(cbuf, cbuf->len + FF_INPUT_BUFFER_PADDING_SIZE) < 0)
         goto fail;
-    ret = hevc_write_frame(s->dec_ctx, s->frame, cbuf->buf, cbuf->len);
+    ret = hevc_write_frames(s, abuf, cbuf);
     if (ret < 0)
         goto fail;
     ret = buf_len1 - buf_len;
@@ -475,17 +507,33 @@ static int hevc_decode_start(BPGDecoderContext *s,
                              int width, int height, int chroma_format_idc,
                              int bit_depth, int has_alpha)
 {
-    int ret, buf_len;
+    int ret, buf_len, alpha_threads, color_threads;
     DynBuf abuf_s, *abuf = &abuf_s;
     DynBuf cbuf_s, *cbuf = &cbuf_s;
 
     dyn_buf_init(abuf);
     dyn_buf_init(cbuf);
 
+    /* the alpha and color streams are decoded at the same time, so they
+       share the slice threads instead of each starting thread_count */
+    alpha_threads = color_threads = s->thread_count;
+    if (has_alpha) {
+        int total = s->thread_count;
+#ifndef EMSCRIPTEN
+        if (total == 0)
+            total = (int)std::thread::hardware_concurrency();
+#endif
+        if (total > 1) {
+            alpha_threads = total / 2;
+            color_threads = total - alpha_threads;
+        }
+    }
+
     buf_len = buf_len1;
     if (has_alpha) {
         ret = hevc_decode_init1(abuf, &s->alpha_frame, &s->alpha_dec_ctx,
-                                buf, buf_len, width, height, 0, bit_depth);
+                                buf, buf_len, width, height, 0, bit_depth,
+                                alpha_threads);
         if (ret < 0)
             goto fail;
         buf += ret;
@@ -494,7 +542,7 @@ static int hevc_decode_start(BPGDecoderContext *s,
     
     ret = hevc_decode_init1(cbuf, &s->frame, &s->dec_ctx,
                             buf, buf_len, width, height, chroma_format_idc, 
-                            bit_depth);
+                            bit_depth, color_threads);
     if (ret < 0)
         goto fail;
     buf += ret;
@@ -1899,6 +1947,16 @@ void bpg_decoder_keep_extension_data(BPGDecoderContext *s, int enable)
     s->keep_extension_data = enable;
 }
 
+void bpg_decoder_set_threads(BPGDecoderContext *s, int thread_count)
+{
+    s->thread_count = thread_count < 0 ? 0 : thread_count;
+}
+
+int bpg_decoder_check_simd(int bit_depth, char *failed, int failed_size)
+{
+    return ff_hevc_dsp_check_simd(bit_depth, failed, failed_size);
+}
+
 BPGExtensionData *bpg_decoder_get_extension_data(BPGDecoderContext *s)
 {
     return s->first_md;
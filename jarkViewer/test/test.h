@@ -0,0 +1,39 @@
+#pragma once
+#include <cstdio>
+#include <vector>
+
+/*
+* 单元测试的最小框架：TEST 定义并注册用例，CHECK 失败时输出文件行号并继续执行，testMain.cpp 依次运行全部用例
+* 不依赖 Windows/OpenCV 的用例（testLRU.cpp、testHevcDsp.cpp）可在其他平台单独编译运行
+*/
+struct TestCase {
+    const char* name;
+    void (*func)();
+};
+
+inline std::vector<TestCase>& testCases() {
+    static std::vector<TestCase> cases;
+    return cases;
+}
+
+inline int& testFailures() {
+    static int failures = 0;
+    return failures;
+}
+
+struct TestRegistrar {
+    TestRegistrar(const char* name, void (*func)()) { testCases().push_back({ name, func }); }
+};
+
+#define TEST(name) \
+    static void test_##name(); \
+    static TestRegistrar registrar_##name(#name, test_##name); \
+    static void test_##name()
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            std::printf("    %s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); \
+            testFailures()++; \
+        } \
+    } while (0)
@@ -0,0 +1,83 @@
+#include "test.h"
+#include "DiskCache.h"
+
+static const wstring cachePath = L"D:\\照片\\test.heic";
+static const FileIdentity cacheIdentity{ .size = 123456, .mtime = 133000000000000000ULL, .fileId = 42, .volume = 7 };
+
+static ImageAsset makeAnimatedAsset() {
+    ImageAsset asset;
+    asset.format = ImageFormat::Animated;
+    asset.exifInfo = "路径: test\n";
+    for (int i = 0; i < 3; i++) {
+        cv::Mat frame(48, 64, CV_8UC4, cv::Scalar(10 * i, 20, 30, 255));
+        cv::circle(frame, { 10 + i * 8, 24 }, 6, cv::Scalar(255, 255, 255, 200), cv::FILLED);
+        asset.frames.push_back(frame);
+        asset.frameDurations.push_back(40 + i * 10);
+    }
+    return asset;
+}
+
+
+TEST(DiskCache_roundTrip) {
+    ImageAsset still;
+    still.format = ImageFormat::Still;
+    still.orientation = 6;
+    still.exifInfo = "路径: test\n分辨率: 64x48\n";
+    still.primaryFrame = cv::Mat(48, 64, CV_8UC3);
+    cv::randu(still.primaryFrame, 0, 256);
+
+    const auto data = DiskCache::serialize(cachePath, cacheIdentity, still);
+    CHECK(!data.empty());
+
+    ImageAsset loaded;
+    CHECK(DiskCache::deserialize(data.data(), data.size(), cachePath, cacheIdentity, loaded));
+    CHECK(loaded.format == ImageFormat::Still);
+    CHECK(loaded.orientation == 6);
+    CHECK(loaded.exifInfo == still.exifInfo);
+    CHECK(loaded.primaryFrame.type() == CV_8UC3);
+    CHECK(cv::norm(loaded.primaryFrame, still.primaryFrame, cv::NORM_INF) == 0);
+}
+
+TEST(DiskCache_roundTripAnimation) {
+    const auto asset = makeAnimatedAsset();
+    const auto data = DiskCache::serialize(cachePath, cacheIdentity, asset);
+
+    ImageAsset loaded;
+    CHECK(DiskCache::deserialize(data.data(), data.size(), cachePath, cacheIdentity, loaded));
+    CHECK(loaded.frames.size() == asset.frames.size());
+    CHECK(loaded.frameDurations == asset.frameDurations);
+    for (size_t i = 0; i < loaded.frames.size() && i < asset.frames.size(); i++)
+        CHECK(cv::norm(loaded.frames[i], asset.frames[i], cv::NORM_INF) == 0);
+}
+
+TEST(DiskCache_rejectsStaleOrForeignEntry) {
+    const auto data = DiskCache::serialize(cachePath, cacheIdentity, makeAnimatedAsset());
+    ImageAsset loaded;
+
+    auto modified = cacheIdentity;
+    modified.mtime++;
+    CHECK(!DiskCache::deserialize(data.data(), data.size(), cachePath, modified, loaded));
+
+    auto resized = cacheIdentity;
+    resized.size--;
+    CHECK(!DiskCache::deserialize(data.data(), data.size(), cachePath, resized, loaded));
+
+    // 长度相同的不同路径，条目名哈希碰撞时须以路径区分
+    CHECK(!DiskCache::deserialize(data.data(), data.size(), L"D:\\照片\\test.avif", cacheIdentity, loaded));
+    CHECK(loaded.frames.empty());
+}
+
+TEST(DiskCache_rejectsTruncatedEntry) {
+    const auto data = DiskCache::serialize(cachePath, cacheIdentity, makeAnimatedAsset());
+    ImageAsset loaded;
+    for (size_t size : { (size_t)0, (size_t)16, data.size() / 2, data.size() - 1 })
+        CHECK(!DiskCache::deserialize(data.data(), size, cachePath, cacheIdentity, loaded));
+    CHECK(loaded.frames.empty());
+}
+
+TEST(DiskCache_skipsUncacheableFrames) {
+    ImageAsset asset;
+    asset.format = ImageFormat::Still;
+    asset.primaryFrame = cv::Mat(16, 16, CV_16UC3, cv::Scalar(0, 0, 0));
+    CHECK(DiskCache::serialize(cachePath, cacheIdentity, asset).empty());
+}
@@ -0,0 +1,56 @@
+#include "test.h"
+#include "FrameStore.h"
+
+// 纯色背景上移动的方块，帧间只有小块区域变化，与动图的典型内容相同
+static vector<cv::Mat> makeMovingSquareFrames(int count, int type) {
+    vector<cv::Mat> frames;
+    for (int i = 0; i < count; i++) {
+        cv::Mat frame(120, 160, type, cv::Scalar(40, 80, 120, 255));
+        cv::rectangle(frame, cv::Rect(4 + i * 3, 10 + i, 24, 24), cv::Scalar(200, 30, 90, 128), cv::FILLED);
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+static bool isSameMat(const cv::Mat& a, const cv::Mat& b) {
+    return a.size() == b.size() && a.type() == b.type() && cv::norm(a, b, cv::NORM_INF) == 0;
+}
+
+
+TEST(FrameStore_roundTripSequential) {
+    for (int type : { CV_8UC3, CV_8UC4 }) {
+        // 帧数超过关键帧间隔，覆盖增量帧与多个关键帧
+        const auto frames = makeMovingSquareFrames(FrameStore::KEYFRAME_INTERVAL + 8, type);
+        auto store = FrameStore::create(frames);
+        CHECK(store != nullptr);
+        if (!store)
+            continue;
+
+        CHECK(store->frameCount() == (int)frames.size());
+        for (int i = 0; i < store->frameCount(); i++)
+            CHECK(isSameMat(store->getFrame(i), frames[i]));
+    }
+}
+
+TEST(FrameStore_roundTripRandomAccess) {
+    const auto frames = makeMovingSquareFrames(FrameStore::KEYFRAME_INTERVAL * 2, CV_8UC4);
+    auto store = FrameStore::create(frames);
+    CHECK(store != nullptr);
+    if (!store)
+        return;
+
+    // 倒序、跨关键帧跳转，并持有先前返回的帧，确认其内容不被后续重建改写
+    const cv::Mat held = store->getFrame(5);
+    for (int idx : { 40, 3, 63, 0, 31, 32, 17, 62 })
+        CHECK(isSameMat(store->getFrame(idx), frames[idx]));
+    CHECK(isSameMat(held, frames[5]));
+}
+
+TEST(FrameStore_rejectsUnsupportedFrames) {
+    CHECK(FrameStore::create(makeMovingSquareFrames(1, CV_8UC4)) == nullptr);
+    CHECK(FrameStore::create(makeMovingSquareFrames(4, CV_8UC1)) == nullptr);
+
+    auto frames = makeMovingSquareFrames(4, CV_8UC3);
+    frames[2] = cv::Mat(60, 80, CV_8UC3, cv::Scalar(0, 0, 0));
+    CHECK(FrameStore::create(frames) == nullptr);
+}
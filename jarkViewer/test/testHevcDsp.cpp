@@ -0,0 +1,14 @@
+#include "test.h"
+#include "libbpg.h"
+
+// HEVC 解码的 SIMD 函数（反变换、SAO、去块、插值、帧内预测）与 C 版本在随机数据上逐位比对
+// 未编译 SIMD 或 CPU 不支持 SSE2 时返回 -1，视为通过
+TEST(HevcDsp_simdMatchesC) {
+    for (int bitDepth = 8; bitDepth <= 14; bitDepth++) {
+        char failed[512]{};
+        const int fails = bpg_decoder_check_simd(bitDepth, failed, sizeof(failed));
+        if (fails > 0)
+            std::printf("    %d 位: %s\n", bitDepth, failed);
+        CHECK(fails <= 0);
+    }
+}
@@ -0,0 +1,117 @@
+#include "test.h"
+#include "LRU.h"
+#include <stdexcept>
+
+// 键为 "名称:字节数"，值即该字节数  名称以 fail 开头的加载失败
+class TestCache : public LRU<std::string, size_t> {
+public:
+    std::atomic<int> loadCount{ 0 };
+    std::atomic<bool> isStale{ false };     // 为 true 时已缓存的值视为过期，下次加载后恢复
+    bool isShrinkable = false;              // 为 true 时内存紧张的条目缩减为十分之一
+
+    size_t loader(const std::string& key) override {
+        loadCount++;
+        if (key.starts_with("fail"))
+            throw std::runtime_error("load failed");
+        isStale = false;
+        return std::stoul(key.substr(key.find(':') + 1));
+    }
+
+    bool isValueValid(const std::string&, const size_t&) override { return !isStale; }
+
+    size_t valueBytes(const size_t& value) const override { return value; }
+
+    std::shared_ptr<size_t> shrinkValue(const size_t& value) override {
+        return isShrinkable ? std::make_shared<size_t>(value / 10) : nullptr;
+    }
+};
+
+
+TEST(LRU_capacityEvictsLeastRecentlyUsed) {
+    TestCache cache;
+    cache.setCapacity(3);
+    for (const char* key : { "a:1", "b:1", "c:1", "d:1" })
+        cache.put(key, 1);
+
+    CHECK(cache.size() == 3);
+    CHECK(cache.tryGetDataPtr("a:1") == nullptr);
+    CHECK(cache.tryGetDataPtr("d:1") != nullptr);
+    CHECK(cache.stats().evictions == 1);
+}
+
+TEST(LRU_memoryBudgetEvictsOldest) {
+    TestCache cache;
+    cache.setCapacity(10);
+    cache.setMemoryBudget(250);
+    for (const char* key : { "a:100", "b:100", "c:100" })
+        cache.put(key, 100);
+
+    CHECK(cache.memoryUsage() == 200);
+    CHECK(cache.tryGetDataPtr("a:100") == nullptr);
+    CHECK(cache.entryBytes("b:100") == 100);
+    CHECK(cache.entryBytes("c:100") == 100);
+}
+
+TEST(LRU_activeKeyIsNeverEvicted) {
+    TestCache cache;
+    cache.setCapacity(10);
+    cache.setMemoryBudget(250);
+    cache.setActiveKey("a:100");
+    for (const char* key : { "a:100", "b:100", "c:100" })
+        cache.put(key, 100);
+
+    CHECK(cache.tryGetDataPtr("a:100") != nullptr);
+    CHECK(cache.tryGetDataPtr("b:100") == nullptr);
+    CHECK(cache.memoryUsage() == 200);
+}
+
+TEST(LRU_shrinksBeforeEvicting) {
+    TestCache cache;
+    cache.isShrinkable = true;
+    cache.setCapacity(10);
+    cache.setMemoryBudget(250);
+    for (const char* key : { "a:100", "b:100", "c:100" })
+        cache.put(key, 100);
+
+    CHECK(cache.size() == 3);
+    CHECK(cache.entryBytes("a:100") == 10);
+    CHECK(cache.memoryUsage() == 210);
+    CHECK(cache.stats().shrinks == 1);
+    CHECK(cache.stats().evictions == 0);
+}
+
+TEST(LRU_loadsOnceThroughPreloadPool) {
+    TestCache cache;
+    auto first = cache.getSafePtr("x:42");
+    auto second = cache.getSafePtr("x:42");
+
+    CHECK(first && *first == 42);
+    CHECK(second == first);
+    CHECK(cache.loadCount == 1);
+    CHECK(cache.stats().misses == 1);
+    CHECK(cache.stats().hits == 1);
+}
+
+TEST(LRU_reportsFailedLoad) {
+    TestCache cache;
+    cache.requestPreload("fail:1");
+
+    LRUWaitStatus status;
+    std::string errorMsg;
+    auto value = cache.getDataPtr("fail:1", &status, &errorMsg);
+    CHECK(value == nullptr);
+    CHECK(status == LRUWaitStatus::Failed);
+    CHECK(errorMsg == "load failed");
+    CHECK(cache.isFailed("fail:1"));
+}
+
+TEST(LRU_reloadsStaleValue) {
+    TestCache cache;
+    CHECK(cache.getSafePtr("s:5") != nullptr);
+    CHECK(cache.loadCount == 1);
+
+    cache.isStale = true;   // 如源文件已被修改
+    auto value = cache.getSafePtr("s:5");
+    CHECK(value && *value == 5);
+    CHECK(cache.loadCount == 2);
+}
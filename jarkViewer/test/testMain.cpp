@@ -0,0 +1,47 @@
+#include "test.h"
+#include <cstring>
+#include <string>
+
+// 依次运行名称包含 filter 的用例，返回失败的 CHECK 数
+static int runTests(const std::string& filter) {
+    int caseCount = 0, failedCases = 0;
+    for (const auto& testCase : testCases()) {
+        if (!filter.empty() && !strstr(testCase.name, filter.c_str()))
+            continue;
+
+        const int failuresBefore = testFailures();
+        std::printf("[ RUN  ] %s\n", testCase.name);
+        testCase.func();
+        const bool isPassed = testFailures() == failuresBefore;
+        std::printf("[ %s ] %s\n", isPassed ? " OK " : "FAIL", testCase.name);
+        caseCount++;
+        failedCases += isPassed ? 0 : 1;
+    }
+    std::printf("%d 个用例，%d 个失败\n", caseCount, failedCases);
+    return testFailures();
+}
+
+#ifdef _WIN32
+#include "ImageDatabase.h"
+
+// --bench-bpg=<文件夹>  以 1、2、4…N 个 WPP 行线程解码文件夹内的 BPG 并输出耗时，测试集的准备见 ImageDatabase::benchmarkBPG
+static bool runBench(wstring_view arg) {
+    const wstring_view benchBpgOption = L"--bench-bpg=";
+    if (!arg.starts_with(benchBpgOption))
+        return false;
+
+    std::printf("%s\n", ImageDatabase::benchmarkBPG(arg.substr(benchBpgOption.size())).c_str());
+    return true;
+}
+
+int wmain(int argc, wchar_t* argv[]) {
+    SetConsoleOutputCP(CP_UTF8);
+    if (argc > 1 && runBench(argv[1]))
+        return 0;
+    return runTests(argc > 1 ? jarkUtils::wstringToUtf8(argv[1]) : "") ? 1 : 0;
+}
+#else
+int main(int argc, char* argv[]) {
+    return runTests(argc > 1 ? argv[1] : "") ? 1 : 0;
+}
+#endif
@@ -0,0 +1,130 @@
+#include "test.h"
+#include "ImageDatabase.h"
+
+// 只含文件头的最小样本，像素数据已截断，probe 只需解析文件头
+
+// EXIF 方向 6，SOF 存储尺寸 4000x3000
+static const uint8_t jpegOrient6[] = {
+    0xff, 0xd8, 0xff, 0xe1, 0x00, 0x22, 0x45, 0x78, 0x69, 0x66, 0x00, 0x00,
+    0x4d, 0x4d, 0x00, 0x2a, 0x00, 0x00, 0x00, 0x08, 0x00, 0x01, 0x01, 0x12,
+    0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x06, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0xff, 0xdb, 0x00, 0x04, 0x00, 0x00, 0xff, 0xc0, 0x00, 0x0b,
+    0x08, 0x0b, 0xb8, 0x0f, 0xa0, 0x01, 0x01, 0x11, 0x00, 0xff, 0xda,
+};
+
+// 640x480 16 位 RGBA，acTL 记录 7 帧
+static const uint8_t apng16bit[] = {
+    0x89, 0x50, 0x4e, 0x47, 0x0d, 0x0a, 0x1a, 0x0a, 0x00, 0x00, 0x00, 0x0d,
+    0x49, 0x48, 0x44, 0x52, 0x00, 0x00, 0x02, 0x80, 0x00, 0x00, 0x01, 0xe0,
+    0x10, 0x06, 0x00, 0x00, 0x00, 0x65, 0x41, 0x00, 0xa7, 0x00, 0x00, 0x00,
+    0x08, 0x61, 0x63, 0x54, 0x4c, 0x00, 0x00, 0x00, 0x07, 0x00, 0x00, 0x00,
+    0x00, 0x3b, 0x6d, 0x1c, 0x00, 0x00, 0x00, 0x00, 0x02, 0x49, 0x44, 0x41,
+    0x54, 0x78, 0x78, 0xc5, 0xc3, 0xb7, 0x4a, 0x00, 0x00, 0x00, 0x00, 0x49,
+    0x45, 0x4e, 0x44, 0xae, 0x42, 0x60, 0x82,
+};
+
+// 320x200，2 帧
+static const uint8_t gif2Frames[] = {
+    0x47, 0x49, 0x46, 0x38, 0x39, 0x61, 0x40, 0x01, 0xc8, 0x00, 0x80, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x21, 0xf9, 0x04, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x2c, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x0a, 0x00,
+    0x00, 0x02, 0x02, 0x44, 0x01, 0x00, 0x21, 0xf9, 0x04, 0x00, 0x00, 0x00,
+    0x00, 0x00, 0x2c, 0x00, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x0a, 0x00, 0x00,
+    0x02, 0x02, 0x44, 0x01, 0x00, 0x3b,
+};
+
+// VP8X 1920x1080，3 个 ANMF 帧，EXIF 方向 8（动图帧不旋转）
+static const uint8_t webpAnimated[] = {
+    0x52, 0x49, 0x46, 0x46, 0x5c, 0x00, 0x00, 0x00, 0x57, 0x45, 0x42, 0x50,
+    0x56, 0x50, 0x38, 0x58, 0x0a, 0x00, 0x00, 0x00, 0x0a, 0x00, 0x00, 0x00,
+    0x7f, 0x07, 0x00, 0x37, 0x04, 0x00, 0x41, 0x4e, 0x4d, 0x46, 0x04, 0x00,
+    0x00, 0x00, 0x61, 0x62, 0x63, 0x64, 0x41, 0x4e, 0x4d, 0x46, 0x04, 0x00,
+    0x00, 0x00, 0x61, 0x62, 0x63, 0x64, 0x41, 0x4e, 0x4d, 0x46, 0x04, 0x00,
+    0x00, 0x00, 0x61, 0x62, 0x63, 0x64, 0x45, 0x58, 0x49, 0x46, 0x1a, 0x00,
+    0x00, 0x00, 0x4d, 0x4d, 0x00, 0x2a, 0x00, 0x00, 0x00, 0x08, 0x00, 0x01,
+    0x01, 0x12, 0x00, 0x03, 0x00, 0x00, 0x00, 0x01, 0x00, 0x08, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00,
+};
+
+// 5000x300 10 位
+static const uint8_t bpg10bit[] = {
+    0x42, 0x50, 0x47, 0xfb, 0x22, 0x00, 0xa7, 0x08, 0x82, 0x2c, 0x00, 0x00,
+    0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+    0x00, 0x00,
+};
+
+// 小端 TIFF，IFD0 含 64x48 8 位，isDng 时附加 DNGVersion 标签
+static vector<uint8_t> makeTiff(bool isDng) {
+    vector<uint8_t> buf = { 'I', 'I', '*', 0, 8, 0, 0, 0 };
+    auto put16 = [&](uint32_t v) { buf.push_back(v & 0xff); buf.push_back((v >> 8) & 0xff); };
+    auto put32 = [&](uint32_t v) { put16(v & 0xffff); put16(v >> 16); };
+    auto putEntry = [&](uint32_t tag, uint32_t type, uint32_t value) { put16(tag); put16(type); put32(1); put32(value); };
+
+    put16(isDng ? 4 : 3);
+    putEntry(256, 3, 64);
+    putEntry(257, 3, 48);
+    putEntry(258, 3, 8);
+    if (isDng)
+        putEntry(50706, 1, 0x00000401); // DNGVersion 1.4.0.0
+    put32(0);
+    return buf;
+}
+
+static ImageProbe probeAs(span<const uint8_t> buf, wstring_view ext) {
+    return ImageDatabase::probe(buf, ImageDatabase::sniffDecoder(buf, ext));
+}
+
+
+TEST(Probe_jpegSwapsSizeForExifRotation) {
+    const auto info = probeAs(jpegOrient6, L"jpg");
+    CHECK(info.width == 3000 && info.height == 4000);
+    CHECK(info.orientation == 6);
+    CHECK(info.bitDepth == 8);
+}
+
+TEST(Probe_apngReadsBitDepthAndFrameCount) {
+    const auto info = probeAs(apng16bit, L"png");
+    CHECK(info.width == 640 && info.height == 480);
+    CHECK(info.bitDepth == 16);
+    CHECK(info.frameCount == 7);
+}
+
+TEST(Probe_gifCountsFrames) {
+    const auto info = probeAs(gif2Frames, L"gif");
+    CHECK(info.width == 320 && info.height == 200);
+    CHECK(info.frameCount == 2);
+}
+
+TEST(Probe_animatedWebpIsNotRotated) {
+    const auto info = probeAs(webpAnimated, L"webp");
+    CHECK(info.width == 1920 && info.height == 1080);
+    CHECK(info.frameCount == 3);
+    CHECK(info.orientation == 8);
+}
+
+TEST(Probe_bpgReadsHeader) {
+    const auto info = probeAs(bpg10bit, L"bpg");
+    CHECK(info.width == 5000 && info.height == 300);
+    CHECK(info.bitDepth == 10);
+}
+
+TEST(Probe_truncatedBufferIsInvalid) {
+    CHECK(!probeAs(span(jpegOrient6, 12), L"jpg").isValid());
+}
+
+TEST(Sniff_contentOverridesWrongExtension) {
+    CHECK(ImageDatabase::sniffDecoder(gif2Frames, L"jpg").decoder == ImageDatabase::Decoder::OpenCVAnimation);
+    CHECK(ImageDatabase::sniffDecoder(bpg10bit, L"png").decoder == ImageDatabase::Decoder::Bpg);
+}
+
+TEST(Sniff_tiffBasedRawBeforeGenericTiff) {
+    const auto dng = makeTiff(true);
+    const auto tiff = makeTiff(false);
+    CHECK(ImageDatabase::sniffDecoder(dng, L"jpg").decoder == ImageDatabase::Decoder::Raw);
+    CHECK(ImageDatabase::sniffDecoder(dng, L"").decoder == ImageDatabase::Decoder::Raw);
+    CHECK(ImageDatabase::sniffDecoder(tiff, L"jpg").decoder == ImageDatabase::Decoder::OpenCV);
+
+    const auto info = probeAs(tiff, L"tif");
+    CHECK(info.width == 64 && info.height == 48);
+    CHECK(info.bitDepth == 8);
+}